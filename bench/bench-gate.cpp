@@ -0,0 +1,215 @@
+/**
+ * bench-gate.cpp
+ *
+ * Runs a benchmark suite (see bench-suite.cpp) and fails if any
+ * configuration has become significantly slower than a stored baseline,
+ * so that a performance regression can fail a build like a test does.
+ *
+ * usage: bench-gate [-g gpunum] [-r] [-a alpha] [-t percent] [-o results-file]
+ *                   suite-file baseline-file
+ *
+ * With -r the results are written to baseline-file, which is then
+ * checked in; the baseline is only meaningful on the machine and device
+ * it was recorded on. Otherwise each configuration (graph, app, backend
+ * and work-group count) is compared with its baseline on two phases:
+ *
+ *   compute   the kernel time of each run (samples_ms)
+ *   upload    the time each run took to copy the graph onto the device
+ *             (upload_samples_ms; not on the host backend)
+ *
+ * A phase regresses if a one-sided Mann-Whitney U test finds its times
+ * larger than the baseline's at level alpha (default 0.01) AND its median
+ * is more than percent (default 5) slower, so that neither a significant
+ * but negligible change nor a large but noisy one fails the gate.
+ *
+ * Throughput (MTEPS) is printed for compute, but it is not tested
+ * separately: it is the edge count over the time, and the test only uses
+ * the order of the samples, so it would give the same p-value. Graph
+ * loading happens once per process, so there is no distribution of it
+ * to test.
+ *
+ * The standard error of every run goes to <results-file or baseline-file>.log
+ *
+ * Exits with 1 if any phase regressed or any run failed, and 2 on
+ * usage errors or if the baseline is unreadable, empty, or lacks any
+ * configuration of the suite: an unchecked configuration is not a pass.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// mann_whitney_greater summarize_samples SampleSummary
+#include "bench_stats.h"
+// read_suite run_suite write_json read_json BenchResult
+#include "suite_runner.h"
+
+namespace {
+
+void usage(char *argv[]) {
+  fprintf(stderr, "usage: %s [-g gpunum] [-r] [-a alpha] [-t percent] [-o results-file]\n"
+                  "       suite-file baseline-file\n"
+                  " -r  record the results as the baseline instead of comparing with it\n"
+                  " -a  significance level of the test (default 0.01)\n"
+                  " -t  slowdown of the median to tolerate, in percent (default 5)\n"
+                  " -o  also write the results to results-file (JSON)\n", argv[0]);
+}
+
+void write_results(const std::string &file, const char *suite_file, const std::string &label,
+                   const std::vector<BenchResult> &results) {
+  FILE *f = fopen(file.c_str(), "w");
+  if (!f) {
+    fail("Cannot write results to '%s'", file);
+  }
+  write_json(f, suite_file, label, results);
+  fclose(f);
+}
+
+/** @return true if *a* and *b* were run in the same configuration */
+bool same_configuration(const BenchResult &a, const BenchResult &b) {
+  return a.graph == b.graph && a.app == b.app && a.backend == b.backend
+         && a.work_groups == b.work_groups;
+}
+
+/**
+ * Compare one phase of a configuration with its baseline, printing a
+ * row of the report
+ *
+ * @param edges the graph's edge count for MTEPS, or 0 to leave it out
+ * @return true if the phase regressed
+ */
+bool compare_phase(const char *phase, const std::vector<double> &baseline,
+                   const std::vector<double> &current, size_t edges,
+                   double alpha, double tolerance) {
+  if (baseline.empty() || current.empty()) {
+    return false;
+  }
+  SampleSummary base = summarize_samples(baseline),
+                now = summarize_samples(current);
+  double change = base.median > 0 ? now.median / base.median - 1 : 0;
+  double p = mann_whitney_greater(current, baseline);
+  bool regressed = p < alpha && change > tolerance;
+  const char *verdict = regressed ? "REGRESSION"
+                        : p < alpha && change > 0 ? "slower (within tolerance)"
+                        : mann_whitney_greater(baseline, current) < alpha ? "faster"
+                        : "ok";
+  fprintf(stderr, "    %-8s %12.3f %12.3f %+8.2f%%", phase, base.median, now.median, 100 * change);
+  if (edges > 0 && base.median > 0 && now.median > 0) {
+    fprintf(stderr, " %10.2f -> %-10.2f", edges / base.median / 1e3, edges / now.median / 1e3);
+  } else {
+    fprintf(stderr, " %24s", "");
+  }
+  fprintf(stderr, " %10.2g  %s\n", p, verdict);
+  return regressed;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string device, results_file;
+  bool record = false;
+  double alpha = 0.01, tolerance_percent = 5;
+  int c;
+  while ((c = getopt(argc, argv, "g:ra:t:o:")) != -1) {
+    switch (c) {
+      case 'g':
+        device = optarg;
+        break;
+      case 'r':
+        record = true;
+        break;
+      case 'a':
+        alpha = atof(optarg);
+        break;
+      case 't':
+        tolerance_percent = atof(optarg);
+        break;
+      case 'o':
+        results_file = optarg;
+        break;
+      default:
+        usage(argv);
+        exit(2);
+    }
+  }
+  if (argc - optind != 2 || alpha <= 0 || alpha >= 1 || tolerance_percent < 0) {
+    usage(argv);
+    exit(2);
+  }
+  const char *suite_file = argv[optind];
+  std::string baseline_file = argv[optind + 1],
+              log = (results_file.empty() ? baseline_file : results_file) + ".log";
+
+  Suite suite = read_suite(suite_file);
+  // -g overrides the suite's device
+  if (!device.empty()) {
+    suite.device = device;
+  }
+
+  // read before running, so that a bad baseline does not cost a whole suite
+  std::vector<BenchResult> baseline;
+  if (!record && !read_json(baseline_file, baseline)) {
+    fprintf(stderr, "Cannot read baseline '%s' (record one with -r)\n", baseline_file.c_str());
+    exit(2);
+  }
+  if (!record && baseline.empty()) {
+    fprintf(stderr, "Baseline '%s' has no results (record one with -r on this machine)\n",
+            baseline_file.c_str());
+    exit(2);
+  }
+
+  std::vector<BenchResult> results;
+  int status = run_suite(suite, log, results) ? 0 : 1;
+  if (!results_file.empty()) {
+    write_results(results_file, suite_file, "", results);
+  }
+  if (record) {
+    write_results(baseline_file, suite_file, "baseline", results);
+    fprintf(stderr, "Recorded %zu configurations in %s\n", results.size(), baseline_file.c_str());
+    return status;
+  }
+
+  int regressions = 0, unmatched = 0;
+  fprintf(stderr, "    %-8s %12s %12s %9s %24s %10s  %s\n", "phase", "base_ms", "now_ms",
+          "change", "MTEPS", "p", "verdict");
+  for (const BenchResult &r : results) {
+    const BenchResult *base = nullptr;
+    for (const BenchResult &b : baseline) {
+      if (same_configuration(b, r)) {
+        base = &b;
+        break;
+      }
+    }
+    fprintf(stderr, "%s on %s (%s, wg=%s)\n", r.app.c_str(), r.graph.c_str(),
+            r.backend.c_str(), r.work_groups.c_str());
+    if (!base) {
+      fprintf(stderr, "    no baseline\n");
+      ++unmatched;
+      continue;
+    }
+    if (base->device != r.device) {
+      fprintf(stderr, "    warning: baseline was run on '%s', not '%s'\n",
+              base->device.c_str(), r.device.c_str());
+    }
+    regressions += compare_phase("compute", base->samples_ms, r.samples_ms, r.edges,
+                                 alpha, tolerance_percent / 100);
+    regressions += compare_phase("upload", base->upload_samples_ms, r.upload_samples_ms, 0,
+                                 alpha, tolerance_percent / 100);
+  }
+
+  if (regressions > 0) {
+    fprintf(stderr, "%d phases regressed (p < %g and more than %g%% slower)\n",
+            regressions, alpha, tolerance_percent);
+    status = 1;
+  }
+  if (unmatched > 0) {
+    fprintf(stderr, "%d configurations have no baseline in %s (record one with -r)\n",
+            unmatched, baseline_file.c_str());
+    return 2;
+  }
+  if (status == 0) {
+    fprintf(stderr, "No regressions\n");
+  }
+  return status;
+}
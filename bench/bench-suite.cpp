@@ -0,0 +1,124 @@
+/**
+ * bench-suite.cpp
+ *
+ * Runs a benchmark suite and writes every timing, with its summary
+ * statistics, to a single JSON (or CSV) results file that can be
+ * compared across commits.
+ *
+ * usage: bench-suite [-g gpunum] [-l label] [-P] suite-file results-file
+ *
+ * Each app in the suite is started once per graph with the driver's -B
+ * option, so the graph is loaded once and every work-group count is run
+ * warmups + repetitions times in the same process. External programs
+ * (e.g. the Lonestar baselines) have no such option, so they are started
+ * once per run and timed from outside, graph loading included.
+ *
+ * The suite file has one directive per line ('#' starts a comment):
+ *
+ *   graph <file.gr>             a graph to run on (may be repeated)
+ *   kronecker <scale>           a Kronecker graph of 2^scale nodes, which
+ *                               the apps generate themselves (-K)
+ *   graph_list <file>           a file of graphs, one per line
+ *   work_groups <n>[,<n>...]    work-group counts (-b) for the apps
+ *   work_group_list <file>      a file of work-group counts, one per line
+ *   repetitions <n>             timed runs per configuration
+ *   warmups <n>                 untimed runs before them
+ *   device <gpunum>             the device to run on (-g)
+ *   app <name> <binary> [args]  a driver application
+ *   external <name> <binary> [args]
+ *
+ * In args, @graph is replaced by the graph, @source by the contents of
+ * the graph's .source file (as for road-USA.gr and road-USA.source)
+ * and @device by the device number (Kronecker graphs have no file, so
+ * neither @graph nor @source can be used with them). Apps are given
+ * the graph after their arguments. Paths are relative to the working directory.
+ *
+ * The standard error of every run goes to <results-file>.log
+ *
+ * JSON results of apps also give the graph's edge count with the
+ * throughput at the median time (median_mteps), and on SYCL devices the
+ * time each run took to copy the graph onto the device
+ * (upload_samples_ms).
+ *
+ * With -P, apps are also run with -P, and the hardware counters of each
+ * phase (the PERF lines printed after each BENCH line) are added to the
+ * JSON results under "perf". The CSV results leave them out.
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// SAMPLE_CONFIDENCE
+#include "bench_stats.h"
+// read_suite run_suite write_json write_csv BenchResult
+#include "suite_runner.h"
+
+namespace {
+
+void usage(char *argv[]) {
+  fprintf(stderr, "usage: %s [-g gpunum] [-l label] [-P] suite-file results-file\n"
+                  " results-file is written as CSV if it ends in .csv, JSON otherwise\n", argv[0]);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  std::string device, label;
+  bool perf = false;
+  int c;
+  while ((c = getopt(argc, argv, "g:l:P")) != -1) {
+    switch (c) {
+      case 'g':
+        device = optarg;
+        break;
+      case 'l':
+        label = optarg;
+        break;
+      case 'P':
+        perf = true;
+        break;
+      default:
+        usage(argv);
+        exit(EXIT_FAILURE);
+    }
+  }
+  if (argc - optind != 2) {
+    usage(argv);
+    exit(EXIT_FAILURE);
+  }
+  const char *suite_file = argv[optind];
+  std::string results_file = argv[optind + 1],
+              log = results_file + ".log";
+
+  Suite suite = read_suite(suite_file);
+  // -g overrides the suite's device
+  if (!device.empty()) {
+    suite.device = device;
+  }
+  suite.perf = perf;
+
+  std::vector<BenchResult> results;
+  int status = run_suite(suite, log, results) ? 0 : 1;
+
+  FILE *f = fopen(results_file.c_str(), "w");
+  if (!f) {
+    fail("Cannot write results to '%s'", results_file);
+  }
+  bool csv = results_file.size() >= 4
+             && results_file.compare(results_file.size() - 4, 4, ".csv") == 0;
+  if (csv) {
+    write_csv(f, results);
+  } else {
+    write_json(f, suite_file, label, results);
+  }
+  fclose(f);
+
+  for (const BenchResult &r : results) {
+    fprintf(stderr, "%-24s %-28s wg=%-4s median %10.3f ms  %.0f%% CI [%.3f, %.3f]  MAD %.3f\n",
+            r.app.c_str(), r.graph.c_str(), r.work_groups.c_str(), r.summary.median,
+            100 * SAMPLE_CONFIDENCE, r.summary.ci_low, r.summary.ci_high, r.summary.mad);
+  }
+  return status;
+}
@@ -0,0 +1,523 @@
+/**
+ * microbench-primitives.cpp
+ *
+ * Microbenchmarks of the worklist and scheduling primitives of
+ * libsyclutils, each driven in isolation on synthetic inputs, so that a
+ * change in an application's time can be attributed to one of them.
+ *
+ * usage: microbench-primitives [-g gpunum] [-p primitives] [-b work-groups]
+ *                              [-f frontier-sizes] [-u duplicate-rates]
+ *                              [-d degrees] [-n nodes] [-m max-edges]
+ *                              [-r reps] [-w warmups]
+ *
+ * Every option but -g, -n, -m, -r and -w takes a comma-separated list,
+ * and every combination is run. The primitives are
+ *
+ *   push      OutWorklist::push of every frontier entry      (pushes/s)
+ *   compress  Pipe::compress without de-duping                (entries/s)
+ *   dedupe    Pipe::compress with de-duping                   (entries/s)
+ *   schedule  PushScheduler over the frontier's out-edges     (edges/s)
+ *             with an operator which only writes node data
+ *
+ * so the cost of de-duping is the difference between dedupe and compress.
+ * A frontier of -f entries is drawn from the -n nodes; with duplicate
+ * rate u each entry repeats an earlier one with probability u.
+ *
+ * For schedule, -d gives the out-degree of every node of the synthetic
+ * graph, either a constant or pl:<alpha> for power-law degrees with
+ * exponent alpha. Constant degrees >= THREAD_BLOCK_SIZE, >= WARP_SIZE and
+ * below WARP_SIZE exercise only the group, warp and fine-grained phase
+ * respectively. Graphs stop growing at -m edges.
+ *
+ * push and schedule are single kernels, timed by profiling events;
+ * compress and dedupe are several kernels each, timed by the host.
+ * One row per configuration is printed to stdout.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include <CL/sycl.hpp>
+
+// From libsyclutils
+//
+// summarize_samples SampleSummary
+#include "bench_stats.h"
+// THREAD_BLOCK_SIZE WARP_SIZE
+#include "kernel_sizing.h"
+// NVIDIA_Selector
+#include "nvidia_selector.h"
+// SYCL_CSR_Graph Host_CSR_Graph index_type
+#include "sycl_csr_graph.h"
+// Pipe gpu_size_t
+#include "pipe.h"
+// OutWorklist
+#include "out_worklist.h"
+// PushScheduler
+#include "push_scheduler.h"
+
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class MicrobenchPush;
+
+namespace {
+
+const uint64_t SEED = 1;
+// power-law degrees are capped at this
+const index_type MAX_POWER_LAW_DEGREE = 1 << 16;
+
+struct Options {
+  std::vector<std::string> primitives = {"push", "compress", "dedupe", "schedule"},
+                           degrees = {"4", "64", "512", "pl:2.1"};
+  std::vector<size_t> work_groups = {4, 16, 64},
+                      frontier_sizes = {1 << 12, 1 << 16, 1 << 20};
+  std::vector<double> duplicate_rates = {0, 0.5};
+  size_t nnodes = 1 << 22, max_edges = 1 << 26;
+  unsigned repetitions = 10, warmups = 2;
+  int device = -1;
+};
+
+/** The times of one configuration, and how many items each run handled */
+struct Measurement {
+  std::vector<double> samples_ms;
+  double items;
+};
+
+std::vector<std::string> split(const char *list) {
+  std::vector<std::string> words;
+  std::string word;
+  for (const char *c = list;; ++c) {
+    if (*c == ',' || *c == '\0') {
+      if (!word.empty()) {
+        words.push_back(word);
+      }
+      word.clear();
+      if (*c == '\0') {
+        return words;
+      }
+    } else {
+      word += *c;
+    }
+  }
+}
+
+size_t parse_count(const std::string &word, char option) {
+  char *end;
+  errno = 0;
+  size_t count = strtoull(word.c_str(), &end, 10);
+  if (errno != 0 || *end != '\0' || end == word.c_str()) {
+    fprintf(stderr, "Invalid -%c value '%s'. An integer must be specified.\n", option, word.c_str());
+    exit(EXIT_FAILURE);
+  }
+  return count;
+}
+
+double parse_rate(const std::string &word) {
+  char *end;
+  double rate = strtod(word.c_str(), &end);
+  if (*end != '\0' || end == word.c_str() || rate < 0 || rate >= 1) {
+    fprintf(stderr, "Invalid duplicate rate '%s'. A number in [0, 1) must be specified.\n", word.c_str());
+    exit(EXIT_FAILURE);
+  }
+  return rate;
+}
+
+/**
+ * @return *size* nodes in [0, nnodes), each a repeat of an earlier one
+ *         with probability *duplicate_rate* and otherwise a node not
+ *         drawn before (until every node has been drawn)
+ */
+std::vector<index_type> make_frontier(size_t size, index_type nnodes, double duplicate_rate) {
+  std::mt19937_64 rng(SEED);
+  std::vector<index_type> fresh(nnodes);
+  for (index_type node = 0; node < nnodes; ++node) {
+    fresh[node] = node;
+  }
+  std::shuffle(fresh.begin(), fresh.end(), rng);
+  std::uniform_real_distribution<double> coin(0, 1);
+  std::vector<index_type> frontier(size);
+  size_t num_fresh = 0;
+  for (size_t i = 0; i < size; ++i) {
+    if (i > 0 && coin(rng) < duplicate_rate) {
+      frontier[i] = frontier[std::uniform_int_distribution<size_t>(0, i - 1)(rng)];
+    } else {
+      frontier[i] = fresh[num_fresh++ % nnodes];
+    }
+  }
+  return frontier;
+}
+
+/**
+ * Fill *graph* with at most *max_nodes* nodes whose out-degrees follow
+ * *degree* (a constant, or pl:<alpha>), and uniformly random destinations.
+ * Stops adding nodes once *max_edges* would be exceeded.
+ */
+void make_graph(Host_CSR_Graph &graph, const std::string &degree,
+                index_type max_nodes, index_type max_edges) {
+  std::mt19937_64 rng(SEED);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  double alpha = 0;
+  index_type constant_degree = 0;
+  if (degree.compare(0, 3, "pl:") == 0) {
+    alpha = atof(degree.c_str() + 3);
+    if (alpha <= 1) {
+      fprintf(stderr, "Invalid power-law exponent '%s'. It must be greater than 1.\n", degree.c_str());
+      exit(EXIT_FAILURE);
+    }
+  } else {
+    constant_degree = parse_count(degree, 'd');
+    if (constant_degree == 0) {
+      fprintf(stderr, "Invalid degree '0'. Every node needs an out-edge.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  std::vector<index_type> degrees;
+  index_type nedges = 0;
+  while (degrees.size() < max_nodes) {
+    index_type d = constant_degree;
+    if (alpha > 0) {
+      // inverse transform sampling of P(d) ~ d^-alpha for d >= 1
+      d = std::min((index_type) std::pow(1 - uniform(rng), -1 / (alpha - 1)), MAX_POWER_LAW_DEGREE);
+    }
+    if (nedges + d > max_edges) {
+      break;
+    }
+    degrees.push_back(d);
+    nedges += d;
+  }
+  if (degrees.empty()) {
+    fprintf(stderr, "Degree %s does not fit in %zu edges.\n", degree.c_str(), (size_t) max_edges);
+    exit(EXIT_FAILURE);
+  }
+
+  graph.release();
+  graph.nnodes = degrees.size();
+  graph.nedges = nedges;
+  if (!graph.row_start.allocate(graph.nnodes + 1, HOST_ACCESS_NORMAL)
+      || !graph.edge_dst.allocate(nedges, HOST_ACCESS_SEQUENTIAL)
+      || !graph.node_data.allocate(graph.nnodes, HOST_ACCESS_RANDOM)) {
+    fprintf(stderr, "Out of memory building a graph of %zu edges.\n", (size_t) nedges);
+    exit(EXIT_FAILURE);
+  }
+  std::uniform_int_distribution<index_type> destination(0, graph.nnodes - 1);
+  for (index_type node = 0; node < graph.nnodes; ++node) {
+    graph.row_start[node + 1] = graph.row_start[node] + degrees[node];
+  }
+  for (index_type edge = 0; edge < nedges; ++edge) {
+    graph.edge_dst[edge] = destination(rng);
+  }
+}
+
+/** @return the time between the start and end of *event*'s command */
+double event_ms(sycl::event &event) {
+  event.wait();
+  auto start = event.get_profiling_info<sycl::info::event_profiling::command_start>(),
+       end = event.get_profiling_info<sycl::info::event_profiling::command_end>();
+  return (end - start) / 1e6;
+}
+
+/**
+ * Reset *pipe* and push every entry of *items* onto its out-worklist,
+ * each work-item pushing every NUM_WORK_ITEMS-th entry
+ */
+sycl::event push_items(sycl::queue &queue, Pipe &pipe, sycl::buffer<index_type, 1> &items_buf,
+                       size_t num_items, size_t num_work_groups) {
+  pipe.initialize(queue);
+  return queue.submit([&](sycl::handler &cgh) {
+    OutWorklist out_wl(pipe, cgh);
+    auto items = items_buf.get_access<sycl::access::mode::read>(cgh);
+    const gpu_size_t NUM_ITEMS = num_items,
+                     WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                     NUM_WORK_ITEMS = num_work_groups * WORK_GROUP_SIZE;
+    cgh.parallel_for<class MicrobenchPush>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                             sycl::range<1>{WORK_GROUP_SIZE}},
+    [=](sycl::nd_item<1> my_item) {
+      if (my_item.get_local_id()[0] == 0) {
+        out_wl.initializeLocalMemory(my_item);
+      }
+      my_item.barrier(sycl::access::fence_space::local_space);
+      for (gpu_size_t i = my_item.get_global_id()[0]; i < NUM_ITEMS; i += NUM_WORK_ITEMS) {
+        out_wl.push(items[i]);
+      }
+      my_item.barrier(sycl::access::fence_space::local_space);
+      if (my_item.get_local_id()[0] == 0) {
+        out_wl.publishLocalMemory(my_item);
+      }
+    });
+  });
+}
+
+/**
+ * Time *primitive* ("push", "compress" or "dedupe") on *frontier*
+ */
+Measurement run_worklist_primitive(sycl::queue &queue, const std::string &primitive,
+                                   const std::vector<index_type> &frontier, index_type nnodes,
+                                   size_t num_work_groups, const Options &opts) {
+  const size_t num_work_items = num_work_groups * THREAD_BLOCK_SIZE;
+  // enough room that no group's portion of the out-worklist fills up
+  size_t capacity = (frontier.size() + num_work_items - 1) / num_work_items * num_work_items;
+  Pipe pipe{(gpu_size_t) capacity, (gpu_size_t) nnodes, (gpu_size_t) num_work_groups};
+  sycl::buffer<index_type, 1> items_buf{frontier.data(), sycl::range<1>{frontier.size()}};
+
+  Measurement m;
+  m.items = frontier.size();
+  for (unsigned run = 0; run < opts.warmups + opts.repetitions; ++run) {
+    sycl::event pushed = push_items(queue, pipe, items_buf, frontier.size(), num_work_groups);
+    double ms;
+    if (primitive == "push") {
+      ms = event_ms(pushed);
+    } else {
+      queue.wait_and_throw();
+      auto start = std::chrono::high_resolution_clock::now();
+      pipe.compress(queue, primitive == "dedupe");
+      queue.wait_and_throw();
+      auto end = std::chrono::high_resolution_clock::now();
+      ms = std::chrono::duration<double, std::milli>(end - start).count();
+    }
+    if (run >= opts.warmups) {
+      m.samples_ms.push_back(ms);
+    }
+  }
+  return m;
+}
+
+struct SinkOperatorInfo {
+  sycl::accessor<node_data_type, 1,
+                 sycl::access::mode::read_write,
+                 sycl::access::target::global_buffer>
+                     node_data;
+  /** Called at start of push scheduling */
+  void initialize(const sycl::nd_item<1> &my_item) { }
+
+  SinkOperatorInfo(SYCL_CSR_Graph &sycl_graph, sycl::handler &cgh)
+      : node_data{ sycl_graph.node_data, cgh }
+  { }
+  /** We must provide a copy constructor */
+  SinkOperatorInfo(const SinkOperatorInfo &that)
+      : node_data{ that.node_data }
+  { }
+};
+
+// Reads each edge's destination and writes its node data, so that the
+// time is the scheduler's and not the operator's
+class SinkIter : public PushScheduler<SinkIter, SinkOperatorInfo> {
+  public:
+  SinkIter(gpu_size_t num_work_groups,
+           SYCL_CSR_Graph &sycl_graph, Pipe &pipe, sycl::handler &cgh,
+           sycl::buffer<bool, 1> &out_worklist_needs_compression,
+           SinkOperatorInfo &opInfo)
+      : PushScheduler{num_work_groups, sycl_graph, pipe, cgh, out_worklist_needs_compression, opInfo}
+  { }
+
+  void applyPushOperator(const sycl::nd_item<1>&,
+                         index_type src_node,
+                         index_type edge_index)
+  {
+    if (edge_index >= NEDGES) return;
+    opInfo.node_data[edge_dst[edge_index]] = src_node;
+  }
+};
+
+/**
+ * Time one PushScheduler kernel over the out-edges of *frontier*
+ */
+Measurement run_schedule(sycl::queue &queue, Host_CSR_Graph &graph, SYCL_CSR_Graph &sycl_graph,
+                         const std::vector<index_type> &frontier, size_t num_work_groups,
+                         const Options &opts) {
+  const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+               NUM_WORK_ITEMS = num_work_groups * WORK_GROUP_SIZE;
+  Pipe pipe{(gpu_size_t) frontier.size(), (gpu_size_t) graph.nnodes, (gpu_size_t) num_work_groups};
+  pipe.initialize(queue);
+  queue.submit([&](sycl::handler &cgh) {
+    auto in_wl = pipe.get_in_worklist_buf().get_access<sycl::access::mode::write>(cgh, sycl::range<1>{frontier.size()});
+    cgh.copy(frontier.data(), in_wl);
+  });
+  {
+    auto in_wl_size = pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::write>();
+    in_wl_size[0] = frontier.size();
+  }
+  bool needs_compression = false;
+  sycl::buffer<bool, 1> needs_compression_buf(&needs_compression, sycl::range<1>{1});
+
+  Measurement m;
+  m.items = 0;
+  for (index_type node : frontier) {
+    m.items += graph.row_start[node + 1] - graph.row_start[node];
+  }
+  for (unsigned run = 0; run < opts.warmups + opts.repetitions; ++run) {
+    sycl::event event = queue.submit([&](sycl::handler &cgh) {
+      SinkOperatorInfo sinkInfo{ sycl_graph, cgh };
+      SinkIter iter(num_work_groups, sycl_graph, pipe, cgh, needs_compression_buf, sinkInfo);
+      cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                         sycl::range<1>{WORK_GROUP_SIZE}},
+                       iter);
+    });
+    double ms = event_ms(event);
+    if (run >= opts.warmups) {
+      m.samples_ms.push_back(ms);
+    }
+  }
+  return m;
+}
+
+void print_row(const std::string &primitive, size_t work_groups, size_t frontier_size,
+               const std::string &degree, double duplicate_rate, const Measurement &m,
+               const char *unit) {
+  SampleSummary s = summarize_samples(m.samples_ms);
+  printf("%-9s %11zu %9zu %7s %8.2f %10.4f %10.4f %10.4f %12.4e %s\n",
+         primitive.c_str(), work_groups, frontier_size, degree.c_str(), duplicate_rate,
+         s.median, s.ci_low, s.ci_high, s.median > 0 ? m.items / (s.median / 1e3) : 0.0, unit);
+  fflush(stdout);
+}
+
+void usage(char *argv[]) {
+  fprintf(stderr, "usage: %s [-g gpunum] [-p push,compress,dedupe,schedule] [-b work-groups] "
+                  "[-f frontier-sizes] [-u duplicate-rates] [-d degrees] [-n nodes] "
+                  "[-m max-edges] [-r reps] [-w warmups]\n"
+                  " lists are comma-separated; degrees are constants or pl:<alpha>\n", argv[0]);
+}
+
+Options parse_args(int argc, char *argv[]) {
+  Options opts;
+  int c;
+  while ((c = getopt(argc, argv, "g:p:b:f:u:d:n:m:r:w:")) != -1) {
+    switch (c) {
+      case 'g':
+        opts.device = parse_count(optarg, 'g');
+        break;
+      case 'p':
+        opts.primitives = split(optarg);
+        for (const std::string &p : opts.primitives) {
+          if (p != "push" && p != "compress" && p != "dedupe" && p != "schedule") {
+            fprintf(stderr, "Invalid primitive '%s'.\n", p.c_str());
+            exit(EXIT_FAILURE);
+          }
+        }
+        break;
+      case 'b':
+        opts.work_groups.clear();
+        for (const std::string &w : split(optarg)) {
+          opts.work_groups.push_back(parse_count(w, 'b'));
+        }
+        break;
+      case 'f':
+        opts.frontier_sizes.clear();
+        for (const std::string &f : split(optarg)) {
+          opts.frontier_sizes.push_back(parse_count(f, 'f'));
+        }
+        break;
+      case 'u':
+        opts.duplicate_rates.clear();
+        for (const std::string &u : split(optarg)) {
+          opts.duplicate_rates.push_back(parse_rate(u));
+        }
+        break;
+      case 'd':
+        opts.degrees = split(optarg);
+        break;
+      case 'n':
+        opts.nnodes = parse_count(optarg, 'n');
+        break;
+      case 'm':
+        opts.max_edges = parse_count(optarg, 'm');
+        break;
+      case 'r':
+        opts.repetitions = parse_count(optarg, 'r');
+        break;
+      case 'w':
+        opts.warmups = parse_count(optarg, 'w');
+        break;
+      default:
+        usage(argv);
+        exit(EXIT_FAILURE);
+    }
+  }
+  if (optind != argc || opts.repetitions == 0 || opts.nnodes == 0 || opts.nnodes >= UINT32_MAX
+      || opts.work_groups.empty() || opts.frontier_sizes.empty() || opts.duplicate_rates.empty()) {
+    usage(argv);
+    exit(EXIT_FAILURE);
+  }
+  return opts;
+}
+
+void run_all(sycl::queue &queue, const Options &opts) {
+  printf("%-9s %11s %9s %7s %8s %10s %10s %10s %12s %s\n", "primitive", "work_groups",
+         "frontier", "degree", "dup_rate", "median_ms", "ci_low_ms", "ci_high_ms",
+         "throughput", "unit");
+  for (const std::string &primitive : opts.primitives) {
+    if (primitive != "schedule") {
+      const char *unit = primitive == "push" ? "pushes/s" : "entries/s";
+      for (size_t frontier_size : opts.frontier_sizes) {
+        for (double rate : opts.duplicate_rates) {
+          std::vector<index_type> frontier = make_frontier(frontier_size, opts.nnodes, rate);
+          for (size_t work_groups : opts.work_groups) {
+            Measurement m = run_worklist_primitive(queue, primitive, frontier, opts.nnodes,
+                                                   work_groups, opts);
+            print_row(primitive, work_groups, frontier_size, "-", rate, m, unit);
+          }
+        }
+      }
+      continue;
+    }
+    for (const std::string &degree : opts.degrees) {
+      Host_CSR_Graph graph;
+      make_graph(graph, degree, opts.nnodes, opts.max_edges);
+      fprintf(stderr, "degree %s: %zu nodes, %zu edges\n", degree.c_str(),
+              (size_t) graph.nnodes, (size_t) graph.nedges);
+      SYCL_CSR_Graph sycl_graph(&graph);
+      for (size_t frontier_size : opts.frontier_sizes) {
+        for (double rate : opts.duplicate_rates) {
+          std::vector<index_type> frontier = make_frontier(frontier_size, graph.nnodes, rate);
+          for (size_t work_groups : opts.work_groups) {
+            Measurement m = run_schedule(queue, graph, sycl_graph, frontier, work_groups, opts);
+            print_row(primitive, work_groups, frontier_size, degree, rate, m, "edges/s");
+          }
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  Options opts = parse_args(argc, argv);
+
+  auto exception_handler = [] (sycl::exception_list exceptions) {
+    for (std::exception_ptr const& e : exceptions) {
+      try {
+        std::rethrow_exception(e);
+      } catch(sycl::exception const& e) {
+        std::cerr << "Caught asynchronous SYCL exception:\n" << e.what() << std::endl;
+        std::exit(1);
+      }
+    }
+  };
+  try {
+    sycl::property_list prop_list{sycl::property::queue::enable_profiling()};
+    if (opts.device < 0) {
+      sycl::default_selector dev_selector;
+      sycl::queue queue(dev_selector, exception_handler, prop_list);
+      fprintf(stderr, "Running on %s\n", queue.get_device().get_info<sycl::info::device::name>().c_str());
+      run_all(queue, opts);
+    } else {
+      NVIDIA_Selector dev_selector(opts.device);
+      sycl::queue queue(dev_selector, exception_handler, prop_list);
+      fprintf(stderr, "Running on %s\n", queue.get_device().get_info<sycl::info::device::name>().c_str());
+      run_all(queue, opts);
+    }
+  } catch (sycl::exception const& e) {
+    std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+    std::exit(1);
+  }
+  return 0;
+}
@@ -0,0 +1,548 @@
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+// summarize_samples SampleSummary SAMPLE_CONFIDENCE
+#include "bench_stats.h"
+// Suite SuiteEntry BenchResult
+#include "suite_runner.h"
+
+// graphs named "kronecker:<scale>" are generated by the driver's -K
+static const std::string KRONECKER_PREFIX = "kronecker:";
+
+void fail(const char *format, const std::string &what) {
+  fprintf(stderr, format, what.c_str());
+  fprintf(stderr, "\n");
+  exit(EXIT_FAILURE);
+}
+
+/** Append the non-empty, non-comment lines of *file* to *lines* */
+static void read_list(const std::string &file, std::vector<std::string> &lines) {
+  std::ifstream in(file);
+  if (!in) {
+    fail("Cannot read list '%s'", file);
+  }
+  std::string line;
+  while (std::getline(in, line)) {
+    std::istringstream words(line);
+    std::string word;
+    if (words >> word && word[0] != '#') {
+      lines.push_back(word);
+    }
+  }
+}
+
+Suite read_suite(const char *file) {
+  std::ifstream in(file);
+  if (!in) {
+    fail("Cannot read suite '%s'", file);
+  }
+  Suite suite;
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream words(line);
+    std::string directive, value;
+    if (!(words >> directive)) {
+      continue;
+    }
+    if (!(words >> value)) {
+      fail("Missing value in suite line '%s'", line);
+    }
+    if (directive == "graph") {
+      suite.graphs.push_back(value);
+    } else if (directive == "kronecker") {
+      suite.graphs.push_back(KRONECKER_PREFIX + value);
+    } else if (directive == "graph_list") {
+      read_list(value, suite.graphs);
+    } else if (directive == "work_groups") {
+      std::istringstream counts(value);
+      std::string count;
+      while (std::getline(counts, count, ',')) {
+        suite.work_groups.push_back(count);
+      }
+    } else if (directive == "work_group_list") {
+      read_list(value, suite.work_groups);
+    } else if (directive == "repetitions") {
+      suite.repetitions = atoi(value.c_str());
+    } else if (directive == "warmups") {
+      suite.warmups = atoi(value.c_str());
+    } else if (directive == "device") {
+      suite.device = value;
+    } else if (directive == "app" || directive == "external") {
+      SuiteEntry entry;
+      entry.name = value;
+      entry.external = directive == "external";
+      if (!(words >> entry.binary)) {
+        fail("Missing binary in suite line '%s'", line);
+      }
+      std::string arg;
+      while (words >> arg) {
+        entry.args.push_back(arg);
+      }
+      suite.entries.push_back(entry);
+    } else {
+      fail("Unknown suite directive '%s'", directive);
+    }
+  }
+  if (suite.repetitions == 0) {
+    fail("%s: repetitions must be positive", file);
+  }
+  if (suite.work_groups.empty()) {
+    suite.work_groups.push_back("4");
+  }
+  return suite;
+}
+
+/** Quote *word* for /bin/sh */
+static std::string shell_quote(const std::string &word) {
+  std::string quoted = "'";
+  for (char c : word) {
+    quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  }
+  return quoted + "'";
+}
+
+/**
+ * @return true if *graph* is generated by the driver (with -K *scale*)
+ *         rather than read from a file
+ */
+static bool kronecker_scale(const std::string &graph, std::string &scale) {
+  if (graph.compare(0, KRONECKER_PREFIX.size(), KRONECKER_PREFIX) != 0) {
+    return false;
+  }
+  scale = graph.substr(KRONECKER_PREFIX.size());
+  return true;
+}
+
+/** Replace @graph, @source and @device in *arg* */
+static std::string expand_arg(const std::string &arg, const std::string &graph, const Suite &suite) {
+  std::string scale;
+  if ((arg == "@graph" || arg == "@source") && kronecker_scale(graph, scale)) {
+    fail("%s has no graph file for @graph or @source", graph);
+  }
+  if (arg == "@graph") {
+    return graph;
+  }
+  if (arg == "@device") {
+    return suite.device.empty() ? "0" : suite.device;
+  }
+  if (arg == "@source") {
+    std::string base = graph;
+    if (base.size() > 3 && base.compare(base.size() - 3, 3, ".gr") == 0) {
+      base.resize(base.size() - 3);
+    }
+    std::ifstream in(base + ".source");
+    std::string source;
+    if (!(in >> source)) {
+      fail("Cannot read source node from '%s'", base + ".source");
+    }
+    return source;
+  }
+  return arg;
+}
+
+/** Split "a,b,c" into doubles */
+static std::vector<double> parse_samples(const std::string &list) {
+  std::vector<double> samples;
+  std::istringstream in(list);
+  std::string sample;
+  while (std::getline(in, sample, ',')) {
+    samples.push_back(atof(sample.c_str()));
+  }
+  return samples;
+}
+
+/**
+ * Run *entry* on *graph* with -B and collect a result from each BENCH
+ * line it prints
+ *
+ * @return false if it exited unsuccessfully
+ */
+static bool run_app(const SuiteEntry &entry, const std::string &graph, const Suite &suite,
+                    const std::string &log, std::vector<BenchResult> &results) {
+  std::string work_groups;
+  for (const std::string &count : suite.work_groups) {
+    work_groups += (work_groups.empty() ? "" : ",") + count;
+  }
+  std::string command = shell_quote(entry.binary)
+      + " -B " + std::to_string(suite.repetitions) + ":" + std::to_string(suite.warmups)
+      + " -b " + shell_quote(work_groups);
+  if (!suite.device.empty()) {
+    command += " -g " + shell_quote(suite.device);
+  }
+  if (suite.perf) {
+    command += " -P";
+  }
+  for (const std::string &arg : entry.args) {
+    command += " " + shell_quote(expand_arg(arg, graph, suite));
+  }
+  std::string scale;
+  command += kronecker_scale(graph, scale) ? " -K " + shell_quote(scale) : " " + shell_quote(graph);
+  command += " 2>>" + shell_quote(log);
+
+  FILE *out = popen(command.c_str(), "r");
+  if (!out) {
+    fail("Cannot run '%s'", command);
+  }
+  char buffer[1 << 16];
+  // PERF lines belong to this run's last BENCH line
+  size_t first_result = results.size();
+  while (fgets(buffer, sizeof(buffer), out)) {
+    bool perf = strncmp(buffer, "PERF ", 5) == 0;
+    if (!perf && strncmp(buffer, "BENCH ", 6) != 0) {
+      continue;
+    }
+    std::map<std::string, std::string> fields;
+    std::istringstream words(buffer + (perf ? 5 : 6));
+    std::string word;
+    while (words >> word) {
+      size_t eq = word.find('=');
+      if (eq != std::string::npos) {
+        fields[word.substr(0, eq)] = word.substr(eq + 1);
+      }
+    }
+    if (perf) {
+      if (results.size() > first_result) {
+        std::string phase = fields["phase"];
+        fields.erase("phase");
+        results.back().perf[phase] = fields;
+      }
+      continue;
+    }
+    BenchResult result;
+    result.graph = graph;
+    result.app = entry.name;
+    result.timing = "kernel";
+    result.backend = fields["backend"];
+    result.device = fields["device"];
+    result.work_groups = fields["work_groups"];
+    result.edges = strtoull(fields["edges"].c_str(), nullptr, 10);
+    result.samples_ms = parse_samples(fields["samples_ms"]);
+    result.upload_samples_ms = parse_samples(fields["upload_ms"]);
+    result.summary = summarize_samples(result.samples_ms);
+    results.push_back(result);
+  }
+  return pclose(out) == 0;
+}
+
+/**
+ * Run *entry* on *graph* warmups + repetitions times, timing each
+ * process from start to exit
+ *
+ * @return false if any run exited unsuccessfully
+ */
+static bool run_external(const SuiteEntry &entry, const std::string &graph, const Suite &suite,
+                         const std::string &log, std::vector<BenchResult> &results) {
+  std::string command = shell_quote(entry.binary);
+  for (const std::string &arg : entry.args) {
+    command += " " + shell_quote(expand_arg(arg, graph, suite));
+  }
+  command += " >>" + shell_quote(log) + " 2>&1";
+
+  BenchResult result;
+  result.graph = graph;
+  result.app = entry.name;
+  result.timing = "process";
+  result.backend = "external";
+  result.device = suite.device.empty() ? "0" : suite.device;
+  bool ok = true;
+  for (unsigned run = 0; run < suite.warmups + suite.repetitions; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    ok = system(command.c_str()) == 0 && ok;
+    auto end = std::chrono::steady_clock::now();
+    if (run >= suite.warmups) {
+      result.samples_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+  }
+  result.summary = summarize_samples(result.samples_ms);
+  results.push_back(result);
+  return ok;
+}
+
+static std::string json_string(const std::string &s) {
+  std::string quoted = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+    }
+    quoted += c;
+  }
+  return quoted + "\"";
+}
+
+void write_json(FILE *f, const char *suite_file, const std::string &label,
+                const std::vector<BenchResult> &results) {
+  fprintf(f, "{\n  \"suite\": %s,\n  \"label\": %s,\n  \"confidence\": %.2f,\n  \"results\": [",
+          json_string(suite_file).c_str(), json_string(label).c_str(), SAMPLE_CONFIDENCE);
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult &r = results[i];
+    const SampleSummary &s = r.summary;
+    fprintf(f, "%s\n    {\"graph\": %s, \"app\": %s, \"timing\": \"%s\", \"backend\": %s, "
+               "\"device\": %s, \"work_groups\": %s,\n     \"count\": %zu, \"median_ms\": %.6f, "
+               "\"mad_ms\": %.6f, \"ci_low_ms\": %.6f, \"ci_high_ms\": %.6f, "
+               "\"min_ms\": %.6f, \"max_ms\": %.6f,\n     \"samples_ms\": [",
+            i ? "," : "", json_string(r.graph).c_str(), json_string(r.app).c_str(), r.timing.c_str(),
+            json_string(r.backend).c_str(), json_string(r.device).c_str(),
+            json_string(r.work_groups).c_str(), s.count, s.median, s.mad,
+            s.ci_low, s.ci_high, s.min, s.max);
+    for (size_t j = 0; j < r.samples_ms.size(); ++j) {
+      fprintf(f, "%s%.6f", j ? ", " : "", r.samples_ms[j]);
+    }
+    fprintf(f, "]");
+    // millions of graph edges per second, at the median time
+    if (r.edges > 0) {
+      fprintf(f, ",\n     \"edges\": %zu, \"median_mteps\": %.6f", r.edges,
+              s.median > 0 ? r.edges / s.median / 1e3 : 0.0);
+    }
+    if (!r.upload_samples_ms.empty()) {
+      fprintf(f, ",\n     \"upload_samples_ms\": [");
+      for (size_t j = 0; j < r.upload_samples_ms.size(); ++j) {
+        fprintf(f, "%s%.6f", j ? ", " : "", r.upload_samples_ms[j]);
+      }
+      fprintf(f, "]");
+    }
+    // counts are totals over the phase's runs
+    if (!r.perf.empty()) {
+      fprintf(f, ",\n     \"perf\": {");
+      const char *phase_sep = "";
+      for (const auto &phase : r.perf) {
+        fprintf(f, "%s%s: {", phase_sep, json_string(phase.first).c_str());
+        const char *field_sep = "";
+        for (const auto &field : phase.second) {
+          fprintf(f, "%s%s: %s", field_sep, json_string(field.first).c_str(), field.second.c_str());
+          field_sep = ", ";
+        }
+        fprintf(f, "}");
+        phase_sep = ", ";
+      }
+      fprintf(f, "}");
+    }
+    fprintf(f, "}");
+  }
+  fprintf(f, "\n  ]\n}\n");
+}
+
+void write_csv(FILE *f, const std::vector<BenchResult> &results) {
+  fprintf(f, "graph,app,timing,backend,device,work_groups,count,median_ms,mad_ms,"
+             "ci_low_ms,ci_high_ms,min_ms,max_ms,samples_ms\n");
+  for (const BenchResult &r : results) {
+    const SampleSummary &s = r.summary;
+    fprintf(f, "%s,%s,%s,%s,%s,%s,%zu,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,",
+            r.graph.c_str(), r.app.c_str(), r.timing.c_str(), r.backend.c_str(), r.device.c_str(),
+            r.work_groups.c_str(), s.count, s.median, s.mad, s.ci_low, s.ci_high, s.min, s.max);
+    // samples are ';'-separated to stay in one column
+    for (size_t j = 0; j < r.samples_ms.size(); ++j) {
+      fprintf(f, "%s%.6f", j ? ";" : "", r.samples_ms[j]);
+    }
+    fprintf(f, "\n");
+  }
+}
+
+bool run_suite(const Suite &suite, const std::string &log, std::vector<BenchResult> &results) {
+  bool ok = true;
+  for (const std::string &graph : suite.graphs) {
+    for (const SuiteEntry &entry : suite.entries) {
+      fprintf(stderr, "Running %s on %s\n", entry.name.c_str(), graph.c_str());
+      bool entry_ok = entry.external ? run_external(entry, graph, suite, log, results)
+                                     : run_app(entry, graph, suite, log, results);
+      if (!entry_ok) {
+        fprintf(stderr, "  %s failed on %s (see %s)\n", entry.name.c_str(), graph.c_str(), log.c_str());
+        ok = false;
+      }
+    }
+  }
+  return ok;
+}
+
+namespace {
+
+/**
+ * Just enough of a JSON reader for the results write_json writes:
+ * values are read as they are needed, and anything else is skipped.
+ */
+class JsonReader {
+ public:
+  explicit JsonReader(const std::string &text) : text(text) {}
+
+  /** @return true (and consume it) if the next token is *c* */
+  bool accept(char c) {
+    skip_space();
+    if (pos < text.size() && text[pos] == c) {
+      ++pos;
+      return true;
+    }
+    return false;
+  }
+
+  void expect(char c) {
+    if (!accept(c)) {
+      throw pos;
+    }
+  }
+
+  std::string read_string() {
+    expect('"');
+    std::string s;
+    while (pos < text.size() && text[pos] != '"') {
+      if (text[pos] == '\\' && pos + 1 < text.size()) {
+        ++pos;
+      }
+      s += text[pos++];
+    }
+    expect('"');
+    return s;
+  }
+
+  double read_number() {
+    skip_space();
+    const char *start = text.c_str() + pos;
+    char *end;
+    double value = strtod(start, &end);
+    if (end == start) {
+      throw pos;
+    }
+    pos += end - start;
+    return value;
+  }
+
+  std::vector<double> read_numbers() {
+    std::vector<double> numbers;
+    expect('[');
+    if (accept(']')) {
+      return numbers;
+    }
+    do {
+      numbers.push_back(read_number());
+    } while (accept(','));
+    expect(']');
+    return numbers;
+  }
+
+  /** Skip a value of any type */
+  void skip_value() {
+    skip_space();
+    if (pos >= text.size()) {
+      throw pos;
+    }
+    char c = text[pos];
+    if (c == '"') {
+      read_string();
+    } else if (c == '{' || c == '[') {
+      char close = c == '{' ? '}' : ']';
+      ++pos;
+      if (accept(close)) {
+        return;
+      }
+      do {
+        if (close == '}') {
+          read_string();
+          expect(':');
+        }
+        skip_value();
+      } while (accept(','));
+      expect(close);
+    } else if (isalpha((unsigned char) c)) {
+      // true, false or null
+      while (pos < text.size() && isalpha((unsigned char) text[pos])) {
+        ++pos;
+      }
+    } else {
+      read_number();
+    }
+  }
+
+ private:
+  const std::string &text;
+  size_t pos = 0;
+
+  void skip_space() {
+    while (pos < text.size() && isspace((unsigned char) text[pos])) {
+      ++pos;
+    }
+  }
+};
+
+BenchResult read_result(JsonReader &json) {
+  BenchResult result;
+  json.expect('{');
+  if (json.accept('}')) {
+    return result;
+  }
+  do {
+    std::string key = json.read_string();
+    json.expect(':');
+    if (key == "graph") {
+      result.graph = json.read_string();
+    } else if (key == "app") {
+      result.app = json.read_string();
+    } else if (key == "timing") {
+      result.timing = json.read_string();
+    } else if (key == "backend") {
+      result.backend = json.read_string();
+    } else if (key == "device") {
+      result.device = json.read_string();
+    } else if (key == "work_groups") {
+      result.work_groups = json.read_string();
+    } else if (key == "edges") {
+      result.edges = (size_t) json.read_number();
+    } else if (key == "samples_ms") {
+      result.samples_ms = json.read_numbers();
+    } else if (key == "upload_samples_ms") {
+      result.upload_samples_ms = json.read_numbers();
+    } else {
+      json.skip_value();
+    }
+  } while (json.accept(','));
+  json.expect('}');
+  result.summary = summarize_samples(result.samples_ms);
+  return result;
+}
+
+}  // namespace
+
+bool read_json(const std::string &file, std::vector<BenchResult> &results) {
+  std::ifstream in(file);
+  if (!in) {
+    return false;
+  }
+  std::stringstream contents;
+  contents << in.rdbuf();
+  std::string text = contents.str();
+  JsonReader json(text);
+  try {
+    json.expect('{');
+    if (json.accept('}')) {
+      return true;
+    }
+    do {
+      std::string key = json.read_string();
+      json.expect(':');
+      if (key != "results") {
+        json.skip_value();
+        continue;
+      }
+      json.expect('[');
+      if (json.accept(']')) {
+        continue;
+      }
+      do {
+        results.push_back(read_result(json));
+      } while (json.accept(','));
+      json.expect(']');
+    } while (json.accept(','));
+    json.expect('}');
+  } catch (size_t pos) {
+    fprintf(stderr, "%s: malformed results at offset %zu\n", file.c_str(), pos);
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,78 @@
+/**
+ * suite_runner.h
+ *
+ * Reading and running benchmark suites, and reading and writing their
+ * results, for bench-suite and bench-gate. The suite format is
+ * described in bench-suite.cpp.
+ */
+#ifndef BREADTHNPAGEINSYCL_BENCH_SUITE_RUNNER_
+#define BREADTHNPAGEINSYCL_BENCH_SUITE_RUNNER_
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+// SampleSummary
+#include "bench_stats.h"
+
+struct SuiteEntry {
+  std::string name, binary;
+  std::vector<std::string> args;
+  // run once per sample and timed by wall clock
+  bool external;
+};
+
+struct Suite {
+  // graph files, or "kronecker:<scale>" for graphs the driver generates
+  std::vector<std::string> graphs, work_groups;
+  unsigned repetitions = 5, warmups = 1;
+  // empty for the default device
+  std::string device;
+  std::vector<SuiteEntry> entries;
+  // run apps with -P
+  bool perf = false;
+};
+
+struct BenchResult {
+  std::string graph, app, backend, device, work_groups;
+  // "kernel" (timed by the driver) or "process" (timed from outside)
+  std::string timing;
+  // edges in the graph (0 if unknown, as for externals)
+  size_t edges = 0;
+  std::vector<double> samples_ms;
+  SampleSummary summary;
+  // the time each run took to copy the graph onto the device
+  // (empty on the host backend and for externals)
+  std::vector<double> upload_samples_ms;
+  // with -P, the fields of each phase's PERF line (phase -> name -> value)
+  std::map<std::string, std::map<std::string, std::string> > perf;
+};
+
+/** Print *format* (with *what* for its %s) to stderr and exit */
+void fail(const char *format, const std::string &what);
+
+Suite read_suite(const char *file);
+
+/**
+ * Run every entry of *suite* on every graph, appending their results
+ * to *results* and the standard error of every run to *log*
+ *
+ * @return false if any run exited unsuccessfully
+ */
+bool run_suite(const Suite &suite, const std::string &log, std::vector<BenchResult> &results);
+
+void write_json(FILE *f, const char *suite_file, const std::string &label,
+                const std::vector<BenchResult> &results);
+
+void write_csv(FILE *f, const std::vector<BenchResult> &results);
+
+/**
+ * Read the results of a JSON file written by write_json (summaries
+ * are recomputed from the samples, and "perf" is skipped)
+ *
+ * @return false if *file* cannot be read or is not such a file
+ */
+bool read_json(const std::string &file, std::vector<BenchResult> &results);
+
+#endif
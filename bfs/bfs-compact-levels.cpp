@@ -0,0 +1,479 @@
+#include <cstdint>
+#include <iostream>
+#include <limits>
+
+// From libsyclutils
+//
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// THREAD_BLOCK_SIZE WARP_SIZE
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph node_data_type index_type
+#include "sycl_csr_graph.h"
+// Pipe
+#include "pipe.h"
+// BitmapFrontier InBitmap OutBitmap use_dense_frontier bitmap_word_t
+#include "bitmap_frontier.h"
+// PushScheduler INF
+#include "push_scheduler.h"
+
+// easier than typing cl::sycl
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class compact_bfs_init;
+class compact_wl_init;
+template <typename level_t> class compact_levels_init;
+template <typename from_level_t, typename to_level_t> class promote_levels;
+template <typename level_t> class expand_levels;
+
+// from support.cpp
+extern index_type start_node;
+extern size_t max_level_bound;
+
+extern size_t num_work_groups;
+
+/**
+ * Levels are stored in the narrowest of 8, 16, or 32 bits which can
+ * hold every level reached so far.
+ * Whether a node has been reached is stored separately in a visited
+ * bitmap, so every value of a level type is a valid level.
+ */
+template <typename level_t>
+struct CompactBFSOperatorInfo {
+    level_t level;
+    // true iff the frontier is stored in bitmaps instead of worklists
+    bool dense;
+    sycl::accessor<level_t, 1,
+                   sycl::access::mode::write,
+                   sycl::access::target::global_buffer>
+                       levels;
+    sycl::accessor<bitmap_word_t, 1,
+                   sycl::access::mode::atomic,
+                   sycl::access::target::global_buffer>
+                       // bit *node* is set once *node* has a level
+                       visited;
+    // dense frontiers
+    InBitmap in_bitmap;
+    OutBitmap out_bitmap;
+    /** Called at start of push scheduling */
+    void initialize(const sycl::nd_item<1> &my_item) { }
+
+    /** Constructor **/
+    CompactBFSOperatorInfo( sycl::buffer<level_t, 1> &levels_buf,
+                            sycl::buffer<bitmap_word_t, 1> &visited_buf,
+                            BitmapFrontier &frontier, sycl::handler &cgh,
+                            level_t level, bool dense )
+        : level{ level }
+        , dense{ dense }
+        , levels{ levels_buf, cgh }
+        , visited{ visited_buf, cgh }
+        , in_bitmap{ frontier, cgh }
+        , out_bitmap{ frontier, cgh }
+    { }
+    /** We must provide a copy constructor */
+    CompactBFSOperatorInfo( const CompactBFSOperatorInfo &that )
+        : level{ that.level }
+        , dense{ that.dense }
+        , levels{ that.levels }
+        , visited{ that.visited }
+        , in_bitmap{ that.in_bitmap }
+        , out_bitmap{ that.out_bitmap }
+    { }
+};
+
+
+// Define our BFS push operator
+template <typename level_t>
+class CompactBFSIter : public PushScheduler<CompactBFSIter<level_t>, CompactBFSOperatorInfo<level_t> > {
+    typedef PushScheduler<CompactBFSIter<level_t>, CompactBFSOperatorInfo<level_t> > Scheduler;
+    public:
+    CompactBFSIter(gpu_size_t num_work_groups,
+                   SYCL_CSR_Graph &sycl_graph, Pipe &pipe, sycl::handler &cgh,
+                   sycl::buffer<bool, 1> &out_worklist_needs_compression,
+                   CompactBFSOperatorInfo<level_t> &opInfo)
+        : Scheduler{num_work_groups, sycl_graph, pipe, cgh, out_worklist_needs_compression, opInfo}
+        { }
+
+    // When the frontier is dense the in-worklist holds every node,
+    // so only work on the ones in the frontier
+    bool isActive(index_type node) const {
+        return !this->opInfo.dense || this->opInfo.in_bitmap.contains(node);
+    }
+
+    void applyPushOperator(const sycl::nd_item<1>&,
+                           index_type src_node,
+                           index_type edge_index)
+    {
+        // invalid edge case
+        if(edge_index >= this->NEDGES) return;
+        // valid edge case
+        index_type dst_node = this->edge_dst[edge_index];
+        // The hot check reads one bit instead of a level
+        bitmap_word_t bit = ((bitmap_word_t) 1) << (dst_node % BITMAP_WORD_BITS);
+        auto visited_word = this->opInfo.visited[dst_node / BITMAP_WORD_BITS];
+        if(visited_word.load() & bit) return;
+        // Only the first thread to set the visited bit gets to
+        // set dst_node's level and push it
+        if(visited_word.fetch_or(bit) & bit) return;
+        if(this->opInfo.dense) {
+            this->opInfo.out_bitmap.insert(dst_node);
+            this->opInfo.levels[dst_node] = this->opInfo.level;
+            return;
+        }
+        if(this->out_wl.push(dst_node)) {
+            this->opInfo.levels[dst_node] = this->opInfo.level;
+        }
+        else {
+            // give the node back so that the rerun can discover it
+            visited_word.fetch_and(~bit);
+            this->out_worklist_full[0] = true;
+        }
+    }
+};
+
+
+/**
+ * @return the number of bytes a level takes when levels can reach *max_level*
+ */
+size_t level_bytes(size_t max_level) {
+    if(max_level <= std::numeric_limits<uint8_t>::max()) {
+        return sizeof(uint8_t);
+    }
+    if(max_level <= std::numeric_limits<uint16_t>::max()) {
+        return sizeof(uint16_t);
+    }
+    return sizeof(uint32_t);
+}
+
+/**
+ * @return the deepest level a BFS of *nnodes* nodes can reach,
+ *         tightened by the user's bound if they gave one
+ */
+size_t max_possible_level(size_t nnodes) {
+    size_t max_level = nnodes > 0 ? nnodes - 1 : 0;
+    if(max_level_bound > 0 && max_level_bound < max_level) {
+        max_level = max_level_bound;
+    }
+    return max_level;
+}
+
+/**
+ * @return the number of bytes levels start out with: 8 bits, since
+ *         most graphs are shallow, or the narrowest width which holds
+ *         the user's bound
+ */
+size_t initial_level_bytes(size_t nnodes) {
+    return level_bytes(max_level_bound > 0 ? max_possible_level(nnodes) : 0);
+}
+
+/**
+ * @return the bytes per node of every level buffer which can be alive
+ *         at once (the narrower ones live until the BFS is done)
+ */
+size_t planned_level_bytes(size_t nnodes) {
+    size_t widest = level_bytes(max_possible_level(nnodes)),
+           total = 0;
+    for(size_t bytes = initial_level_bytes(nnodes); bytes <= widest; bytes *= 2) {
+        total += bytes;
+    }
+    return total;
+}
+
+/**
+ * Describe the device buffers allocated by sycl_bfs
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    plan.add("worklist pipe", Pipe::device_footprint((gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) work_groups));
+    plan.add("bitmap frontier", BitmapFrontier::device_footprint((gpu_size_t) graph.nnodes));
+    plan.add("visited bitmap", (graph.nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS * sizeof(bitmap_word_t));
+    plan.add("compact levels", graph.nnodes * planned_level_bytes(graph.nnodes));
+    plan.add("rerun level flag", sizeof(bool));
+}
+
+
+/**
+ * State of a compact BFS which survives a change of level type
+ */
+struct CompactBFSState {
+    Pipe &wl_pipe;
+    BitmapFrontier &frontier;
+    sycl::buffer<bitmap_word_t, 1> &visited_buf;
+    sycl::buffer<bool, 1> &rerun_level_buf;
+    // the level being discovered next
+    size_t level;
+    bool dense;
+    gpu_size_t frontier_size;
+    size_t num_kernel_reruns,
+           num_dense_levels;
+};
+
+
+/**
+ * Run BFS levels, storing them as level_t, until the BFS is done or
+ * the next level does not fit in a level_t.
+ *
+ * @return true iff the BFS is done
+ */
+template <typename level_t>
+bool run_levels(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue,
+                sycl::buffer<level_t, 1> &levels_buf, CompactBFSState &state)
+{
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    while(state.frontier_size > 0) {
+        if(state.level > std::numeric_limits<level_t>::max()) {
+            return false;
+        }
+        queue.submit([&]( sycl::handler &cgh) {
+            CompactBFSOperatorInfo<level_t> bfsInfo{ levels_buf, state.visited_buf, state.frontier, cgh,
+                                                     (level_t) state.level, state.dense };
+            CompactBFSIter<level_t> current_iter(NUM_WORK_GROUPS, sycl_graph, state.wl_pipe, cgh,
+                                                 state.rerun_level_buf, bfsInfo);
+            cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                               sycl::range<1>{WORK_GROUP_SIZE}},
+                             current_iter);
+        });
+
+        // Dense levels never overflow, so there is nothing to compress
+        if(state.dense) {
+            state.num_dense_levels++;
+            state.level++;
+            state.frontier.swapSlots(queue);
+            auto frontier_size_acc = state.frontier.get_in_bitmap_size_buf().get_access<sycl::access::mode::read>();
+            state.frontier_size = frontier_size_acc[0];
+        }
+        else {
+            // each node is pushed at most once, so skip de-duping
+            state.wl_pipe.compress(queue, false);
+            auto rerun_level_acc = state.rerun_level_buf.get_access<sycl::access::mode::read_write>();
+            if(!rerun_level_acc[0]) {
+                state.level++;
+                state.wl_pipe.swapSlots(queue);
+                auto in_wl_size_acc = state.wl_pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::read>();
+                state.frontier_size = in_wl_size_acc[0];
+            }
+            else {
+                state.num_kernel_reruns++;
+            }
+            rerun_level_acc[0] = false;
+        }
+        // switch representations if the frontier changed density
+        bool next_dense = use_dense_frontier(state.frontier_size, sycl_graph.nnodes);
+        if(next_dense && !state.dense) {
+            state.frontier.fromWorklist(queue, state.wl_pipe);
+        }
+        else if(!next_dense && state.dense) {
+            state.frontier.toWorklist(queue, state.wl_pipe);
+        }
+        state.dense = next_dense;
+    }
+    return true;
+}
+
+
+/**
+ * Zero the levels. This sets the start node's level, and the visited
+ * bitmap says which of the other levels are valid.
+ */
+template <typename level_t>
+void initialize_levels(sycl::queue &queue, sycl::buffer<level_t, 1> &levels_buf, size_t nnodes) {
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_ITEMS  = num_work_groups * WORK_GROUP_SIZE;
+    queue.submit([&] (sycl::handler &cgh) {
+        auto levels = levels_buf.template get_access<sycl::access::mode::discard_write>(cgh);
+        cgh.parallel_for<class compact_levels_init<level_t> >(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                                sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(size_t i = my_item.get_global_id()[0]; i < nnodes; i += NUM_WORK_ITEMS) {
+                levels[i] = 0;
+            }
+        });
+    });
+}
+
+
+/**
+ * Copy the levels in *from_buf* into the wider *to_buf*
+ */
+template <typename from_level_t, typename to_level_t>
+void promote(sycl::queue &queue, sycl::buffer<from_level_t, 1> &from_buf,
+             sycl::buffer<to_level_t, 1> &to_buf, size_t nnodes)
+{
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_ITEMS  = num_work_groups * WORK_GROUP_SIZE;
+    queue.submit([&] (sycl::handler &cgh) {
+        auto from = from_buf.template get_access<sycl::access::mode::read>(cgh);
+        auto to = to_buf.template get_access<sycl::access::mode::discard_write>(cgh);
+        cgh.parallel_for<class promote_levels<from_level_t, to_level_t> >(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                                            sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(size_t i = my_item.get_global_id()[0]; i < nnodes; i += NUM_WORK_ITEMS) {
+                to[i] = from[i];
+            }
+        });
+    });
+    std::cerr << "PROMOTED LEVELS FROM " << 8 * sizeof(from_level_t)
+              << " TO " << 8 * sizeof(to_level_t) << " BITS\n";
+}
+
+
+/**
+ * Write each node's level (or INF if unvisited) into the node_data
+ * so that output() sees the same values as the other variants
+ */
+template <typename level_t>
+void expand(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue,
+            sycl::buffer<level_t, 1> &levels_buf, sycl::buffer<bitmap_word_t, 1> &visited_buf)
+{
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_ITEMS  = num_work_groups * WORK_GROUP_SIZE;
+    queue.submit([&] (sycl::handler &cgh) {
+        auto levels = levels_buf.template get_access<sycl::access::mode::read>(cgh);
+        auto visited = visited_buf.get_access<sycl::access::mode::read>(cgh);
+        auto node_data = sycl_graph.node_data.get_access<sycl::access::mode::discard_write>(cgh);
+        const size_t NNODES = sycl_graph.nnodes;
+        const node_data_type UNVISITED = INF;
+        cgh.parallel_for<class expand_levels<level_t> >(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                          sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(size_t i = my_item.get_global_id()[0]; i < NNODES; i += NUM_WORK_ITEMS) {
+                bool is_visited = (visited[i / BITMAP_WORD_BITS] >> (i % BITMAP_WORD_BITS)) & 1;
+                node_data[i] = is_visited ? (node_data_type) levels[i] : UNVISITED;
+            }
+        });
+    });
+}
+
+
+// The level type to promote to when a level type overflows
+template <typename level_t> struct wider_level;
+template <> struct wider_level<uint8_t> { typedef uint16_t type; };
+template <> struct wider_level<uint16_t> { typedef uint32_t type; };
+
+/**
+ * Finish the BFS from *state*, promoting the levels to wider
+ * types whenever they overflow, and expand the final levels
+ * into the node_data.
+ */
+template <typename level_t>
+void finish_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue,
+                sycl::buffer<level_t, 1> &levels_buf, CompactBFSState &state)
+{
+    if(run_levels(sycl_graph, queue, levels_buf, state)) {
+        expand(sycl_graph, queue, levels_buf, state.visited_buf);
+        return;
+    }
+    typedef typename wider_level<level_t>::type wider_level_t;
+    sycl::buffer<wider_level_t, 1> wider_levels_buf{sycl::range<1>{sycl_graph.nnodes}};
+    promote(queue, levels_buf, wider_levels_buf, sycl_graph.nnodes);
+    finish_bfs(sycl_graph, queue, wider_levels_buf, state);
+}
+
+// Node indices fit in 32 bits, so 32-bit levels never overflow
+template <>
+void finish_bfs<uint32_t>(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue,
+                          sycl::buffer<uint32_t, 1> &levels_buf, CompactBFSState &state)
+{
+    run_levels(sycl_graph, queue, levels_buf, state);
+    expand(sycl_graph, queue, levels_buf, state.visited_buf);
+}
+
+/**
+ * Run the BFS from *state* with levels starting out as level_t
+ */
+template <typename level_t>
+void run_compact_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue, CompactBFSState &state) {
+    sycl::buffer<level_t, 1> levels_buf{sycl::range<1>{sycl_graph.nnodes}};
+    initialize_levels(queue, levels_buf, sycl_graph.nnodes);
+    finish_bfs(sycl_graph, queue, levels_buf, state);
+}
+
+
+/**
+ * Run BFS on the sycl_graph from start_node, storing each node's level
+ * into the node_data
+ */
+void sycl_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    // set up worklists
+    Pipe wl_pipe{(gpu_size_t) sycl_graph.nnodes,
+                 (gpu_size_t) sycl_graph.nnodes,
+                 (gpu_size_t) NUM_WORK_GROUPS};
+
+    // mark only the start node visited
+    const gpu_size_t NUM_VISITED_WORDS = (sycl_graph.nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+    sycl::buffer<bitmap_word_t, 1> visited_buf{sycl::range<1>{NUM_VISITED_WORDS}};
+    queue.submit([&] (sycl::handler &cgh) {
+        auto visited = visited_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        const index_type START_NODE = start_node;
+        cgh.parallel_for<class compact_bfs_init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                   sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_VISITED_WORDS; w += NUM_WORK_ITEMS) {
+                visited[w] = (w == START_NODE / BITMAP_WORD_BITS)
+                           ? ((bitmap_word_t) 1) << (START_NODE % BITMAP_WORD_BITS)
+                           : 0;
+            }
+        });
+    });
+    // Initialize in-worklist
+    wl_pipe.initialize(queue);
+    queue.submit([&] (sycl::handler &cgh) {
+        InWorklist in_wl(wl_pipe, cgh);
+        const index_type START_NODE = start_node;
+        cgh.single_task<class compact_wl_init>( [=]() {
+            in_wl.setSize(1);
+            in_wl.push(0, START_NODE);
+        });
+    });
+
+    // The frontier is stored as a bitmap instead of on the worklists
+    // whenever it holds a large fraction of the nodes
+    BitmapFrontier frontier{(gpu_size_t) sycl_graph.nnodes, (gpu_size_t) NUM_WORK_GROUPS};
+    frontier.initialize(queue);
+
+    bool rerun_level = false;
+    sycl::buffer<bool, 1> rerun_level_buf(&rerun_level, sycl::range<1>{1});
+    CompactBFSState state{ wl_pipe, frontier, visited_buf, rerun_level_buf,
+                           1, false, 1, 0, 0 };
+
+    // Start narrow, and let run_levels' overflow check widen the levels
+    size_t bytes = initial_level_bytes(sycl_graph.nnodes);
+    std::cerr << "INITIAL LEVEL BITS: " << 8 * bytes << "\n";
+    if(bytes == sizeof(uint8_t)) {
+        run_compact_bfs<uint8_t>(sycl_graph, queue, state);
+    }
+    else if(bytes == sizeof(uint16_t)) {
+        run_compact_bfs<uint16_t>(sycl_graph, queue, state);
+    }
+    else {
+        run_compact_bfs<uint32_t>(sycl_graph, queue, state);
+    }
+    // Wait for BFS to finish and throw asynchronous errors if any
+    queue.wait_and_throw();
+    std::cerr << "NUM KERNEL RERUNS: " << state.num_kernel_reruns << "\n";
+    std::cerr << "NUM DENSE LEVELS: " << state.num_dense_levels << "\n";
+}
+
+
+int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    std::cerr << "NUM WORK GROUPS: " << num_work_groups << "\n";
+    // Run sycl bfs in a try-catch block.
+    try {
+        sycl_bfs(sycl_graph, queue);
+    } catch (cl::sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+
+    return 0;
+}
@@ -1,15 +1,25 @@
+#include <atomic>
 #include <iostream>
+#include <vector>
 
 // From libsyclutils
 //
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
 // THREAD_BLOCK_SIZE WARP_SIZE
 #include "kernel_sizing.h"
 // SYCL_CSR_Graph node_data_type index_type
 #include "sycl_csr_graph.h"
 // Pipe
 #include "pipe.h"
+// BitmapFrontier InBitmap OutBitmap use_dense_frontier bitmap_word_t
+#include "bitmap_frontier.h"
 // PushScheduler INF
 #include "push_scheduler.h"
+// HostPushScheduler HostOutWorklist HostThreadPool HOST_CHUNK_SIZE
+#include "host_push_scheduler.h"
+// IterationStats IterationCounters
+#include "iteration_stats.h"
 
 // easier than typing cl::sycl
 namespace sycl = cl::sycl;
@@ -22,25 +32,52 @@ class wl_init;
 extern index_type start_node;
 
 extern size_t num_work_groups;
+extern unsigned num_host_threads;
 
 struct BFSOperatorInfo {
     node_data_type level;
+    // true iff the frontier is stored in bitmaps instead of worklists
+    bool dense;
     sycl::accessor<node_data_type, 1,
                    sycl::access::mode::read_write,
                    sycl::access::target::global_buffer>
                        node_data;
+    sycl::accessor<bitmap_word_t, 1,
+                   sycl::access::mode::atomic,
+                   sycl::access::target::global_buffer>
+                       // bit *node* is set once some thread claims *node*
+                       visited;
+    // dense frontiers
+    InBitmap in_bitmap;
+    OutBitmap out_bitmap;
+    // per-iteration statistics (when -I is given)
+    IterationCounters counters;
     /** Called at start of push scheduling */
-    void initialize(const sycl::nd_item<1> &my_item) { }
+    void initialize(const sycl::nd_item<1> &my_item) {
+        counters.initialize(my_item);
+    }
 
     /** Constructor **/
-    BFSOperatorInfo( SYCL_CSR_Graph &sycl_graph, sycl::handler &cgh, node_data_type level ) 
-        : node_data{ sycl_graph.node_data, cgh }
-        , level{ level }
+    BFSOperatorInfo( SYCL_CSR_Graph &sycl_graph, sycl::buffer<bitmap_word_t, 1> &visited_buf,
+                     BitmapFrontier &frontier, sycl::handler &cgh,
+                     IterationStats &stats, node_data_type level, bool dense )
+        : level{ level }
+        , dense{ dense }
+        , node_data{ sycl_graph.node_data, cgh }
+        , visited{ visited_buf, cgh }
+        , in_bitmap{ frontier, cgh }
+        , out_bitmap{ frontier, cgh }
+        , counters{ stats, cgh }
     { }
     /** We must provide a copy constructor */
     BFSOperatorInfo( const BFSOperatorInfo &that )
-        : node_data{ that.node_data }
-        , level{ that.level }
+        : level{ that.level }
+        , dense{ that.dense }
+        , node_data{ that.node_data }
+        , visited{ that.visited }
+        , in_bitmap{ that.in_bitmap }
+        , out_bitmap{ that.out_bitmap }
+        , counters{ that.counters }
     { }
 };
 
@@ -55,6 +92,16 @@ class BFSIter : public PushScheduler<BFSIter, BFSOperatorInfo> {
         : PushScheduler{num_work_groups, sycl_graph, pipe, cgh, out_worklist_needs_compression, opInfo}
         { }
 
+    // When the frontier is dense the in-worklist holds every node,
+    // so only work on the ones in the frontier
+    bool isActive(index_type node) const {
+        return !opInfo.dense || opInfo.in_bitmap.contains(node);
+    }
+
+    void finalize(const sycl::nd_item<1> &my_item) {
+        opInfo.counters.publish(my_item);
+    }
+
     void applyPushOperator(const sycl::nd_item<1>&,
                            index_type src_node,
                            index_type edge_index)
@@ -62,20 +109,52 @@ class BFSIter : public PushScheduler<BFSIter, BFSOperatorInfo> {
         // invalid edge case
         if(edge_index >= NEDGES) return;
         // valid edge case
+        opInfo.counters.add(ITERATION_EDGES);
         index_type dst_node = edge_dst[edge_index];
-        if(opInfo.node_data[dst_node] == INF) {
-            bool push_success = out_wl.push(dst_node);
-            if(push_success) {
-                opInfo.node_data[dst_node] = opInfo.level;
-            }
-            else {
-                out_worklist_full[0] = true;
-            }
+        bitmap_word_t bit = ((bitmap_word_t) 1) << (dst_node % BITMAP_WORD_BITS);
+        auto visited_word = opInfo.visited[dst_node / BITMAP_WORD_BITS];
+        if(visited_word.load() & bit) return;
+        // Only the first thread to set the visited bit gets to
+        // push dst_node and set its level, so nothing is pushed twice
+        if(visited_word.fetch_or(bit) & bit) return;
+        // The out-bitmap never fills up
+        if(opInfo.dense) {
+            opInfo.out_bitmap.insert(dst_node);
+            opInfo.node_data[dst_node] = opInfo.level;
+            opInfo.counters.add(ITERATION_PUSHES);
+            return;
+        }
+        bool push_success = out_wl.push(dst_node);
+        if(push_success) {
+            opInfo.node_data[dst_node] = opInfo.level;
+            opInfo.counters.add(ITERATION_PUSHES);
+        }
+        else {
+            // give the node back so that the rerun can discover it
+            visited_word.fetch_and(~bit);
+            out_worklist_full[0] = true;
+            opInfo.counters.add(ITERATION_PUSH_FAILURES);
         }
     }
 };
 
 
+/**
+ * Describe the device buffers allocated by sycl_bfs
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    plan.add("worklist pipe", Pipe::device_footprint((gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) work_groups));
+    plan.add("bitmap frontier", BitmapFrontier::device_footprint((gpu_size_t) graph.nnodes));
+    plan.add("visited bitmap", (graph.nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS * sizeof(bitmap_word_t));
+    plan.add("rerun level flag", sizeof(bool));
+    if(IterationStats::device_footprint() > 0) {
+        plan.add("iteration stats", IterationStats::device_footprint());
+    }
+}
+
+
 /**
  * Run BFS on the sycl_graph from start_node, storing each node's level
  * into the node_data
@@ -90,10 +169,13 @@ void sycl_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
                  (gpu_size_t) sycl_graph.nnodes,
                  (gpu_size_t) NUM_WORK_GROUPS};
 
-    // initialize node levels
+    // initialize node levels, and mark only the start node visited
+    const gpu_size_t NUM_VISITED_WORDS = (sycl_graph.nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+    sycl::buffer<bitmap_word_t, 1> visited_buf{sycl::range<1>{NUM_VISITED_WORDS}};
     queue.submit([&] (sycl::handler &cgh) {
         // get access to node level
         auto node_data = sycl_graph.node_data.get_access<sycl::access::mode::discard_write>(cgh);
+        auto visited = visited_buf.get_access<sycl::access::mode::discard_write>(cgh);
         // some constants
         const size_t NNODES = sycl_graph.nnodes;
         const index_type START_NODE = start_node;
@@ -105,6 +187,11 @@ void sycl_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
             for(size_t i = my_item.get_global_id()[0]; i < NNODES; i += NUM_WORK_ITEMS) {
                 node_data[i] = (i == START_NODE) ? 0 : INF;
             }
+            for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_VISITED_WORDS; w += NUM_WORK_ITEMS) {
+                visited[w] = (w == START_NODE / BITMAP_WORD_BITS)
+                           ? ((bitmap_word_t) 1) << (START_NODE % BITMAP_WORD_BITS)
+                           : 0;
+            }
         });
     });
     // Initialize in-worklist
@@ -118,39 +205,74 @@ void sycl_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
         });
     });
 
+    // The frontier is stored as a bitmap instead of on the worklists
+    // whenever it holds a large fraction of the nodes
+    BitmapFrontier frontier{(gpu_size_t) sycl_graph.nnodes, (gpu_size_t) NUM_WORK_GROUPS};
+    frontier.initialize(queue);
+    bool dense = false;
+
+    IterationStats stats;
+    stats.initialize(queue);
+
     // Run BFS
-    size_t num_kernel_reruns = 0;
+    size_t num_kernel_reruns = 0,
+           num_dense_levels = 0;
     size_t level = 1;
     bool rerun_level = false;
     sycl::buffer<bool, 1> rerun_level_buf(&rerun_level, sycl::range<1>{1});
-    gpu_size_t in_wl_size = 1;
-    while(in_wl_size > 0) {
-        queue.submit([&]( sycl::handler &cgh) {
-            BFSOperatorInfo bfsInfo{ sycl_graph, cgh, level };
+    gpu_size_t frontier_size = 1;
+    while(frontier_size > 0) {
+        stats.begin(level, frontier_size, dense);
+        stats.add_event(ITERATION_SCHEDULE, queue.submit([&]( sycl::handler &cgh) {
+            BFSOperatorInfo bfsInfo{ sycl_graph, visited_buf, frontier, cgh, stats, level, dense };
             BFSIter current_iter(NUM_WORK_GROUPS, sycl_graph, wl_pipe, cgh, rerun_level_buf, bfsInfo);
             cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
                                                sycl::range<1>{WORK_GROUP_SIZE}},
                              current_iter);
-        });
+        }));
 
-        wl_pipe.compress(queue);
-        {
+        // Dense levels never overflow, so there is nothing to compress
+        if(dense) {
+            num_dense_levels++;
+            level++;
+            frontier.swapSlots(queue);
+            auto frontier_size_acc = frontier.get_in_bitmap_size_buf().get_access<sycl::access::mode::read>();
+            frontier_size = frontier_size_acc[0];
+            stats.end(false);
+        }
+        else {
+            // each node is pushed at most once, so skip de-duping
+            stats.record_queued(queue, wl_pipe);
+            wl_pipe.compress(queue, false, stats.pipe_events());
+            stats.record_compressed(queue, wl_pipe);
             auto rerun_level_acc = rerun_level_buf.get_access<sycl::access::mode::read_write>();
+            stats.end(rerun_level_acc[0]);
             if(!rerun_level_acc[0]) {
                 level++;
                 wl_pipe.swapSlots(queue);
                 auto in_wl_size_acc = wl_pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::read>();
-                in_wl_size = in_wl_size_acc[0];
+                frontier_size = in_wl_size_acc[0];
             }
             else {
                 num_kernel_reruns++;
             }
             rerun_level_acc[0] = false;
         }
+        // switch representations if the frontier changed density
+        bool next_dense = use_dense_frontier(frontier_size, sycl_graph.nnodes);
+        if(next_dense && !dense) {
+            frontier.fromWorklist(queue, wl_pipe);
+        }
+        else if(!next_dense && dense) {
+            frontier.toWorklist(queue, wl_pipe);
+        }
+        dense = next_dense;
     }
     // Wait for BFS to finish and throw asynchronous errors if any
     queue.wait_and_throw();
     std::cerr << "NUM KERNEL RERUNS: " << num_kernel_reruns << "\n";
+    std::cerr << "NUM DENSE LEVELS: " << num_dense_levels << "\n";
+    stats.report();
 }
 
 
@@ -169,3 +291,57 @@ int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
 
     return 0;
 }
+
+
+// Host backend (-H): BFSIter's operator on host threads, claiming
+// each node with a native compare-exchange on its level
+struct HostBFSIter {
+    const Host_CSR_Graph &graph;
+    std::atomic<node_data_type> *levels;
+    node_data_type level;
+
+    bool isActive(index_type node) const {
+        return true;
+    }
+
+    void applyPushOperator(const HostOutWorklist &out_wl,
+                           index_type src_node,
+                           index_type edge_index)
+    {
+        index_type dst_node = graph.edge_dst[edge_index];
+        node_data_type unvisited = INF;
+        // only the thread which sets dst_node's level pushes it
+        if(   levels[dst_node].load(std::memory_order_relaxed) == INF
+           && levels[dst_node].compare_exchange_strong(unvisited, level, std::memory_order_relaxed)) {
+            out_wl.push(dst_node);
+        }
+    }
+};
+
+
+int host_main(Host_CSR_Graph &graph) {
+    HostThreadPool pool(num_host_threads);
+    std::cerr << "NUM HOST THREADS: " << pool.size() << "\n";
+    std::vector<std::atomic<node_data_type> > levels(graph.nnodes);
+    pool.parallel_for_range(graph.nnodes, HOST_CHUNK_SIZE, [&](unsigned, size_t first, size_t last) {
+        for(index_type node = first; node < last; ++node) {
+            levels[node].store(node == start_node ? 0 : INF, std::memory_order_relaxed);
+        }
+    });
+
+    HostPushScheduler<HostBFSIter> scheduler(pool, graph);
+    std::vector<index_type> frontier{ start_node };
+    node_data_type level = 1;
+    for(; !frontier.empty(); ++level) {
+        HostBFSIter bfsIter{ graph, levels.data(), level };
+        scheduler.run(bfsIter, frontier);
+    }
+    std::cerr << "NUM LEVELS: " << level - 1 << "\n";
+
+    pool.parallel_for_range(graph.nnodes, HOST_CHUNK_SIZE, [&](unsigned, size_t first, size_t last) {
+        for(index_type node = first; node < last; ++node) {
+            graph.node_data[node] = levels[node].load(std::memory_order_relaxed);
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,406 @@
+#include <iostream>
+
+// From libsyclutils
+//
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// THREAD_BLOCK_SIZE WARP_SIZE
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph node_data_type index_type
+#include "sycl_csr_graph.h"
+// Pipe
+#include "pipe.h"
+// BitmapFrontier OutBitmap bitmap_word_t BITMAP_WORD_BITS
+#include "bitmap_frontier.h"
+// PushScheduler INF
+#include "push_scheduler.h"
+// PullScheduler
+#include "pull_scheduler.h"
+// reference_bfs host_reference_isa HostThreadPool
+#include "host_reference.h"
+
+// easier than typing cl::sycl
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class bfs_init;
+class wl_init;
+class reset_level_stats;
+
+// from support.cpp
+extern index_type start_node;
+
+extern size_t num_work_groups;
+extern unsigned num_host_threads;
+
+// Beamer's direction-switching parameters
+// (from "Direction-Optimizing Breadth-First Search", SC12).
+//
+// Switch from top-down to bottom-up once the frontier's out-edges
+// exceed 1/ALPHA of the unexplored edges, and back to top-down once
+// the frontier holds fewer than 1/BETA of the nodes.
+const size_t BEAMER_ALPHA = 14,
+             BEAMER_BETA = 24;
+
+// Indices into the level statistics gathered by the BFS operators
+enum LevelStat {
+    // sum of out-degrees of the nodes discovered this level
+    FRONTIER_EDGES = 0,
+    // number of in-edges inspected by a bottom-up level
+    EDGES_INSPECTED = 1,
+    NUM_LEVEL_STATS = 2
+};
+
+struct BFSOperatorInfo {
+    node_data_type level;
+    sycl::accessor<node_data_type, 1,
+                   sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+                       node_data;
+    sycl::accessor<index_type, 1,
+                   sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+                       // out-edges of the (untransposed) graph, used
+                       // to measure the out-degree of the next frontier
+                       out_row_start;
+    sycl::accessor<bitmap_word_t, 1,
+                   sycl::access::mode::atomic,
+                   sycl::access::target::global_buffer>
+                       // bit *node* is set once some thread claims *node*
+                       visited;
+    sycl::accessor<gpu_size_t, 1,
+                   sycl::access::mode::atomic,
+                   sycl::access::target::global_buffer>
+                       level_stats;
+    // nodes discovered by a bottom-up level
+    OutBitmap out_bitmap;
+    /** Called at start of push/pull scheduling */
+    void initialize(const sycl::nd_item<1> &my_item) { }
+
+    /** Constructor **/
+    BFSOperatorInfo( SYCL_CSR_Graph &sycl_graph,
+                     sycl::buffer<bitmap_word_t, 1> &visited_buf,
+                     BitmapFrontier &frontier,
+                     sycl::buffer<gpu_size_t, 1> &level_stats_buf,
+                     sycl::handler &cgh,
+                     node_data_type level )
+        : level{ level }
+        , node_data{ sycl_graph.node_data, cgh }
+        , out_row_start{ sycl_graph.row_start, cgh }
+        , visited{ visited_buf, cgh }
+        , level_stats{ level_stats_buf, cgh }
+        , out_bitmap{ frontier, cgh }
+    { }
+    /** We must provide a copy constructor */
+    BFSOperatorInfo( const BFSOperatorInfo &that )
+        : level{ that.level }
+        , node_data{ that.node_data }
+        , out_row_start{ that.out_row_start }
+        , visited{ that.visited }
+        , level_stats{ that.level_stats }
+        , out_bitmap{ that.out_bitmap }
+    { }
+};
+
+
+// Define our top-down BFS push operator
+class BFSIter : public PushScheduler<BFSIter, BFSOperatorInfo> {
+    public:
+    BFSIter(gpu_size_t num_work_groups,
+            SYCL_CSR_Graph &sycl_graph, Pipe &pipe, sycl::handler &cgh,
+            sycl::buffer<bool, 1> &out_worklist_needs_compression,
+            BFSOperatorInfo &opInfo)
+        : PushScheduler{num_work_groups, sycl_graph, pipe, cgh, out_worklist_needs_compression, opInfo}
+        { }
+
+    void applyPushOperator(const sycl::nd_item<1>&,
+                           index_type src_node,
+                           index_type edge_index)
+    {
+        // invalid edge case
+        if(edge_index >= NEDGES) return;
+        // valid edge case
+        index_type dst_node = edge_dst[edge_index];
+        bitmap_word_t bit = ((bitmap_word_t) 1) << (dst_node % BITMAP_WORD_BITS);
+        auto visited_word = opInfo.visited[dst_node / BITMAP_WORD_BITS];
+        if(visited_word.load() & bit) return;
+        // Only the first thread to set the visited bit pushes dst_node,
+        // so its out-degree is added to the level's statistics once
+        if(visited_word.fetch_or(bit) & bit) return;
+        bool push_success = out_wl.push(dst_node);
+        if(push_success) {
+            opInfo.node_data[dst_node] = opInfo.level;
+            opInfo.level_stats[FRONTIER_EDGES].fetch_add(row_start[dst_node+1] - row_start[dst_node]);
+        }
+        else {
+            // give the node back so that the rerun can discover it
+            visited_word.fetch_and(~bit);
+            out_worklist_full[0] = true;
+        }
+    }
+};
+
+
+// Define our bottom-up BFS pull operator
+class BFSPullIter : public PullScheduler<BFSPullIter, BFSOperatorInfo> {
+    public:
+    BFSPullIter(gpu_size_t num_work_groups,
+                SYCL_CSR_Graph &sycl_transpose, sycl::handler &cgh,
+                BFSOperatorInfo &opInfo)
+        : PullScheduler{num_work_groups, sycl_transpose, cgh, opInfo}
+        { }
+
+    // Only unvisited nodes look for a parent
+    bool isActive(index_type node) const {
+        return opInfo.node_data[node] == INF;
+    }
+
+    void applyPullOperator(const sycl::nd_item<1>&,
+                           index_type dst_node,
+                           index_type first_in_edge,
+                           index_type last_in_edge)
+    {
+        // Nodes discovered this level get opInfo.level, so they can't be
+        // mistaken for nodes in the frontier (which have opInfo.level - 1)
+        index_type in_edge = first_in_edge;
+        for(; in_edge < last_in_edge; ++in_edge) {
+            if(opInfo.node_data[in_edge_src[in_edge]] == opInfo.level - 1) {
+                opInfo.node_data[dst_node] = opInfo.level;
+                // (only this item pulls into dst_node, but later
+                //  top-down levels check the visited bit)
+                opInfo.visited[dst_node / BITMAP_WORD_BITS].fetch_or(((bitmap_word_t) 1)
+                                                                    << (dst_node % BITMAP_WORD_BITS));
+                opInfo.out_bitmap.insert(dst_node);
+                opInfo.level_stats[FRONTIER_EDGES].fetch_add(opInfo.out_row_start[dst_node+1]
+                                                             - opInfo.out_row_start[dst_node]);
+                // count the edge which found the parent
+                in_edge++;
+                break;
+            }
+        }
+        if(in_edge > first_in_edge) {
+            opInfo.level_stats[EDGES_INSPECTED].fetch_add(in_edge - first_in_edge);
+        }
+    }
+};
+
+
+// the transpose of the loaded graph, so that bottom-up levels can read
+// in-edges (built once by prepare_graph)
+Host_CSR_Graph HOST_TRANSPOSE;
+
+/**
+ * Build HOST_TRANSPOSE before the driver times anything
+ */
+int prepare_graph(const Host_CSR_Graph &graph) {
+    if(HOST_TRANSPOSE.buildTranspose(graph.nnodes, graph.nedges, graph.row_start, graph.edge_dst)) {
+        std::cerr << "Cannot build the transpose of the graph\n";
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Describe the device buffers allocated by sycl_bfs
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    plan.add("transpose row_start", (graph.nnodes + 1) * sizeof(index_type));
+    plan.add("transpose edge_dst", graph.nedges * sizeof(index_type));
+    plan.add("worklist pipe", Pipe::device_footprint((gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) work_groups));
+    plan.add("bitmap frontier", BitmapFrontier::device_footprint((gpu_size_t) graph.nnodes));
+    plan.add("visited bitmap", (graph.nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS * sizeof(bitmap_word_t));
+    plan.add("level stats", NUM_LEVEL_STATS * sizeof(gpu_size_t));
+    plan.add("rerun level flag", sizeof(bool));
+}
+
+
+/**
+ * Run direction-optimizing BFS on the sycl_graph from start_node,
+ * storing each node's level into the node_data
+ */
+void sycl_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    SYCL_CSR_Graph sycl_transpose(&HOST_TRANSPOSE);
+
+    // set up worklists and the bitmap holding bottom-up frontiers
+    Pipe wl_pipe{(gpu_size_t) sycl_graph.nnodes,
+                 (gpu_size_t) sycl_graph.nnodes,
+                 (gpu_size_t) NUM_WORK_GROUPS};
+    BitmapFrontier frontier{(gpu_size_t) sycl_graph.nnodes, (gpu_size_t) NUM_WORK_GROUPS};
+    frontier.initialize(queue);
+    sycl::buffer<gpu_size_t, 1> level_stats_buf(sycl::range<1>{NUM_LEVEL_STATS});
+
+    // initialize node levels, and mark only the start node visited
+    const gpu_size_t NUM_VISITED_WORDS = (sycl_graph.nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+    sycl::buffer<bitmap_word_t, 1> visited_buf{sycl::range<1>{NUM_VISITED_WORDS}};
+    queue.submit([&] (sycl::handler &cgh) {
+        // get access to node level
+        auto node_data = sycl_graph.node_data.get_access<sycl::access::mode::discard_write>(cgh);
+        auto visited = visited_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        // some constants
+        const size_t NNODES = sycl_graph.nnodes;
+        const index_type START_NODE = start_node;
+        // Initialize the node data and worklists
+        cgh.parallel_for<class bfs_init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                           sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            // set node levels to defaults
+            for(size_t i = my_item.get_global_id()[0]; i < NNODES; i += NUM_WORK_ITEMS) {
+                node_data[i] = (i == START_NODE) ? 0 : INF;
+            }
+            for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_VISITED_WORDS; w += NUM_WORK_ITEMS) {
+                visited[w] = (w == START_NODE / BITMAP_WORD_BITS)
+                           ? ((bitmap_word_t) 1) << (START_NODE % BITMAP_WORD_BITS)
+                           : 0;
+            }
+        });
+    });
+    // Initialize in-worklist, and record the start node's out-degree
+    wl_pipe.initialize(queue);
+    queue.submit([&] (sycl::handler &cgh) {
+        InWorklist in_wl(wl_pipe, cgh);
+        auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+        auto level_stats = level_stats_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        const index_type START_NODE = start_node;
+        cgh.single_task<class wl_init>( [=]() {
+            in_wl.setSize(1);
+            in_wl.push(0, START_NODE);
+            level_stats[FRONTIER_EDGES] = row_start[START_NODE+1] - row_start[START_NODE];
+            level_stats[EDGES_INSPECTED] = 0;
+        });
+    });
+
+    // Run BFS
+    size_t num_kernel_reruns = 0,
+           num_bottom_up_levels = 0,
+           edges_inspected = 0,
+           // edges out of nodes which have already been in a frontier
+           edges_explored = 0;
+    size_t level = 1;
+    bool bottom_up = false;
+    bool rerun_level = false;
+    sycl::buffer<bool, 1> rerun_level_buf(&rerun_level, sycl::range<1>{1});
+    // the last top-down pass overflowed the out-worklist
+    bool rerunning = false;
+    // size and out-degree of the current frontier
+    size_t frontier_size = 1,
+           frontier_edges = 0;
+    {
+        auto level_stats_acc = level_stats_buf.get_access<sycl::access::mode::read>();
+        frontier_edges = level_stats_acc[FRONTIER_EDGES];
+    }
+    while(frontier_size > 0) {
+        // Pick a direction
+        size_t unexplored_edges = edges_explored >= sycl_graph.nedges
+                                  ? 0 : sycl_graph.nedges - edges_explored;
+        if(!bottom_up && frontier_edges > unexplored_edges / BEAMER_ALPHA) {
+            bottom_up = true;
+        }
+        else if(bottom_up && frontier_size < sycl_graph.nnodes / BEAMER_BETA) {
+            // The frontier was discovered bottom-up, so it is in the bitmap
+            bottom_up = false;
+            frontier.toWorklist(queue, wl_pipe);
+        }
+        // clear level statistics, unless this reruns a level whose
+        // overflowed pass already counted the nodes it discovered
+        if(!rerunning) {
+            queue.submit([&] (sycl::handler &cgh) {
+                auto level_stats = level_stats_buf.get_access<sycl::access::mode::discard_write>(cgh);
+                cgh.single_task<class reset_level_stats>( [=]() {
+                    for(size_t i = 0; i < NUM_LEVEL_STATS; ++i) {
+                        level_stats[i] = 0;
+                    }
+                });
+            });
+        }
+
+        if(bottom_up) {
+            queue.submit([&]( sycl::handler &cgh) {
+                BFSOperatorInfo bfsInfo{ sycl_graph, visited_buf, frontier, level_stats_buf, cgh, level };
+                BFSPullIter current_iter(NUM_WORK_GROUPS, sycl_transpose, cgh, bfsInfo);
+                cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                   sycl::range<1>{WORK_GROUP_SIZE}},
+                                 current_iter);
+            });
+            num_bottom_up_levels++;
+            level++;
+            edges_explored += frontier_edges;
+            frontier.swapSlots(queue);
+            auto frontier_size_acc = frontier.get_in_bitmap_size_buf().get_access<sycl::access::mode::read>();
+            auto level_stats_acc = level_stats_buf.get_access<sycl::access::mode::read>();
+            frontier_size = frontier_size_acc[0];
+            frontier_edges = level_stats_acc[FRONTIER_EDGES];
+            edges_inspected += level_stats_acc[EDGES_INSPECTED];
+            continue;
+        }
+
+        queue.submit([&]( sycl::handler &cgh) {
+            BFSOperatorInfo bfsInfo{ sycl_graph, visited_buf, frontier, level_stats_buf, cgh, level };
+            BFSIter current_iter(NUM_WORK_GROUPS, sycl_graph, wl_pipe, cgh, rerun_level_buf, bfsInfo);
+            cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                               sycl::range<1>{WORK_GROUP_SIZE}},
+                             current_iter);
+        });
+
+        // each node is pushed at most once, so skip de-duping
+        wl_pipe.compress(queue, false);
+        {
+            auto rerun_level_acc = rerun_level_buf.get_access<sycl::access::mode::read_write>();
+            rerunning = rerun_level_acc[0];
+            if(!rerunning) {
+                level++;
+                edges_explored += frontier_edges;
+                edges_inspected += frontier_edges;
+                wl_pipe.swapSlots(queue);
+                auto in_wl_size_acc = wl_pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::read>();
+                auto level_stats_acc = level_stats_buf.get_access<sycl::access::mode::read>();
+                frontier_size = in_wl_size_acc[0];
+                frontier_edges = level_stats_acc[FRONTIER_EDGES];
+            }
+            else {
+                num_kernel_reruns++;
+            }
+            rerun_level_acc[0] = false;
+        }
+    }
+    // Wait for BFS to finish and throw asynchronous errors if any
+    queue.wait_and_throw();
+    std::cerr << "NUM KERNEL RERUNS: " << num_kernel_reruns << "\n";
+    std::cerr << "NUM BOTTOM-UP LEVELS: " << num_bottom_up_levels
+              << " OF " << level - 1 << "\n";
+    std::cerr << "EDGES INSPECTED: " << edges_inspected << "\n";
+}
+
+
+int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    std::cerr << "NUM WORK GROUPS: " << num_work_groups << "\n";
+    // Run sycl bfs in a try-catch block.
+    try {
+        sycl_bfs(sycl_graph, queue);
+    } catch (cl::sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+
+    return 0;
+}
+
+/**
+ * The host backend: the vectorized direction-optimizing BFS of
+ * host_reference.h, which switches direction as sycl_bfs does
+ */
+int host_main(Host_CSR_Graph &graph) {
+    HostThreadPool pool(num_host_threads);
+    std::cerr << "NUM HOST THREADS: " << pool.size() << "\n";
+    std::cerr << "HOST ISA: " << host_reference_isa() << "\n";
+    size_t num_levels = reference_bfs(pool, graph, HOST_TRANSPOSE, start_node, INF, graph.node_data);
+    std::cerr << "NUM LEVELS: " << num_levels << "\n";
+    return 0;
+}
@@ -0,0 +1,446 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+// From libsyclutils
+//
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// THREAD_BLOCK_SIZE WARP_SIZE
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph index_type
+#include "sycl_csr_graph.h"
+// Pipe
+#include "pipe.h"
+// BitmapFrontier InBitmap OutBitmap use_dense_frontier
+#include "bitmap_frontier.h"
+// PushScheduler
+#include "push_scheduler.h"
+
+// easier than typing cl::sycl
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class graph500_init;
+class graph500_wl_init;
+
+// parent of nodes which the BFS has not reached
+extern const gpu_size_t NO_PARENT = std::numeric_limits<gpu_size_t>::max();
+
+// from graph500-support.cpp
+extern size_t NUM_ROOTS;
+extern uint64_t ROOT_SEED;
+extern std::vector<gpu_size_t> FIRST_PARENTS;
+
+extern size_t num_work_groups;
+
+struct Graph500OperatorInfo {
+    // true iff the frontier is stored in bitmaps instead of worklists
+    bool dense;
+    sycl::accessor<gpu_size_t, 1,
+                   sycl::access::mode::atomic,
+                   sycl::access::target::global_buffer>
+                       parents;
+    // dense frontiers
+    InBitmap in_bitmap;
+    OutBitmap out_bitmap;
+    /** Called at start of push scheduling */
+    void initialize(const sycl::nd_item<1> &my_item) { }
+
+    /** Constructor **/
+    Graph500OperatorInfo( sycl::buffer<gpu_size_t, 1> &parents_buf,
+                          BitmapFrontier &frontier, sycl::handler &cgh,
+                          bool dense )
+        : dense{ dense }
+        , parents{ parents_buf, cgh }
+        , in_bitmap{ frontier, cgh }
+        , out_bitmap{ frontier, cgh }
+    { }
+    /** We must provide a copy constructor */
+    Graph500OperatorInfo( const Graph500OperatorInfo &that )
+        : dense{ that.dense }
+        , parents{ that.parents }
+        , in_bitmap{ that.in_bitmap }
+        , out_bitmap{ that.out_bitmap }
+    { }
+};
+
+
+// Define our BFS push operator
+class Graph500Iter : public PushScheduler<Graph500Iter, Graph500OperatorInfo> {
+    public:
+    Graph500Iter(gpu_size_t num_work_groups,
+                 SYCL_CSR_Graph &sycl_graph, Pipe &pipe, sycl::handler &cgh,
+                 sycl::buffer<bool, 1> &out_worklist_needs_compression,
+                 Graph500OperatorInfo &opInfo)
+        : PushScheduler{num_work_groups, sycl_graph, pipe, cgh, out_worklist_needs_compression, opInfo}
+        { }
+
+    // When the frontier is dense the in-worklist holds every node,
+    // so only work on the ones in the frontier
+    bool isActive(index_type node) const {
+        return !opInfo.dense || opInfo.in_bitmap.contains(node);
+    }
+
+    void applyPushOperator(const sycl::nd_item<1>&,
+                           index_type src_node,
+                           index_type edge_index)
+    {
+        // invalid edge case
+        if(edge_index >= NEDGES) return;
+        // valid edge case
+        index_type dst_node = edge_dst[edge_index];
+        auto parent = opInfo.parents[dst_node];
+        if(parent.load() != NO_PARENT) return;
+        // Only the thread which sets dst_node's parent pushes it
+        gpu_size_t expected = NO_PARENT;
+        if(!parent.compare_exchange_strong(expected, (gpu_size_t) src_node)) return;
+        // The out-bitmap never fills up
+        if(opInfo.dense) {
+            opInfo.out_bitmap.insert(dst_node);
+            return;
+        }
+        if(!out_wl.push(dst_node)) {
+            // give the node back so that the rerun can discover it
+            parent.store(NO_PARENT);
+            out_worklist_full[0] = true;
+        }
+    }
+};
+
+
+/**
+ * Describe the device buffers allocated by sycl_graph500
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    plan.add("worklist pipe", Pipe::device_footprint((gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) work_groups));
+    plan.add("bitmap frontier", BitmapFrontier::device_footprint((gpu_size_t) graph.nnodes));
+    plan.add("parents", graph.nnodes * sizeof(gpu_size_t));
+    plan.add("rerun level flag", sizeof(bool));
+}
+
+
+/**
+ * Run a BFS from *root*, recording each reached node's parent in
+ * *parents_buf* (the root is its own parent)
+ */
+void sycl_bfs_parents(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue, index_type root,
+                      Pipe &wl_pipe, BitmapFrontier &frontier,
+                      sycl::buffer<gpu_size_t, 1> &parents_buf,
+                      sycl::buffer<bool, 1> &rerun_level_buf)
+{
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    // initialize parents
+    queue.submit([&] (sycl::handler &cgh) {
+        auto parents = parents_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        const size_t NNODES = sycl_graph.nnodes;
+        const index_type ROOT = root;
+        cgh.parallel_for<class graph500_init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(size_t i = my_item.get_global_id()[0]; i < NNODES; i += NUM_WORK_ITEMS) {
+                parents[i] = (i == ROOT) ? (gpu_size_t) ROOT : NO_PARENT;
+            }
+        });
+    });
+    // Initialize in-worklist
+    wl_pipe.initialize(queue);
+    queue.submit([&] (sycl::handler &cgh) {
+        InWorklist in_wl(wl_pipe, cgh);
+        const index_type ROOT = root;
+        cgh.single_task<class graph500_wl_init>( [=]() {
+            in_wl.setSize(1);
+            in_wl.push(0, ROOT);
+        });
+    });
+    frontier.initialize(queue);
+    bool dense = false;
+
+    gpu_size_t frontier_size = 1;
+    while(frontier_size > 0) {
+        queue.submit([&]( sycl::handler &cgh) {
+            Graph500OperatorInfo bfsInfo{ parents_buf, frontier, cgh, dense };
+            Graph500Iter current_iter(NUM_WORK_GROUPS, sycl_graph, wl_pipe, cgh, rerun_level_buf, bfsInfo);
+            cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                               sycl::range<1>{WORK_GROUP_SIZE}},
+                             current_iter);
+        });
+
+        // Dense levels never overflow, so there is nothing to compress
+        if(dense) {
+            frontier.swapSlots(queue);
+            auto frontier_size_acc = frontier.get_in_bitmap_size_buf().get_access<sycl::access::mode::read>();
+            frontier_size = frontier_size_acc[0];
+        }
+        else {
+            // each node is pushed at most once, so skip de-duping
+            wl_pipe.compress(queue, false);
+            auto rerun_level_acc = rerun_level_buf.get_access<sycl::access::mode::read_write>();
+            if(!rerun_level_acc[0]) {
+                wl_pipe.swapSlots(queue);
+                auto in_wl_size_acc = wl_pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::read>();
+                frontier_size = in_wl_size_acc[0];
+            }
+            rerun_level_acc[0] = false;
+        }
+        // switch representations if the frontier changed density
+        bool next_dense = use_dense_frontier(frontier_size, sycl_graph.nnodes);
+        if(next_dense && !dense) {
+            frontier.fromWorklist(queue, wl_pipe);
+        }
+        else if(!next_dense && dense) {
+            frontier.toWorklist(queue, wl_pipe);
+        }
+        dense = next_dense;
+    }
+    queue.wait_and_throw();
+}
+
+
+/**
+ * Validate a BFS tree as in the Graph500 specification:
+ *  1. the parents form a tree rooted at *root* (no cycles)
+ *  2. every edge joins nodes whose levels differ by at most one
+ *  3. the tree spans exactly the connected component of *root*
+ *  4. every tree edge is an edge of the graph
+ * The levels follow from the parents, so each tree edge joins
+ * nodes whose levels differ by exactly one.
+ *
+ * The edge checks are split across host threads.
+ *
+ * @param edges_in_component set to the number of undirected input edges
+ *                           (including self-loops) in *root*'s component
+ * @return NULL if the tree is valid, otherwise why it is not
+ */
+const char *validate_bfs_tree(const index_type *row_start, const index_type *edge_dst,
+                              index_type nnodes, index_type root,
+                              const std::vector<gpu_size_t> &parents,
+                              size_t &edges_in_component)
+{
+    edges_in_component = 0;
+    if(parents[root] != root) {
+        return "root is not its own parent";
+    }
+    // compute levels by walking up the tree.
+    // -1 is unknown, -2 is on the walk in progress
+    std::vector<int64_t> level(nnodes, -1);
+    std::vector<index_type> walk;
+    level[root] = 0;
+    for(index_type node = 0; node < nnodes; ++node) {
+        if(parents[node] == NO_PARENT || level[node] >= 0) {
+            continue;
+        }
+        walk.clear();
+        index_type ancestor = node;
+        while(level[ancestor] == -1) {
+            if(parents[ancestor] >= nnodes) {
+                return "parent is not a node";
+            }
+            level[ancestor] = -2;
+            walk.push_back(ancestor);
+            ancestor = parents[ancestor];
+            if(parents[ancestor] == NO_PARENT) {
+                return "parent was not reached";
+            }
+        }
+        if(level[ancestor] == -2) {
+            return "parents contain a cycle";
+        }
+        for(auto it = walk.rbegin(); it != walk.rend(); ++it) {
+            level[*it] = level[parents[*it]] + 1;
+        }
+    }
+
+    // check the edges of a range of nodes per thread
+    unsigned num_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<const char*> errors(num_threads, NULL);
+    // twice the number of edges seen in the component
+    std::vector<size_t> edge_counts(num_threads, 0);
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            index_type first = nnodes * t / num_threads,
+                       last = nnodes * (t + 1) / num_threads;
+            size_t count = 0;
+            for(index_type src = first; src < last; ++src) {
+                bool src_reached = parents[src] != NO_PARENT;
+                bool found_parent_edge = !src_reached || src == root;
+                for(index_type edge = row_start[src]; edge < row_start[src + 1]; ++edge) {
+                    index_type dst = edge_dst[edge];
+                    bool dst_reached = parents[dst] != NO_PARENT;
+                    if(src_reached != dst_reached) {
+                        errors[t] = "tree does not span the root's component";
+                        return;
+                    }
+                    if(!src_reached) {
+                        continue;
+                    }
+                    if(level[src] > level[dst] + 1 || level[dst] > level[src] + 1) {
+                        errors[t] = "edge joins nodes more than one level apart";
+                        return;
+                    }
+                    // self-loops are stored once, other edges twice
+                    count += (dst == src) ? 2 : 1;
+                    found_parent_edge |= (dst == parents[src]);
+                }
+                if(!found_parent_edge) {
+                    errors[t] = "tree edge is not in the graph";
+                    return;
+                }
+            }
+            edge_counts[t] = count;
+        });
+    }
+    for(auto &thread : threads) {
+        thread.join();
+    }
+    for(unsigned t = 0; t < num_threads; ++t) {
+        if(errors[t] != NULL) {
+            return errors[t];
+        }
+        edges_in_component += edge_counts[t];
+    }
+    edges_in_component /= 2;
+    return NULL;
+}
+
+
+/**
+ * Pick up to NUM_ROOTS distinct random roots with an edge
+ * to some other node
+ */
+std::vector<index_type> pick_roots(SYCL_CSR_Graph &sycl_graph) {
+    auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>();
+    auto edge_dst = sycl_graph.edge_dst.get_access<sycl::access::mode::read>();
+    std::vector<index_type> candidates;
+    for(index_type node = 0; node < sycl_graph.nnodes; ++node) {
+        for(index_type edge = row_start[node]; edge < row_start[node + 1]; ++edge) {
+            if(edge_dst[edge] != node) {
+                candidates.push_back(node);
+                break;
+            }
+        }
+    }
+    // partial Fisher-Yates shuffle
+    std::mt19937_64 rng(ROOT_SEED);
+    size_t num_roots = std::min(NUM_ROOTS, candidates.size());
+    for(size_t i = 0; i < num_roots; ++i) {
+        size_t j = std::uniform_int_distribution<size_t>(i, candidates.size() - 1)(rng);
+        std::swap(candidates[i], candidates[j]);
+    }
+    candidates.resize(num_roots);
+    return candidates;
+}
+
+
+/**
+ * Run, validate, and time a BFS from each root
+ *
+ * @return the number of BFS trees which failed validation
+ */
+size_t sycl_graph500(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    const size_t NUM_WORK_GROUPS = num_work_groups;
+    std::vector<index_type> roots = pick_roots(sycl_graph);
+    if(roots.empty()) {
+        std::cerr << "Graph has no edges between distinct nodes\n";
+        return 0;
+    }
+
+    Pipe wl_pipe{(gpu_size_t) sycl_graph.nnodes,
+                 (gpu_size_t) sycl_graph.nnodes,
+                 (gpu_size_t) NUM_WORK_GROUPS};
+    BitmapFrontier frontier{(gpu_size_t) sycl_graph.nnodes, (gpu_size_t) NUM_WORK_GROUPS};
+    sycl::buffer<gpu_size_t, 1> parents_buf{sycl::range<1>{sycl_graph.nnodes}};
+    bool rerun_level = false;
+    sycl::buffer<bool, 1> rerun_level_buf(&rerun_level, sycl::range<1>{1});
+
+    // An untimed BFS from the first root, so that the first timed one
+    // doesn't include copying the graph to the device (pick_roots only
+    // read it on the host) or building the kernels
+    sycl_bfs_parents(sycl_graph, queue, roots[0], wl_pipe, frontier, parents_buf, rerun_level_buf);
+    queue.wait_and_throw();
+
+    std::vector<gpu_size_t> parents(sycl_graph.nnodes);
+    std::vector<double> times, teps;
+    size_t num_failed = 0;
+    for(size_t i = 0; i < roots.size(); ++i) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        sycl_bfs_parents(sycl_graph, queue, roots[i], wl_pipe, frontier, parents_buf, rerun_level_buf);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1e9;
+        {
+            auto parents_acc = parents_buf.get_access<sycl::access::mode::read>();
+            std::copy(parents_acc.get_pointer(), parents_acc.get_pointer() + sycl_graph.nnodes,
+                      parents.begin());
+        }
+        if(i == 0) {
+            FIRST_PARENTS = parents;
+        }
+
+        size_t edges_in_component = 0;
+        const char *error;
+        {
+            auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>();
+            auto edge_dst = sycl_graph.edge_dst.get_access<sycl::access::mode::read>();
+            error = validate_bfs_tree(row_start.get_pointer(), edge_dst.get_pointer(),
+                                      sycl_graph.nnodes, roots[i], parents, edges_in_component);
+        }
+        if(error != NULL) {
+            std::cerr << "VALIDATION FAILED for root " << roots[i] << ": " << error << "\n";
+            num_failed++;
+            continue;
+        }
+        times.push_back(seconds);
+        teps.push_back(edges_in_component / seconds);
+        fprintf(stderr, "root %zu: %zu edges in %.6f s, %.4e TEPS\n",
+                roots[i], edges_in_component, seconds, teps.back());
+    }
+
+    // Report as the Graph500 reference code does
+    fprintf(stderr, "NBFS: %zu\n", roots.size());
+    fprintf(stderr, "num_failed_validations: %zu\n", num_failed);
+    if(!teps.empty()) {
+        std::sort(times.begin(), times.end());
+        std::sort(teps.begin(), teps.end());
+        const size_t n = teps.size();
+        double median_time = (times[(n - 1) / 2] + times[n / 2]) / 2,
+               median_teps = (teps[(n - 1) / 2] + teps[n / 2]) / 2,
+               inverse_teps_sum = 0;
+        for(double t : teps) {
+            inverse_teps_sum += 1 / t;
+        }
+        fprintf(stderr, "min_time: %.6e\n", times.front());
+        fprintf(stderr, "median_time: %.6e\n", median_time);
+        fprintf(stderr, "max_time: %.6e\n", times.back());
+        fprintf(stderr, "min_TEPS: %.6e\n", teps.front());
+        fprintf(stderr, "median_TEPS: %.6e\n", median_teps);
+        fprintf(stderr, "max_TEPS: %.6e\n", teps.back());
+        fprintf(stderr, "harmonic_mean_TEPS: %.6e\n", n / inverse_teps_sum);
+    }
+    return num_failed;
+}
+
+
+int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    std::cerr << "NUM WORK GROUPS: " << num_work_groups << "\n";
+    size_t num_failed = 0;
+    // Run sycl graph500 in a try-catch block.
+    try {
+        num_failed = sycl_graph500(sycl_graph, queue);
+    } catch (cl::sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+
+    return num_failed > 0;
+}
@@ -2,12 +2,16 @@
 
 // From libsyclutils
 //
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
 // THREAD_BLOCK_SIZE WARP_SIZE
 #include "kernel_sizing.h"
 // SYCL_CSR_Graph node_data_type index_type
 #include "sycl_csr_graph.h"
 // Pipe
 #include "pipe.h"
+// BitmapFrontier InBitmap OutBitmap
+#include "bitmap_frontier.h"
 // PushScheduler INF
 #include "push_scheduler.h"
 
@@ -24,6 +28,9 @@ extern index_type start_node;
 extern size_t num_work_groups;
 
 struct BFSOperatorInfo {
+    // true iff every node should relax its edges,
+    // not just the ones which changed last round
+    bool all_active;
     sycl::accessor<node_data_type, 1,
                    sycl::access::mode::read_write,
                    sycl::access::target::global_buffer>
@@ -32,20 +39,30 @@ struct BFSOperatorInfo {
                    sycl::access::mode::write,
                    sycl::access::target::global_buffer>
                        done;
+    // nodes whose level changed last round / this round
+    InBitmap changed_last_round;
+    OutBitmap changed_this_round;
     /** Called at start of push scheduling */
     void initialize(const sycl::nd_item<1> &my_item) { }
 
     /** Constructor **/
     BFSOperatorInfo( SYCL_CSR_Graph &sycl_graph,
                      sycl::buffer<bool, 1> &done_buf,
-                     sycl::handler &cgh )
-        : node_data{ sycl_graph.node_data, cgh }
+                     BitmapFrontier &changed, sycl::handler &cgh,
+                     bool all_active )
+        : all_active{ all_active }
+        , node_data{ sycl_graph.node_data, cgh }
         , done{ done_buf, cgh }
+        , changed_last_round{ changed, cgh }
+        , changed_this_round{ changed, cgh }
     { }
     /** We must provide a copy constructor */
     BFSOperatorInfo( const BFSOperatorInfo &that )
-        : node_data{ that.node_data }
+        : all_active{ that.all_active }
+        , node_data{ that.node_data }
         , done{ that.done }
+        , changed_last_round{ that.changed_last_round }
+        , changed_this_round{ that.changed_this_round }
     { }
 };
 
@@ -60,6 +77,12 @@ class BFSIter : public PushScheduler<BFSIter, BFSOperatorInfo> {
         : PushScheduler{num_work_groups, sycl_graph, pipe, cgh, out_worklist_needs_compression, opInfo}
         { }
 
+    // A node whose level did not change last round has nothing
+    // new to tell its neighbors, so skip it without reading its edges
+    bool isActive(index_type node) const {
+        return opInfo.all_active || opInfo.changed_last_round.contains(node);
+    }
+
     void applyPushOperator(const sycl::nd_item<1>&,
                            index_type src_node,
                            index_type edge_index)
@@ -71,12 +94,25 @@ class BFSIter : public PushScheduler<BFSIter, BFSOperatorInfo> {
         if(   opInfo.node_data[src_node] != INF 
            && opInfo.node_data[src_node] + 1 < opInfo.node_data[dst_node]) {
             opInfo.node_data[dst_node] = opInfo.node_data[src_node] + 1;
+            opInfo.changed_this_round.insert(dst_node);
             opInfo.done[0] = false;
         }
     }
 };
 
 
+/**
+ * Describe the device buffers allocated by sycl_bfs
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    plan.add("worklist pipe", Pipe::device_footprint((gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) graph.nnodes,
+                                                     (gpu_size_t) work_groups));
+    plan.add("changed bitmaps", BitmapFrontier::device_footprint((gpu_size_t) graph.nnodes));
+    plan.add("done/rerun flags", 2 * sizeof(bool));
+}
+
+
 /**
  * Run BFS on the sycl_graph from start_node, storing each node's level
  * into the node_data
@@ -108,20 +144,20 @@ void sycl_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
             }
         });
     });
-    // Initialize in-worklist to all nodes
+    // Only the start node has changed so far
     wl_pipe.initialize(queue);
     queue.submit([&] (sycl::handler &cgh) {
         InWorklist in_wl(wl_pipe, cgh);
-        const size_t NNODES = sycl_graph.nnodes;
-        cgh.parallel_for<class wl_init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
-                                                          sycl::range<1>{WORK_GROUP_SIZE}},
-        [=](sycl::nd_item<1> my_item) {
-            in_wl.setSize(NNODES);
-            for(index_type i = my_item.get_global_id()[0]; i < NNODES; i += NUM_WORK_ITEMS) {
-                // put *i* in *i*th position
-                in_wl.push(i, i);
-            }
-    }); });
+        const index_type START_NODE = start_node;
+        cgh.single_task<class wl_init>( [=]() {
+            in_wl.setSize(1);
+            in_wl.push(0, START_NODE);
+        });
+    });
+    // Move it into the changed bitmap, which puts all nodes on the in-worklist
+    BitmapFrontier changed{(gpu_size_t) sycl_graph.nnodes, (gpu_size_t) NUM_WORK_GROUPS};
+    changed.initialize(queue);
+    changed.fromWorklist(queue, wl_pipe);
 
     // Run BFS
     bool done = true;
@@ -129,26 +165,44 @@ void sycl_bfs(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
     // We won't need to rerun since we're doing topology-driven
     bool rerun = false;
     sycl::buffer<bool, 1> rerun_buf(&rerun, sycl::range<1>{1});
+    // Levels are written without atomics, so a racing write can leave
+    // a node with a level which only a node that didn't change can fix.
+    // So once a round changes nothing, confirm with a sweep over all nodes.
+    bool all_active = false;
+    size_t num_rounds = 0,
+           num_full_sweeps = 0;
     while(true) {
-        // Relax all edges
+        num_rounds++;
+        if(all_active) {
+            num_full_sweeps++;
+        }
+        // Relax the edges of the nodes which changed last round
         queue.submit([&]( sycl::handler &cgh) {
-            BFSOperatorInfo bfsInfo{ sycl_graph, done_buf, cgh };
+            BFSOperatorInfo bfsInfo{ sycl_graph, done_buf, changed, cgh, all_active };
             BFSIter current_iter(NUM_WORK_GROUPS, sycl_graph, wl_pipe, cgh, rerun_buf, bfsInfo);
             cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
                                                sycl::range<1>{WORK_GROUP_SIZE}},
                              current_iter);
         });
+        changed.swapSlots(queue);
         // are we done?
         {
             auto done_acc = done_buf.get_access<sycl::access::mode::read_write>();
             if(done_acc[0]) {
-                break;
+                if(all_active) {
+                    break;
+                }
+                all_active = true;
+                continue;
             }
             done_acc[0] = true;
+            all_active = false;
         }
     }
     // Wait for BFS to finish and throw asynchronous errors if any
     queue.wait_and_throw();
+    std::cerr << "NUM ROUNDS: " << num_rounds << "\n";
+    std::cerr << "NUM FULL SWEEPS: " << num_full_sweeps << "\n";
 }
 
 
@@ -0,0 +1,68 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// from libsyclutils
+//
+// Host_CSR_Graph index_type
+#include "host_csr_graph.h"
+
+// from bfs-graph500.cpp
+extern const uint32_t NO_PARENT;
+
+const char *prog_opts = "r:S:";
+const char *prog_usage = "[-r numRoots] [-S rootSeed]";
+const char *prog_args_usage = "";
+
+// Graph500 runs 64 BFS's
+size_t NUM_ROOTS = 64;
+uint64_t ROOT_SEED = 1;
+
+// the parent of each node in the BFS tree of the first root
+std::vector<uint32_t> FIRST_PARENTS;
+
+int process_prog_arg(int argc, char *argv[], int arg_start) {
+    return 1;
+}
+
+void process_prog_opt(char c, char *optarg) {
+    if(c == 'r') {
+        long num_roots = atol(optarg);
+        if(num_roots <= 0) {
+            fprintf(stderr, "-r: the number of roots must be positive\n");
+            exit(1);
+        }
+        NUM_ROOTS = num_roots;
+    }
+    if(c == 'S') {
+        ROOT_SEED = strtoull(optarg, NULL, 10);
+    }
+}
+
+/**
+ * Print the BFS tree of the first root as lines of
+ *      node parent
+ * where nodes the BFS did not reach have parent -1
+ */
+void output(Host_CSR_Graph &graph, const char *output_file) {
+  FILE *f;
+
+  if(!output_file)
+    return;
+
+  if(strcmp(output_file, "-") == 0)
+    f = stdout;
+  else
+    f = fopen(output_file, "w");
+
+  for(index_type node = 0; node < FIRST_PARENTS.size(); ++node) {
+    if(FIRST_PARENTS[node] == NO_PARENT)
+      fprintf(f, "%zu -1\n", node);
+    else
+      fprintf(f, "%zu %u\n", node, FIRST_PARENTS[node]);
+  }
+
+  if(f != stdout)
+    fclose(f);
+}
@@ -1,27 +1,38 @@
 #include <cstring>
 #include <limits>
+#include <vector>
 
 // from libsyclutils
 //
 // Host_CSR_Graph index_type
 #include "host_csr_graph.h"
+// reference_bfs host_reference_isa HostThreadPool
+#include "host_reference.h"
 
 // from bfs-sycl-naive.cpp
 extern const uint64_t INF;
+// from sycl_driver.cpp
+extern unsigned num_host_threads;
 
 // Copied and modified from
 // https://github.com/IntelligentSoftwareSystems/Galois/blob/c6ab08b14b1daa20d6b408720696c8a36ffe30cb/lonestar/analytics/gpu/bfs/support.cu#L5-L25
-const char *prog_opts = "s:";
-const char *prog_usage = "[-s startNode]";
+const char *prog_opts = "l:s:";
+const char *prog_usage = "[-l maxLevel] [-s startNode]";
 const char *prog_args_usage = "";
 
 index_type start_node = 0;
+// an upper bound on the deepest BFS level (e.g. the graph's diameter),
+// or 0 if unknown. Lets bfs-compact-levels start with narrower levels.
+size_t max_level_bound = 0;
 
 int process_prog_arg(int argc, char *argv[], int arg_start) {
        return 1;
 }
 
 void process_prog_opt(char c, char *optarg) {
+    if(c == 'l') {
+        max_level_bound = atol(optarg);
+    }
     if(c == 's') {
         start_node = atoi(optarg);
         assert(start_node >= 0);
@@ -54,3 +65,33 @@ void output(Host_CSR_Graph &graph, const char *output_file) {
     }    
   }
 }
+
+/**
+ * Compare the levels in the node data with those of the host reference BFS
+ *
+ * @return nonzero iff any level differs
+ */
+int verify_output(Host_CSR_Graph &graph) {
+  Host_CSR_Graph transpose;
+  if(transpose.buildTranspose(graph.nnodes, graph.nedges, graph.row_start, graph.edge_dst)) {
+    return 1;
+  }
+  HostThreadPool pool(num_host_threads);
+  std::vector<node_data_type> levels(graph.nnodes);
+  reference_bfs(pool, graph, transpose, start_node, INF, levels.data());
+
+  size_t mismatches = 0;
+  for(index_type node = 0; node < graph.nnodes; node++) {
+    if(graph.node_data[node] != levels[node]) {
+      // report the first few
+      if(mismatches < 10) {
+        fprintf(stderr, "node %zu: level %lu, expected %lu\n", node,
+                (unsigned long) graph.node_data[node], (unsigned long) levels[node]);
+      }
+      mismatches++;
+    }
+  }
+  fprintf(stderr, "%zu of %zu levels differ from the host reference (%s)\n",
+          mismatches, graph.nnodes, host_reference_isa());
+  return mismatches > 0;
+}
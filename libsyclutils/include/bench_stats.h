@@ -0,0 +1,52 @@
+/**
+ * bench_stats.h
+ *
+ * Summary statistics of benchmark timings (the driver's -B option and
+ * bench/bench-suite).
+ *
+ * Run times are skewed (a few runs are slowed by the OS, clocks ramping
+ * up, etc.), so the summary is built from order statistics only:
+ * the median, the median absolute deviation, and a confidence interval
+ * for the median that assumes nothing about the distribution.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_BENCH_STATS_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_BENCH_STATS_
+
+#include <cstddef>
+#include <vector>
+
+struct SampleSummary {
+    size_t count;
+    double min, max, median;
+    // median absolute deviation from the median (unscaled)
+    double mad;
+    // a confidence interval for the median of at least
+    // SAMPLE_CONFIDENCE, or [min, max] if there are too few samples
+    // to reach it
+    double ci_low, ci_high;
+};
+
+// the confidence level of SampleSummary's interval
+const double SAMPLE_CONFIDENCE = 0.95;
+
+/**
+ * Summarize *samples*. Every field is 0 if there are none.
+ */
+SampleSummary summarize_samples(std::vector<double> samples);
+
+/**
+ * One-sided Mann-Whitney U test of whether *samples* tend to be larger
+ * (e.g. slower) than *baseline*. Like the summary, it only uses the
+ * order of the samples.
+ *
+ * The p-value is exact for small samples without ties, and otherwise
+ * comes from the normal approximation (corrected for ties).
+ *
+ * @return the probability of a U statistic at least as large as this
+ *         one if both came from the same distribution (1 if either is
+ *         empty)
+ */
+double mann_whitney_greater(const std::vector<double> &samples,
+                            const std::vector<double> &baseline);
+
+#endif
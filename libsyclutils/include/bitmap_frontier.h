@@ -0,0 +1,359 @@
+/*  -*- mode: c++ -*- */
+#include <CL/sycl.hpp>
+
+// WARP_SIZE THREAD_BLOCK_SIZE
+#include "kernel_sizing.h"
+// index_type
+#include "sycl_csr_graph.h"
+// Pipe gpu_size_t
+#include "pipe.h"
+// InWorklist
+#include "in_worklist.h"
+
+#ifndef BREADTHNPAGEINSYCL_LIBSYCLUTILS_BITMAPFRONTIER_
+#define BREADTHNPAGEINSYCL_LIBSYCLUTILS_BITMAPFRONTIER_
+
+namespace sycl = cl::sycl;
+
+// Use 32-bit words so that we can use atomics on NVIDIA
+typedef uint32_t bitmap_word_t;
+#define BITMAP_WORD_BITS 32
+
+// A frontier is considered dense (and stored as a bitmap) once it
+// holds more than 1 / DENSE_FRONTIER_DENOMINATOR of the nodes.
+// This is the threshold used by Ligra.
+#define DENSE_FRONTIER_DENOMINATOR 20
+
+// classes used to name kernels
+class InitializeBitmaps;
+class SwapBitmaps;
+class ClearInBitmap;
+class MarkWorklistInBitmap;
+class FillWorklistWithAllNodes;
+class ResetInWorklistSize;
+class CompactBitmapIntoWorklist;
+
+/**
+ * @param frontier_size the number of nodes in a frontier
+ * @param nnodes the number of nodes in the graph
+ * @return true iff a frontier of *frontier_size* nodes should be
+ *         stored as a bitmap instead of as a worklist
+ */
+inline bool use_dense_frontier(gpu_size_t frontier_size, gpu_size_t nnodes) {
+    return (size_t) frontier_size * DENSE_FRONTIER_DENOMINATOR > nnodes;
+}
+
+/**
+ * Manages an in-bitmap and an out-bitmap of nodes, in the same
+ * way that a Pipe manages an in-worklist and an out-worklist.
+ *
+ * Bit *node* of a bitmap is set iff *node* is in the frontier.
+ * Inserting into the out-bitmap never fails, and each node is
+ * inserted at most once, so dense frontiers need neither
+ * compression nor de-duping.
+ *
+ * fromWorklist and toWorklist convert between a Pipe's in-worklist
+ * and the in-bitmap. While the frontier lives in the in-bitmap,
+ * the in-worklist holds every node so that schedulers can
+ * iterate over it and skip the nodes not in the in-bitmap.
+ */
+class BitmapFrontier {
+    private:
+        const gpu_size_t NNODES,
+                         NUM_WORDS,
+                         NUM_WORK_GROUPS;
+
+        // GLOBAL MEMORY BUFFERS
+        // in/out bitmaps
+        sycl::buffer<bitmap_word_t, 1> bitmap1_buf,
+                                       bitmap2_buf,
+                                       *in_bitmap_buf = &bitmap1_buf,
+                                       *out_bitmap_buf = &bitmap2_buf;
+        // number of nodes in each bitmap
+        sycl::buffer<gpu_size_t, 1> in_bitmap_size_buf,
+                                    out_bitmap_size_buf;
+
+        /**
+         * Zero the in-bitmap
+         */
+        void clearInBitmap(sycl::queue &queue) {
+            queue.submit([&] (sycl::handler &cgh) {
+                const gpu_size_t NUM_WORDS = this->NUM_WORDS,
+                                 NUM_WORK_ITEMS = THREAD_BLOCK_SIZE * this->NUM_WORK_GROUPS;
+                auto in_bitmap = this->in_bitmap_buf->get_access<sycl::access::mode::discard_write>(cgh);
+                cgh.parallel_for<class ClearInBitmap>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                        sycl::range<1>{THREAD_BLOCK_SIZE}},
+                [=](sycl::nd_item<1> my_item) {
+                    for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_WORDS; w += NUM_WORK_ITEMS) {
+                        in_bitmap[w] = 0;
+                    }
+                });
+            });
+        }
+    public:
+        BitmapFrontier(gpu_size_t nnodes, gpu_size_t num_work_groups)
+            : NNODES{ nnodes }
+            , NUM_WORDS{ (nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS }
+            , NUM_WORK_GROUPS{ num_work_groups }
+            , bitmap1_buf{ sycl::range<1>{NUM_WORDS} }
+            , bitmap2_buf{ sycl::range<1>{NUM_WORDS} }
+            , in_bitmap_size_buf{ sycl::range<1>{1} }
+            , out_bitmap_size_buf{ sycl::range<1>{1} }
+            { }
+
+        /**
+         * The number of bytes of device global memory a BitmapFrontier
+         * over *nnodes* nodes will allocate.
+         */
+        static size_t device_footprint(gpu_size_t nnodes) {
+            size_t num_words = (nnodes + BITMAP_WORD_BITS - 1) / BITMAP_WORD_BITS;
+            return 2 * num_words * sizeof(bitmap_word_t) + 2 * sizeof(gpu_size_t);
+        }
+
+        /**
+         * useful constant getters
+         */
+        gpu_size_t get_num_words() const {
+            return this->NUM_WORDS;
+        }
+
+        /**
+         * bitmap getters
+         */
+        sycl::buffer<bitmap_word_t, 1>& get_in_bitmap_buf() {
+            return *(this->in_bitmap_buf);
+        }
+        sycl::buffer<gpu_size_t, 1>& get_in_bitmap_size_buf() {
+            return this->in_bitmap_size_buf;
+        }
+        sycl::buffer<bitmap_word_t, 1>& get_out_bitmap_buf() {
+            return *(this->out_bitmap_buf);
+        }
+        sycl::buffer<gpu_size_t, 1>& get_out_bitmap_size_buf() {
+            return this->out_bitmap_size_buf;
+        }
+
+        /**
+         * Initialize both bitmaps to empty
+         */
+        void initialize(sycl::queue &queue) {
+            queue.submit([&] (sycl::handler &cgh) {
+                const gpu_size_t NUM_WORDS = this->NUM_WORDS,
+                                 NUM_WORK_ITEMS = THREAD_BLOCK_SIZE * this->NUM_WORK_GROUPS;
+                auto in_bitmap = this->in_bitmap_buf->get_access<sycl::access::mode::discard_write>(cgh);
+                auto out_bitmap = this->out_bitmap_buf->get_access<sycl::access::mode::discard_write>(cgh);
+                auto in_bitmap_size = this->in_bitmap_size_buf.get_access<sycl::access::mode::write>(cgh);
+                auto out_bitmap_size = this->out_bitmap_size_buf.get_access<sycl::access::mode::write>(cgh);
+                cgh.parallel_for<class InitializeBitmaps>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                            sycl::range<1>{THREAD_BLOCK_SIZE}},
+                [=](sycl::nd_item<1> my_item) {
+                    for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_WORDS; w += NUM_WORK_ITEMS) {
+                        in_bitmap[w] = 0;
+                        out_bitmap[w] = 0;
+                    }
+                    if(my_item.get_global_id()[0] == 0) {
+                        in_bitmap_size[0] = 0;
+                        out_bitmap_size[0] = 0;
+                    }
+                });
+            });
+        }
+
+        /**
+         * Swap the in and out-bitmaps, and clear the new out-bitmap
+         */
+        void swapSlots(sycl::queue &queue) {
+            std::swap(in_bitmap_buf, out_bitmap_buf);
+            queue.submit([&] (sycl::handler &cgh) {
+                const gpu_size_t NUM_WORDS = this->NUM_WORDS,
+                                 NUM_WORK_ITEMS = THREAD_BLOCK_SIZE * this->NUM_WORK_GROUPS;
+                auto out_bitmap = this->out_bitmap_buf->get_access<sycl::access::mode::discard_write>(cgh);
+                auto in_bitmap_size = this->in_bitmap_size_buf.get_access<sycl::access::mode::write>(cgh);
+                auto out_bitmap_size = this->out_bitmap_size_buf.get_access<sycl::access::mode::read_write>(cgh);
+                cgh.parallel_for<class SwapBitmaps>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                      sycl::range<1>{THREAD_BLOCK_SIZE}},
+                [=](sycl::nd_item<1> my_item) {
+                    for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_WORDS; w += NUM_WORK_ITEMS) {
+                        out_bitmap[w] = 0;
+                    }
+                    if(my_item.get_global_id()[0] == 0) {
+                        in_bitmap_size[0] = out_bitmap_size[0];
+                        out_bitmap_size[0] = 0;
+                    }
+                });
+            });
+        }
+
+        /**
+         * Move the contents of *pipe*'s in-worklist into the in-bitmap,
+         * then fill the in-worklist with every node.
+         *
+         * ASSUMES the in-worklist has no duplicates
+         * and has capacity for every node.
+         */
+        void fromWorklist(sycl::queue &queue, Pipe &pipe) {
+            this->clearInBitmap(queue);
+            // mark every node on the in-worklist
+            queue.submit([&] (sycl::handler &cgh) {
+                const gpu_size_t NUM_WORK_ITEMS = THREAD_BLOCK_SIZE * this->NUM_WORK_GROUPS;
+                auto in_bitmap = this->in_bitmap_buf->get_access<sycl::access::mode::atomic>(cgh);
+                auto in_bitmap_size = this->in_bitmap_size_buf.get_access<sycl::access::mode::write>(cgh);
+                auto in_worklist = pipe.get_in_worklist_buf().get_access<sycl::access::mode::read>(cgh);
+                auto in_worklist_size = pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::read>(cgh);
+                cgh.parallel_for<class MarkWorklistInBitmap>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                               sycl::range<1>{THREAD_BLOCK_SIZE}},
+                [=](sycl::nd_item<1> my_item) {
+                    gpu_size_t size = in_worklist_size[0];
+                    for(gpu_size_t i = my_item.get_global_id()[0]; i < size; i += NUM_WORK_ITEMS) {
+                        index_type node = in_worklist[i];
+                        in_bitmap[node / BITMAP_WORD_BITS].fetch_or(((bitmap_word_t) 1) << (node % BITMAP_WORD_BITS));
+                    }
+                    if(my_item.get_global_id()[0] == 0) {
+                        in_bitmap_size[0] = size;
+                    }
+                });
+            });
+            // put every node on the in-worklist
+            queue.submit([&] (sycl::handler &cgh) {
+                const gpu_size_t NNODES = this->NNODES,
+                                 NUM_WORK_ITEMS = THREAD_BLOCK_SIZE * this->NUM_WORK_GROUPS;
+                InWorklist in_wl(pipe, cgh);
+                cgh.parallel_for<class FillWorklistWithAllNodes>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                                   sycl::range<1>{THREAD_BLOCK_SIZE}},
+                [=](sycl::nd_item<1> my_item) {
+                    in_wl.setSize(NNODES);
+                    for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                        in_wl.push(node, node);
+                    }
+                });
+            });
+        }
+
+        /**
+         * Replace the contents of *pipe*'s in-worklist with
+         * the nodes in the in-bitmap (in no particular order)
+         */
+        void toWorklist(sycl::queue &queue, Pipe &pipe) {
+            queue.submit([&] (sycl::handler &cgh) {
+                auto in_worklist_size = pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::write>(cgh);
+                cgh.single_task<class ResetInWorklistSize>([=]() {
+                    in_worklist_size[0] = 0;
+                });
+            });
+            queue.submit([&] (sycl::handler &cgh) {
+                const gpu_size_t NUM_WORDS = this->NUM_WORDS,
+                                 NUM_WORK_ITEMS = THREAD_BLOCK_SIZE * this->NUM_WORK_GROUPS;
+                // global accessors
+                auto in_bitmap = this->in_bitmap_buf->get_access<sycl::access::mode::read>(cgh);
+                auto in_worklist = pipe.get_in_worklist_buf().get_access<sycl::access::mode::write>(cgh);
+                auto in_worklist_size = pipe.get_in_worklist_size_buf().get_access<sycl::access::mode::atomic>(cgh);
+                // local accessors
+                sycl::accessor<gpu_size_t, 1,
+                               sycl::access::mode::atomic,
+                               sycl::access::target::local>
+                                   // number of nodes found by my group
+                                   group_count{sycl::range<1>{1}, cgh};
+                sycl::accessor<gpu_size_t, 1,
+                               sycl::access::mode::read_write,
+                               sycl::access::target::local>
+                                   // where my group's nodes start on the worklist
+                                   group_offset{sycl::range<1>{1}, cgh};
+
+                cgh.parallel_for<class CompactBitmapIntoWorklist>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                                    sycl::range<1>{THREAD_BLOCK_SIZE}},
+                [=](sycl::nd_item<1> my_item) {
+                    if(my_item.get_local_id()[0] == 0) {
+                        group_count[0].store(0);
+                    }
+                    my_item.barrier(sycl::access::fence_space::local_space);
+                    // count my nodes and reserve space for them within my group
+                    gpu_size_t my_count = 0;
+                    for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_WORDS; w += NUM_WORK_ITEMS) {
+                        my_count += sycl::popcount(in_bitmap[w]);
+                    }
+                    gpu_size_t my_index = group_count[0].fetch_add(my_count);
+                    my_item.barrier(sycl::access::fence_space::local_space);
+                    // reserve space for my group on the worklist
+                    if(my_item.get_local_id()[0] == 0) {
+                        group_offset[0] = in_worklist_size[0].fetch_add(group_count[0].load());
+                    }
+                    my_item.barrier(sycl::access::fence_space::local_space);
+                    my_index += group_offset[0];
+                    // write my nodes
+                    for(gpu_size_t w = my_item.get_global_id()[0]; w < NUM_WORDS; w += NUM_WORK_ITEMS) {
+                        bitmap_word_t word = in_bitmap[w];
+                        for(gpu_size_t bit = 0; word != 0; ++bit, word >>= 1) {
+                            if(word & 1) {
+                                in_worklist[my_index++] = w * BITMAP_WORD_BITS + bit;
+                            }
+                        }
+                    }
+                });
+            });
+        }
+};
+
+/**
+ * Read-only view of a BitmapFrontier's in-bitmap inside a kernel
+ */
+class InBitmap {
+    private:
+        // GLOBAL ACCESSORS
+        sycl::accessor<bitmap_word_t, 1,
+            sycl::access::mode::read,
+            sycl::access::target::global_buffer>
+                bitmap;
+    public:
+        InBitmap(BitmapFrontier &frontier, sycl::handler &cgh)
+            : bitmap{ frontier.get_in_bitmap_buf(), cgh }
+        { }
+
+        /**
+         * @return true iff *node* is in the in-bitmap
+         */
+        bool contains(index_type node) const {
+            return (bitmap[node / BITMAP_WORD_BITS] >> (node % BITMAP_WORD_BITS)) & 1;
+        }
+};
+
+/**
+ * Insert-only view of a BitmapFrontier's out-bitmap inside a kernel
+ */
+class OutBitmap {
+    private:
+        // GLOBAL ACCESSORS
+        sycl::accessor<bitmap_word_t, 1,
+            sycl::access::mode::atomic,
+            sycl::access::target::global_buffer>
+                bitmap;
+        sycl::accessor<gpu_size_t, 1,
+            sycl::access::mode::atomic,
+            sycl::access::target::global_buffer>
+                bitmap_size;
+    public:
+        OutBitmap(BitmapFrontier &frontier, sycl::handler &cgh)
+            : bitmap{ frontier.get_out_bitmap_buf(), cgh }
+            , bitmap_size{ frontier.get_out_bitmap_size_buf(), cgh }
+        { }
+
+        /**
+         * Insert node into the out-bitmap.
+         *
+         * @return true iff *node* was not already in the out-bitmap.
+         *         Exactly one inserter of a node sees true.
+         *
+         * NOTE: This isn't *really* const because it modifies the bitmap,
+         *       but we have to declare it as const for SYCL compilation
+         */
+        bool insert(index_type node) const {
+            bitmap_word_t bit = ((bitmap_word_t) 1) << (node % BITMAP_WORD_BITS);
+            bitmap_word_t prev = bitmap[node / BITMAP_WORD_BITS].fetch_or(bit);
+            if(prev & bit) {
+                return false;
+            }
+            bitmap_size[0].fetch_add(1);
+            return true;
+        }
+};
+
+#endif
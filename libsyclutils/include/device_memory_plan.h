@@ -0,0 +1,63 @@
+/**
+ * device_memory_plan.h
+ *
+ * Tallies the global-memory buffers an application is going to allocate
+ * on the device so that we can check them against the device limits
+ * before anything is actually allocated.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_DEVICE_MEMORY_PLAN_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_DEVICE_MEMORY_PLAN_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * A list of named device buffers and their sizes in bytes.
+ *
+ * Applications describe every global buffer they will create
+ * (for a given number of work-groups) by calling add(),
+ * and the driver compares the result against
+ * global_mem_size and max_mem_alloc_size.
+ */
+class DeviceMemoryPlan {
+    public:
+        /**
+         * Record a buffer which will be allocated on the device
+         *
+         * @param name a human-readable name for the buffer
+         * @param bytes the size of the buffer in bytes
+         */
+        void add(const char *name, size_t bytes);
+
+        /** Forget every buffer recorded so far */
+        void clear();
+
+        /** @return the sum of the sizes of all recorded buffers */
+        size_t total_bytes() const;
+
+        /** @return the size of the largest recorded buffer */
+        size_t largest_bytes() const;
+
+        /**
+         * @param global_mem_size the device's global memory size
+         * @param max_mem_alloc_size the device's maximum size of a single allocation
+         * @return true iff the total fits in global memory and every
+         *         buffer fits in a single allocation
+         */
+        bool fits(size_t global_mem_size, size_t max_mem_alloc_size) const;
+
+        /**
+         * Print a per-buffer breakdown and the device limits to *f*
+         */
+        void print(FILE *f, size_t global_mem_size, size_t max_mem_alloc_size) const;
+
+    private:
+        struct Entry {
+            std::string name;
+            size_t bytes;
+        };
+        std::vector<Entry> entries;
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*  -*- mode: c++ -*- */
+#include <CL/sycl.hpp>
+
+// index_type
+#include "sycl_csr_graph.h"
+// gpu_size_t
+#include "pipe.h"
+
+#ifndef BREADTHNPAGEINSYCL_LIBSYCLUTILS_FLOATATOMICS_
+#define BREADTHNPAGEINSYCL_LIBSYCLUTILS_FLOATATOMICS_
+
+namespace sycl = cl::sycl;
+
+// SYCL 1.2.1 atomics only support integers, so floats which need to be
+// updated atomically are stored as their bits in 32-bit words.
+typedef uint32_t float_bits_t;
+
+/**
+ * @return the float whose bits are *bits*
+ */
+inline float bits_to_float(float_bits_t bits) {
+    union { float_bits_t bits; float value; } convert;
+    convert.bits = bits;
+    return convert.value;
+}
+
+/**
+ * @return the bits of *value*
+ */
+inline float_bits_t float_to_bits(float value) {
+    union { float_bits_t bits; float value; } convert;
+    convert.value = value;
+    return convert.bits;
+}
+
+/**
+ * Atomically add *value* to the float stored in *word*
+ * using a compare-exchange loop.
+ *
+ * @return the float stored in *word* immediately before the addition
+ */
+template <sycl::access::address_space Space>
+float atomic_add_float(sycl::atomic<float_bits_t, Space> word, float value) {
+    float_bits_t expected = word.load();
+    while(true) {
+        float prev = bits_to_float(expected);
+        if(word.compare_exchange_strong(expected, float_to_bits(prev + value))) {
+            return prev;
+        }
+    }
+}
+
+/**
+ * Combines float updates headed for the same node within a work-group,
+ * so that a hub receiving many updates from one group costs
+ * one global atomic add instead of one per update.
+ *
+ * Each work-item owns a slot of local memory.
+ * combine() hashes a node to a slot and adds the update into that slot,
+ * unless the slot is already combining updates for a different node.
+ * After a local barrier, take() hands each work-item
+ * the combined update in its slot (if any) and clears the slot.
+ *
+ * Construct one per command group, and call initialize() from
+ * every work-item before the first barrier of the kernel.
+ */
+class GroupUpdateCombiner {
+    private:
+        const gpu_size_t WORK_GROUP_SIZE;
+        // value of an empty slot's node
+        static const gpu_size_t EMPTY_SLOT = std::numeric_limits<gpu_size_t>::max();
+        // LOCAL ACCESSORS
+        sycl::accessor<gpu_size_t, 1,
+            sycl::access::mode::atomic,
+            sycl::access::target::local>
+                // the node each slot is combining updates for
+                slot_node;
+        sycl::accessor<float_bits_t, 1,
+            sycl::access::mode::atomic,
+            sycl::access::target::local>
+                // the combined update of each slot
+                slot_update;
+    public:
+        GroupUpdateCombiner(gpu_size_t work_group_size, sycl::handler &cgh)
+            : WORK_GROUP_SIZE{ work_group_size }
+            , slot_node  { sycl::range<1>{work_group_size}, cgh }
+            , slot_update{ sycl::range<1>{work_group_size}, cgh }
+        { }
+
+        /**
+         * Clear my slot.
+         *
+         * NOTE: This isn't *really* const because it modifies local memory,
+         *       but we have to declare it as const for SYCL compilation
+         */
+        void initialize(const sycl::nd_item<1> &my_item) const {
+            slot_node[my_item.get_local_id()[0]].store(EMPTY_SLOT);
+            slot_update[my_item.get_local_id()[0]].store(float_to_bits(0.0f));
+        }
+
+        /**
+         * Try to combine *update* with the other updates to *node*
+         * made by my group.
+         *
+         * @return true iff the update was absorbed into a slot. If not,
+         *         the caller must apply the update itself.
+         *
+         * NOTE: This isn't *really* const because it modifies local memory,
+         *       but we have to declare it as const for SYCL compilation
+         */
+        bool combine(index_type node, float update) const {
+            gpu_size_t slot = node % WORK_GROUP_SIZE,
+                       expected = EMPTY_SLOT;
+            if(slot_node[slot].compare_exchange_strong(expected, (gpu_size_t) node)
+               || expected == node)
+            {
+                atomic_add_float(slot_update[slot], update);
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * Take the combined update out of my slot and clear the slot.
+         *
+         * Must be separated from all calls to combine() by local barriers.
+         *
+         * @return true iff my slot held an update, in which case it
+         *         was stored into *node* and *update*
+         *
+         * NOTE: This isn't *really* const because it modifies local memory,
+         *       but we have to declare it as const for SYCL compilation
+         */
+        bool take(const sycl::nd_item<1> &my_item, index_type &node, float &update) const {
+            gpu_size_t slot = my_item.get_local_id()[0],
+                       slot_contents = slot_node[slot].load();
+            if(slot_contents == EMPTY_SLOT) {
+                return false;
+            }
+            node = slot_contents;
+            update = bits_to_float(slot_update[slot].load());
+            slot_node[slot].store(EMPTY_SLOT);
+            slot_update[slot].store(float_to_bits(0.0f));
+            return true;
+        }
+};
+
+#endif
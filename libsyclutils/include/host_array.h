@@ -0,0 +1,154 @@
+/**
+ * host_array.h
+ *
+ * Page-backed, owning storage for the host's graph and per-node arrays.
+ *
+ * Each array is its own anonymous mapping, so it starts zeroed (like
+ * calloc) and its pages go back to the OS when it is released. Arrays
+ * of 2 MB or more are aligned to 2 MB and backed by huge pages, which
+ * cuts the TLB misses of random accesses on large graphs.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_HOST_ARRAY_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_HOST_ARRAY_
+
+#include <cstddef>
+
+enum HostPageMode {
+    // base pages only (transparent huge pages are refused)
+    HOST_PAGES_SMALL,
+    // ask for transparent huge pages with madvise (the default)
+    HOST_PAGES_TRANSPARENT,
+    // map from the hugetlbfs pool, falling back to transparent huge pages
+    // when it is empty
+    HOST_PAGES_EXPLICIT
+};
+
+// How HostArrays are backed (set by the driver's -M option)
+extern HostPageMode HOST_PAGE_MODE;
+
+/**
+ * How an array is expected to be accessed, passed on to madvise
+ */
+enum HostAccessHint {
+    HOST_ACCESS_NORMAL,
+    // scanned in order (e.g. edge destinations)
+    HOST_ACCESS_SEQUENTIAL,
+    // indexed by arbitrary nodes (e.g. node data)
+    HOST_ACCESS_RANDOM
+};
+
+/**
+ * @param name "small", "transparent" or "explicit"
+ * @return false if *name* is not a page mode
+ */
+bool parse_host_page_mode(const char *name, HostPageMode &mode);
+
+/**
+ * Map at least *bytes* zeroed bytes as set by HOST_PAGE_MODE
+ *
+ * @param mapped_bytes set to the length of the mapping
+ * @return the start of the mapping, or nullptr if out of memory
+ */
+void *host_pages_alloc(size_t bytes, HostAccessHint hint, size_t &mapped_bytes);
+
+/** Unmap a mapping from host_pages_alloc */
+void host_pages_free(void *ptr, size_t mapped_bytes);
+
+/**
+ * @return the bytes of this process's memory backed by huge pages
+ *         (transparent or explicit), or -1 if unknown
+ */
+long long host_huge_page_bytes();
+
+/**
+ * An owning array of *size()* Ts from host_pages_alloc.
+ * Move-only. Converts to T* so it can be indexed like the raw array
+ * it replaces.
+ */
+template <typename T>
+class HostArray {
+    private:
+        T *ptr;
+        size_t num_elements, num_mapped_bytes;
+
+    public:
+        HostArray()
+            : ptr{ nullptr }
+            , num_elements{ 0 }
+            , num_mapped_bytes{ 0 }
+        { }
+
+        HostArray(size_t count, HostAccessHint hint)
+            : HostArray()
+        {
+            allocate(count, hint);
+        }
+
+        ~HostArray() {
+            release();
+        }
+
+        HostArray(const HostArray &) = delete;
+        HostArray &operator=(const HostArray &) = delete;
+
+        HostArray(HostArray &&other) noexcept
+            : ptr{ other.ptr }
+            , num_elements{ other.num_elements }
+            , num_mapped_bytes{ other.num_mapped_bytes }
+        {
+            other.ptr = nullptr;
+            other.num_elements = other.num_mapped_bytes = 0;
+        }
+
+        HostArray &operator=(HostArray &&other) noexcept {
+            if(this != &other) {
+                release();
+                ptr = other.ptr;
+                num_elements = other.num_elements;
+                num_mapped_bytes = other.num_mapped_bytes;
+                other.ptr = nullptr;
+                other.num_elements = other.num_mapped_bytes = 0;
+            }
+            return *this;
+        }
+
+        /**
+         * Replace the contents with *count* zeroed Ts
+         *
+         * @return false if out of memory (leaving the array empty)
+         */
+        bool allocate(size_t count, HostAccessHint hint) {
+            release();
+            ptr = (T *) host_pages_alloc(count * sizeof(T), hint, num_mapped_bytes);
+            num_elements = ptr ? count : 0;
+            return ptr != nullptr;
+        }
+
+        /** Free the pages, leaving the array empty */
+        void release() {
+            if(ptr) {
+                host_pages_free(ptr, num_mapped_bytes);
+            }
+            ptr = nullptr;
+            num_elements = num_mapped_bytes = 0;
+        }
+
+        T *get() const {
+            return ptr;
+        }
+
+        size_t size() const {
+            return num_elements;
+        }
+
+        /** @return the length of the mapping, in whole pages */
+        size_t mapped_size() const {
+            return num_mapped_bytes;
+        }
+
+        operator T *() const {
+            return ptr;
+        }
+};
+
+#endif
@@ -16,6 +16,8 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 
+// HostArray
+#include "host_array.h"
 
 typedef size_t index_type ;
 typedef uint64_t node_data_type ;
@@ -24,17 +26,24 @@ typedef uint64_t node_data_type ;
  * A very simple CSR graph:
  *      - Can read from a *.gr file
  *
- *  Has node data but no edge data
+ *  Has node data but no edge data.
+ *  Owns its arrays (see host_array.h), so it can be moved but not copied,
+ *  and its memory is freed when it is destroyed or released.
  */ 
 struct Host_CSR_Graph {
-    // num nodes, num edges, index of first edge, edge destinations
-    index_type nnodes, nedges, *row_start, *edge_dst;
+    // num nodes, num edges
+    index_type nnodes, nedges;
+    // index of first edge, edge destinations
+    HostArray<index_type> row_start, edge_dst;
     // node data
-    node_data_type *node_data;
+    HostArray<node_data_type> node_data;
 
     /** Create an uninitialized CSR graph */
     Host_CSR_Graph() ;  
 
+    /** Free the arrays, leaving an empty graph (e.g. before loading another) */
+    void release() ;
+
     /**
      * read a graph from a *.gr file into this object
      *
@@ -47,6 +56,41 @@ struct Host_CSR_Graph {
      */
     unsigned readFromGR(char file[]);
 
+    /**
+     * fill this object with the transpose of a CSR graph
+     *
+     * The transpose has an edge dst -> src for every edge
+     * src -> dst of the given graph, so the out-edges of a node in
+     * the transpose are its in-edges in the given graph.
+     * Each node's edges are sorted by destination. A transpose is only
+     * read for its edges, so it gets no node data.
+     *
+     * @param nnodes the number of nodes of the graph to transpose
+     * @param nedges the number of edges of the graph to transpose
+     * @param row_start the index of the first edge of each node (nnodes+1 entries)
+     * @param edge_dst the destination of each edge (nedges entries)
+     * @return 0 iff successful
+     */
+    unsigned buildTranspose(index_type nnodes, index_type nedges,
+                            const index_type *row_start, const index_type *edge_dst);
+
+    /**
+     * fill this object with the undirected graph of an edge list
+     *
+     * Each edge {src, dst} becomes the two edges src -> dst and
+     * dst -> src, except that a self-loop becomes a single edge.
+     * Duplicate edges are kept. Each node's edges are in the order
+     * they appear in the edge list.
+     *
+     * @param nnodes the number of nodes
+     * @param nedges the number of edges in the edge list
+     * @param edge_src the first endpoint of each edge (nedges entries)
+     * @param edge_dst the second endpoint of each edge (nedges entries)
+     * @return 0 iff successful
+     */
+    unsigned buildUndirected(index_type nnodes, index_type nedges,
+                             const index_type *edge_src, const index_type *edge_dst);
+
     /**
      * @param node the index of a node
      * @return true iff *node* is a valid index
@@ -137,11 +181,14 @@ struct Host_CSR_Graph {
     }
 
     private:
-        /** allocate the arrays in memory 
-         * 
+        /** allocate the arrays in memory, replacing any already allocated.
+         *  Edge destinations are advised for sequential scans, and
+         *  node data for random access.
+         *
+         * @param with_node_data false to leave node_data empty
          * @return true if successful
          * */
-        unsigned allocSpace() ;  
+        unsigned allocSpace(bool with_node_data = true) ;  
 
         /** Print utility used by `readFromGR` */
         void progressPrint(unsigned maxii, unsigned ii);
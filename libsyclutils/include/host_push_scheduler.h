@@ -0,0 +1,112 @@
+/**
+ * host_push_scheduler.h
+ *
+ * The host backend's counterpart of PushScheduler: applies a push
+ * operator to the out-edges of each node of a frontier on a
+ * HostThreadPool.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_HOST_PUSH_SCHEDULER_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_HOST_PUSH_SCHEDULER_
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// Host_CSR_Graph index_type
+#include "host_csr_graph.h"
+// HostThreadPool
+#include "host_thread_pool.h"
+
+// number of frontier nodes per chunk of scheduling
+#define HOST_CHUNK_SIZE 64
+
+/**
+ * Atomically add *value* to *word*
+ *
+ * @return the value of *word* immediately before the addition
+ */
+inline float host_atomic_add_float(std::atomic<float> &word, float value) {
+    float prev = word.load(std::memory_order_relaxed);
+    // on failure, *prev* is reloaded
+    while(!word.compare_exchange_weak(prev, prev + value, std::memory_order_relaxed)) { }
+    return prev;
+}
+
+/**
+ * A thread's own portion of the out-worklist.
+ * Pushing never fails and needs no atomics.
+ */
+class HostOutWorklist {
+    private:
+        std::vector<index_type> &chunk;
+    public:
+        explicit HostOutWorklist(std::vector<index_type> &chunk)
+            : chunk{ chunk }
+        { }
+
+        bool push(index_type node) const {
+            chunk.push_back(node);
+            return true;
+        }
+};
+
+/**
+ * Like PushScheduler, a HostPushOperator provides
+ *  - bool isActive(index_type node) const
+ *      (false to skip *node* without reading its edges)
+ *  - void applyPushOperator(const HostOutWorklist &out_wl,
+ *                           index_type src_node, index_type edge_index)
+ *
+ * The frontier is split into chunks of HOST_CHUNK_SIZE nodes, which the
+ * threads take dynamically (stealing when they run out). Each thread
+ * pushes onto its own out-worklist, and the thread's out-worklists are
+ * concatenated into the next frontier.
+ */
+template <class HostPushOperator>
+class HostPushScheduler {
+    private:
+        HostThreadPool &pool;
+        const Host_CSR_Graph &graph;
+        // each thread's out-worklist
+        std::vector<std::vector<index_type> > out_chunks;
+    public:
+        HostPushScheduler(HostThreadPool &pool, const Host_CSR_Graph &graph)
+            : pool{ pool }
+            , graph{ graph }
+            , out_chunks( pool.size() )
+        { }
+
+        /**
+         * Apply *op* to every out-edge of the active nodes of *frontier*,
+         * then replace *frontier* with the nodes pushed (in no particular order)
+         */
+        void run(HostPushOperator &op, std::vector<index_type> &frontier) {
+            for(auto &chunk : out_chunks) {
+                chunk.clear();
+            }
+            pool.parallel_for_range(frontier.size(), HOST_CHUNK_SIZE,
+            [&](unsigned thread, size_t first, size_t last) {
+                HostOutWorklist out_wl{ out_chunks[thread] };
+                for(size_t i = first; i < last; ++i) {
+                    index_type src_node = frontier[i];
+                    if(!op.isActive(src_node)) {
+                        continue;
+                    }
+                    for(index_type edge = graph.row_start[src_node]; edge < graph.row_start[src_node + 1]; ++edge) {
+                        op.applyPushOperator(out_wl, src_node, edge);
+                    }
+                }
+            });
+            // concatenate the out-worklists
+            std::vector<size_t> offsets(out_chunks.size() + 1, 0);
+            for(size_t t = 0; t < out_chunks.size(); ++t) {
+                offsets[t + 1] = offsets[t] + out_chunks[t].size();
+            }
+            frontier.resize(offsets.back());
+            pool.parallel_for(out_chunks.size(), [&](unsigned, size_t t) {
+                std::copy(out_chunks[t].begin(), out_chunks[t].end(), frontier.begin() + offsets[t]);
+            });
+        }
+};
+
+#endif
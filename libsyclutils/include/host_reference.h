@@ -0,0 +1,56 @@
+/**
+ * host_reference.h
+ *
+ * Multi-threaded, vectorized host implementations of BFS and PageRank.
+ * They are the validation oracle for the SYCL variants (-V), and the
+ * host backend (-H) of bfs-direction-optimizing and
+ * pagerank-pull-topology-driven.
+ *
+ * The inner loops are written with AVX-512 and AVX2 intrinsics, and
+ * the widest version the CPU supports is picked at runtime
+ * (with a portable fallback for other CPUs and compilers).
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_HOST_REFERENCE_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_HOST_REFERENCE_
+
+// Host_CSR_Graph index_type node_data_type
+#include "host_csr_graph.h"
+// HostThreadPool
+#include "host_thread_pool.h"
+
+/**
+ * @return the name of the instruction set the kernels were dispatched to
+ *         ("avx512", "avx2" or "portable")
+ */
+const char *host_reference_isa();
+
+/**
+ * Direction-optimizing BFS over bitmap frontiers.
+ * Levels switch between top-down (over *graph*) and bottom-up
+ * (over *transpose*) with the same heuristic as bfs-direction-optimizing.
+ *
+ * @param transpose the transpose of *graph* (see Host_CSR_Graph::buildTranspose)
+ * @param levels set to the level of each node, or *unvisited*
+ * @return the number of levels
+ */
+size_t reference_bfs(HostThreadPool &pool,
+                     const Host_CSR_Graph &graph, const Host_CSR_Graph &transpose,
+                     index_type start_node, node_data_type unvisited,
+                     node_data_type *levels);
+
+/**
+ * Pull-based (Jacobi) PageRank: each iteration sets
+ *      rank[v] = (1 - alpha) + alpha * sum_{u -> v} rank[u] / out_degree(u)
+ * over the in-edges in *transpose*, until no rank changes by more than
+ * *epsilon* times max(1, rank), or after *max_iterations* iterations.
+ * (Relative to large ranks, as their float spacing may exceed *epsilon*.)
+ *
+ * @param ranks set to the rank of each node
+ * @return the number of iterations
+ */
+int reference_pagerank(HostThreadPool &pool,
+                       const Host_CSR_Graph &graph, const Host_CSR_Graph &transpose,
+                       float alpha, float epsilon, int max_iterations,
+                       float *ranks);
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * host_sell_graph.h
+ *
+ * A SELL-C-sigma (sliced ELLPACK) copy of a CSR graph's adjacency,
+ * as described in Kreutzer et al., "A unified sparse matrix data format
+ * for efficient general sparse matrix-vector multiplication on modern
+ * processors with wide SIMD units" (SISC 2014).
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_HOST_SELL_GRAPH_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_HOST_SELL_GRAPH_
+
+// index_type HostArray
+#include "host_csr_graph.h"
+
+/**
+ * Rows (nodes) are grouped into slices of *slice_height* consecutive rows.
+ * Within each window of *sort_window* rows, rows are first sorted by
+ * decreasing degree, so that rows of similar length share a slice.
+ *
+ * Each slice is padded to the degree of its longest row and stored
+ * column-major: the j-th neighbor of the r-th row of slice s is at
+ *
+ *      neighbors[slice_start[s] + j * slice_height + r]
+ *
+ * so that *slice_height* work-items working on the rows of a slice
+ * read consecutive entries.
+ *
+ * Padding entries and the rows padding out the last slice
+ * refer to the dummy node *nnodes*.
+ *
+ * Like Host_CSR_Graph, it owns its arrays.
+ */
+struct Host_SELL_Graph {
+    // num nodes, rows per slice, num slices,
+    // num entries (including padding)
+    index_type nnodes, slice_height, nslices, nentries;
+    // index of the first entry of each slice (nslices+1 entries)
+    HostArray<index_type> slice_start;
+    // the node stored in each row (nslices*slice_height entries)
+    HostArray<index_type> row_node;
+    // the neighbor stored in each entry (nentries entries)
+    HostArray<index_type> neighbors;
+
+    /** Create an empty SELL graph */
+    Host_SELL_Graph() ;
+
+    /**
+     * fill this object with the adjacency of a CSR graph
+     *
+     * To sweep over in-edges, pass in a transpose
+     * (see Host_CSR_Graph::buildTranspose).
+     *
+     * @param nnodes the number of nodes of the CSR graph
+     * @param row_start the index of the first edge of each node (nnodes+1 entries)
+     * @param edge_dst the destination of each edge
+     * @param slice_height the number of rows in each slice (C)
+     * @param sort_window the number of rows sorted together by degree (sigma),
+     *                    a multiple of *slice_height*
+     * @return 0 iff successful
+     */
+    unsigned buildFromCSR(index_type nnodes,
+                          const index_type *row_start, const index_type *edge_dst,
+                          index_type slice_height, index_type sort_window);
+
+    /**
+     * @return the number of padding entries divided by the number of edges
+     */
+    double padding_overhead() const ;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/**
+ * host_thread_pool.h
+ *
+ * A pool of host threads which splits loops into chunks and
+ * balances them by work-stealing. Used by the host backend (-H).
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_HOST_THREAD_POOL_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_HOST_THREAD_POOL_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+/**
+ * A fixed set of threads (the calling thread is thread 0) which run
+ * the chunks of a loop.
+ *
+ * Each thread starts with a contiguous range of chunks and takes them
+ * one at a time from the front. Once its range is empty, it steals the
+ * back half of another thread's range. Ranges are a (begin, end) pair
+ * packed into one 64-bit word, so taking and stealing are each a single
+ * compare-exchange.
+ *
+ * With PIN_HOST_THREADS (see numa_placement.h), each thread is pinned
+ * to a CPU, and the calling thread's affinity is restored on destruction.
+ */
+class HostThreadPool {
+    public:
+        /**
+         * @param num_threads the number of threads, or 0 to use
+         *                    one per hardware thread
+         */
+        explicit HostThreadPool(unsigned num_threads);
+        ~HostThreadPool();
+
+        unsigned size() const {
+            return this->num_threads;
+        }
+
+        /**
+         * Call body(thread, chunk) once for each chunk in [0, num_chunks),
+         * and return once every call has returned.
+         * *thread* is the index in [0, size()) of the calling thread.
+         */
+        void parallel_for(size_t num_chunks,
+                          const std::function<void(unsigned, size_t)> &body);
+
+        /**
+         * Call body(thread, first, last) over [0, n) in chunks of
+         * (at most) *chunk_size* indices
+         */
+        void parallel_for_range(size_t n, size_t chunk_size,
+                                const std::function<void(unsigned, size_t, size_t)> &body);
+
+        /**
+         * Call body(thread) exactly once on each thread, and return once
+         * every call has returned. Nothing is stolen, so each thread's
+         * work runs on that thread's CPU.
+         */
+        void for_each_thread(const std::function<void(unsigned)> &body);
+
+    private:
+        // a thread's range of chunks, on its own cache line
+        struct alignas(64) ChunkRange {
+            std::atomic<uint64_t> range;
+        };
+
+        const unsigned num_threads;
+        std::vector<std::thread> workers;
+        std::unique_ptr<ChunkRange[]> ranges;
+        const std::function<void(unsigned, size_t)> *body;
+        // set instead of *body* by for_each_thread
+        const std::function<void(unsigned)> *each_body;
+        // the calling thread's affinity before it was pinned
+        cpu_set_t caller_affinity;
+        bool caller_pinned;
+
+        // wake workers for each loop and wait for them to finish it
+        std::mutex mutex;
+        std::condition_variable start_loop, finish_loop;
+        size_t generation;
+        unsigned num_busy;
+        bool stopping;
+
+        /** Run chunks as *thread* until no thread has any left */
+        void work(unsigned thread);
+        /** Move half of another thread's chunks to *thread*. @return false if none are left */
+        bool steal(unsigned thread);
+        /** Wake the workers to run the current loop, run thread 0's share and wait */
+        void run_loop();
+        /** Body of each worker thread */
+        void worker_loop(unsigned thread);
+};
+
+#endif
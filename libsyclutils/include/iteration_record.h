@@ -0,0 +1,88 @@
+/**
+ * iteration_record.h
+ *
+ * Per-iteration statistics of the data-driven applications (the
+ * driver's -I option), once they have been read back from the device.
+ * The device side is in iteration_stats.h.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_ITERATION_RECORD_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_ITERATION_RECORD_
+
+#include <cstddef>
+#include <vector>
+
+// Where to write per-iteration statistics ("-" for a table on stderr,
+// a table or, if the name ends in .json, JSON otherwise), or nullptr to
+// not collect them (set by the driver's -I option)
+extern const char *ITERATION_STATS_FILE;
+// false for runs whose statistics are not wanted: with -B, the driver
+// only records the run whose result it checks in each configuration
+extern bool RECORD_ITERATION_STATS;
+
+/**
+ * The counters kept on the device for each iteration
+ */
+enum IterationCounter {
+    // edges the push operator was applied to
+    ITERATION_EDGES,
+    // pushes onto the out-worklist (or insertions into the out-bitmap)
+    ITERATION_PUSHES,
+    // pushes which failed because a group's portion of the out-worklist
+    // was full (each forces a rerun)
+    ITERATION_PUSH_FAILURES,
+    // entries in the groups' portions of the out-worklist before
+    // compression, and the contiguous portion before and after it.
+    // Compression only moves entries, so any shortfall was de-duped.
+    ITERATION_QUEUED,
+    ITERATION_CONTIGUOUS_BEFORE,
+    ITERATION_CONTIGUOUS_AFTER,
+    NUM_ITERATION_COUNTERS
+};
+
+/**
+ * The phases of an iteration whose kernels are timed
+ */
+enum IterationPhase {
+    // the push scheduler
+    ITERATION_SCHEDULE,
+    // Pipe::compress's de-duping kernels
+    ITERATION_DEDUPE,
+    // Pipe::compress's compaction kernels
+    ITERATION_COMPRESS,
+    // the application's per-node update (or reset) kernels
+    ITERATION_UPDATE,
+    NUM_ITERATION_PHASES
+};
+
+/**
+ * One launch of the push scheduler (a rerun of an iteration gets its
+ * own record)
+ */
+struct IterationRecord {
+    size_t iteration;
+    // the frontier was a bitmap
+    bool dense;
+    // the out-worklist overflowed, so the iteration was run again
+    bool rerun;
+    size_t frontier_size;
+    size_t counters[NUM_ITERATION_COUNTERS];
+    // the sum of the device times of the phase's kernels
+    double phase_ms[NUM_ITERATION_PHASES];
+
+    /** @return the out-worklist entries removed as duplicates */
+    size_t duplicates() const {
+        size_t before = counters[ITERATION_CONTIGUOUS_BEFORE] + counters[ITERATION_QUEUED];
+        return before > counters[ITERATION_CONTIGUOUS_AFTER]
+               ? before - counters[ITERATION_CONTIGUOUS_AFTER] : 0;
+    }
+};
+
+/**
+ * Write *records* to ITERATION_STATS_FILE
+ *
+ * @param dropped the number of launches after the last record, whose
+ *                statistics did not fit on the device
+ */
+void write_iteration_stats(const std::vector<IterationRecord> &records, size_t dropped);
+
+#endif
@@ -0,0 +1,286 @@
+/*  -*- mode: c++ -*- */
+#include <vector>
+#include <CL/sycl.hpp>
+
+// Pipe PipeEvents gpu_size_t
+#include "pipe.h"
+// IterationRecord IterationCounter IterationPhase write_iteration_stats ITERATION_STATS_FILE
+#include "iteration_record.h"
+
+#ifndef BREADTHNPAGEINSYCL_LIBSYCLUTILS_ITERATION_STATS_
+#define BREADTHNPAGEINSYCL_LIBSYCLUTILS_ITERATION_STATS_
+
+namespace sycl = cl::sycl;
+
+// classes used to name kernels
+class RecordQueued;
+class RecordCompressed;
+
+// The most push scheduler launches whose counters are kept
+#define ITERATION_STATS_CAPACITY ((size_t) 1 << 16)
+
+/**
+ * Collects per-iteration statistics of a data-driven application
+ * when ITERATION_STATS_FILE and RECORD_ITERATION_STATS are set (and does
+ * nothing otherwise).
+ *
+ * Each launch of the push scheduler gets a row of counters in a device
+ * buffer, which is only read back by report(), and the events of the
+ * kernels in each phase are kept so that their device times can be
+ * read then too. Usage, once per launch:
+ *
+ *   stats.begin(iteration, frontier_size, dense);
+ *   stats.add_event(ITERATION_SCHEDULE, <submit the scheduler>);
+ *   stats.record_queued(queue, pipe);
+ *   pipe.compress(queue, dedupe, stats.pipe_events());
+ *   stats.record_compressed(queue, pipe);
+ *   stats.end(rerun);
+ *
+ * with the operator counting into an IterationCounters.
+ */
+class IterationStats {
+    private:
+        struct Launch {
+            size_t iteration;
+            bool dense, rerun;
+            gpu_size_t frontier_size;
+            std::vector<sycl::event> events[NUM_ITERATION_PHASES];
+            PipeEvents pipe_events;
+        };
+
+        const bool ENABLED;
+        const size_t CAPACITY;
+        // NUM_ITERATION_COUNTERS counters for each launch
+        sycl::buffer<gpu_size_t, 1> counters_buf;
+        std::vector<Launch> launches;
+        // true iff the current launch has a row
+        bool recording = false;
+        // launches which did not fit
+        size_t dropped = 0;
+
+    public:
+        IterationStats()
+            : ENABLED{ ITERATION_STATS_FILE != nullptr && RECORD_ITERATION_STATS }
+            , CAPACITY{ ENABLED ? ITERATION_STATS_CAPACITY : (size_t) 1 }
+            , counters_buf{ sycl::range<1>{CAPACITY * NUM_ITERATION_COUNTERS} }
+        { }
+
+        /**
+         * The number of bytes of device global memory an IterationStats
+         * will allocate (none unless statistics are being collected)
+         */
+        static size_t device_footprint() {
+            return ITERATION_STATS_FILE ? ITERATION_STATS_CAPACITY * NUM_ITERATION_COUNTERS * sizeof(gpu_size_t)
+                                        : 0;
+        }
+
+        /** Zero the counters */
+        void initialize(sycl::queue &queue) {
+            if(!ENABLED) {
+                return;
+            }
+            queue.submit([&] (sycl::handler &cgh) {
+                auto counters = counters_buf.get_access<sycl::access::mode::discard_write>(cgh);
+                cgh.fill(counters, (gpu_size_t) 0);
+            });
+        }
+
+        /** @return true iff counts should go into the current launch's row */
+        bool is_recording() const {
+            return recording;
+        }
+
+        /** @return the index of the current launch's first counter */
+        gpu_size_t row_offset() const {
+            return recording ? (launches.size() - 1) * NUM_ITERATION_COUNTERS : 0;
+        }
+
+        sycl::buffer<gpu_size_t, 1>& get_counters_buf() {
+            return counters_buf;
+        }
+
+        /**
+         * Start a row for the next launch of the push scheduler
+         *
+         * @param iteration the level or iteration being run
+         * @param frontier_size the number of nodes in the frontier
+         * @param dense true iff the frontier is a bitmap
+         */
+        void begin(size_t iteration, gpu_size_t frontier_size, bool dense) {
+            if(!ENABLED) {
+                return;
+            }
+            recording = launches.size() < CAPACITY;
+            if(!recording) {
+                ++dropped;
+                return;
+            }
+            launches.push_back(Launch{ iteration, dense, false, frontier_size });
+        }
+
+        /** Time *event* as part of *phase* of the current launch */
+        void add_event(IterationPhase phase, sycl::event event) {
+            if(recording) {
+                launches.back().events[phase].push_back(event);
+            }
+        }
+
+        /** @return where Pipe::compress should put its events, or nullptr */
+        PipeEvents *pipe_events() {
+            return recording ? &launches.back().pipe_events : nullptr;
+        }
+
+        /**
+         * Record the size of *pipe*'s out-worklist before it is compressed
+         */
+        void record_queued(sycl::queue &queue, Pipe &pipe) {
+            if(!recording) {
+                return;
+            }
+            queue.submit([&] (sycl::handler &cgh) {
+                auto sizes = pipe.get_out_worklist_sizes_buf().get_access<sycl::access::mode::read>(cgh);
+                auto offsets = pipe.get_out_worklist_offsets_buf().get_access<sycl::access::mode::read>(cgh);
+                auto counters = counters_buf.get_access<sycl::access::mode::read_write>(cgh);
+                const gpu_size_t ROW = row_offset(),
+                                 NUM_WORK_GROUPS = pipe.get_num_work_groups();
+                cgh.single_task<class RecordQueued>([=]() {
+                    gpu_size_t queued = 0;
+                    for(gpu_size_t wg = 0; wg < NUM_WORK_GROUPS; ++wg) {
+                        queued += sizes[wg];
+                    }
+                    counters[ROW + ITERATION_QUEUED] = queued;
+                    counters[ROW + ITERATION_CONTIGUOUS_BEFORE] = offsets[0];
+                });
+            });
+        }
+
+        /**
+         * Record the size of *pipe*'s out-worklist after it was compressed
+         */
+        void record_compressed(sycl::queue &queue, Pipe &pipe) {
+            if(!recording) {
+                return;
+            }
+            queue.submit([&] (sycl::handler &cgh) {
+                auto offsets = pipe.get_out_worklist_offsets_buf().get_access<sycl::access::mode::read>(cgh);
+                auto counters = counters_buf.get_access<sycl::access::mode::read_write>(cgh);
+                const gpu_size_t ROW = row_offset();
+                cgh.single_task<class RecordCompressed>([=]() {
+                    counters[ROW + ITERATION_CONTIGUOUS_AFTER] = offsets[0];
+                });
+            });
+        }
+
+        /**
+         * Finish the current launch's row
+         *
+         * @param rerun true iff the launch overflowed and must be run again
+         */
+        void end(bool rerun) {
+            if(recording) {
+                launches.back().rerun = rerun;
+            }
+            recording = false;
+        }
+
+        /**
+         * Read the counters and event times back from the device and
+         * write them to ITERATION_STATS_FILE
+         */
+        void report() {
+            if(!ENABLED) {
+                return;
+            }
+            auto counters = counters_buf.get_access<sycl::access::mode::read>();
+            std::vector<IterationRecord> records;
+            for(size_t i = 0; i < launches.size(); ++i) {
+                Launch &launch = launches[i];
+                IterationRecord record = {};
+                record.iteration = launch.iteration;
+                record.dense = launch.dense;
+                record.rerun = launch.rerun;
+                record.frontier_size = launch.frontier_size;
+                for(int c = 0; c < NUM_ITERATION_COUNTERS; ++c) {
+                    record.counters[c] = counters[i * NUM_ITERATION_COUNTERS + c];
+                }
+                launch.events[ITERATION_DEDUPE].insert(launch.events[ITERATION_DEDUPE].end(),
+                                                       launch.pipe_events.dedupe.begin(),
+                                                       launch.pipe_events.dedupe.end());
+                launch.events[ITERATION_COMPRESS].insert(launch.events[ITERATION_COMPRESS].end(),
+                                                         launch.pipe_events.compress.begin(),
+                                                         launch.pipe_events.compress.end());
+                for(int phase = 0; phase < NUM_ITERATION_PHASES; ++phase) {
+                    for(sycl::event &event : launch.events[phase]) {
+                        auto start = event.get_profiling_info<sycl::info::event_profiling::command_start>(),
+                             end = event.get_profiling_info<sycl::info::event_profiling::command_end>();
+                        record.phase_ms[phase] += (end - start) / 1e6;
+                    }
+                }
+                records.push_back(record);
+            }
+            write_iteration_stats(records, dropped);
+        }
+};
+
+/**
+ * The device side of an IterationStats, for push operators (usually
+ * kept in their OperatorInfo). Counts are summed in local memory and
+ * added to the launch's row once per group, by publish().
+ */
+class IterationCounters {
+    private:
+        const bool ENABLED;
+        const gpu_size_t ROW;
+        sycl::accessor<gpu_size_t, 1,
+                       sycl::access::mode::atomic,
+                       sycl::access::target::global_buffer>
+                           counters;
+        sycl::accessor<gpu_size_t, 1,
+                       sycl::access::mode::atomic,
+                       sycl::access::target::local>
+                           group_counters;
+
+    public:
+        IterationCounters(IterationStats &stats, sycl::handler &cgh)
+            : ENABLED{ stats.is_recording() }
+            , ROW{ stats.row_offset() }
+            , counters{ stats.get_counters_buf(), cgh }
+            , group_counters{ sycl::range<1>{NUM_ITERATION_COUNTERS}, cgh }
+        { }
+
+        /**
+         * Zero the group's counts. Local memory must be synchronized
+         * before the first add().
+         */
+        void initialize(const sycl::nd_item<1> &my_item) const {
+            if(ENABLED && my_item.get_local_id()[0] == 0) {
+                for(int c = 0; c < NUM_ITERATION_COUNTERS; ++c) {
+                    group_counters[c].store(0);
+                }
+            }
+        }
+
+        /** Count *n* more of *counter* */
+        void add(IterationCounter counter, gpu_size_t n = 1) const {
+            if(ENABLED) {
+                group_counters[counter].fetch_add(n);
+            }
+        }
+
+        /**
+         * Add the group's counts to the launch's row. Local memory must
+         * be synchronized after the last add().
+         */
+        void publish(const sycl::nd_item<1> &my_item) const {
+            if(ENABLED && my_item.get_local_id()[0] == 0) {
+                for(int c = 0; c < NUM_ITERATION_COUNTERS; ++c) {
+                    gpu_size_t count = group_counters[c].load();
+                    if(count > 0) {
+                        counters[ROW + c].fetch_add(count);
+                    }
+                }
+            }
+        }
+};
+
+#endif
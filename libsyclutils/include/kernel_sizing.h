@@ -4,4 +4,10 @@
 #define THREAD_BLOCK_SIZE 256
 #define WARP_SIZE 32
 
+// SELL-C-sigma slice height (C) and sorting window (sigma).
+// THREAD_BLOCK_SIZE must be a multiple of SELL_SLICE_HEIGHT,
+// and SELL_SORT_WINDOW must be a multiple of SELL_SLICE_HEIGHT.
+#define SELL_SLICE_HEIGHT WARP_SIZE
+#define SELL_SORT_WINDOW 1024
+
 #endif
@@ -0,0 +1,47 @@
+/**
+ * kronecker_generator.h
+ *
+ * Generates the Kronecker (R-MAT) edge lists used by the Graph500
+ * benchmark, as described in
+ * https://graph500.org/?page_id=12#sec-3_3
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_KRONECKER_GENERATOR_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_KRONECKER_GENERATOR_
+
+#include <cstdint>
+#include <vector>
+
+// index_type
+#include "host_csr_graph.h"
+
+// Graph500 parameters: the number of edges per node,
+// and the initiator probabilities (D = 1 - A - B - C)
+#define KRONECKER_EDGE_FACTOR 16
+#define KRONECKER_A 0.57
+#define KRONECKER_B 0.19
+#define KRONECKER_C 0.19
+
+// Edges are generated in chunks of this many, each with its own
+// random number generator, so the edge list only depends on the seed
+// and not on the number of threads.
+#define KRONECKER_CHUNK_SIZE (1 << 20)
+
+/**
+ * Generate the edge list of a Kronecker graph with 2^*scale* nodes and
+ * *edge_factor* * 2^*scale* edges, with node labels randomly permuted
+ * and edges in random order.
+ *
+ * The edges are undirected tuples, and may include
+ * self-loops and duplicates.
+ *
+ * @param scale log2 of the number of nodes
+ * @param edge_factor the number of edges per node
+ * @param seed the seed for the random number generators
+ * @param edge_src set to the first endpoint of each edge
+ * @param edge_dst set to the second endpoint of each edge
+ */
+void generate_kronecker_edges(unsigned scale, unsigned edge_factor, uint64_t seed,
+                              std::vector<index_type> &edge_src,
+                              std::vector<index_type> &edge_dst);
+
+#endif
@@ -0,0 +1,91 @@
+/**
+ * numa_placement.h
+ *
+ * NUMA-aware placement of a Host_CSR_Graph and pinning of host threads
+ * (the driver's -N option).
+ *
+ * The topology is read from /sys/devices/system/node and placement uses
+ * the mbind and move_pages system calls directly, so libnuma is not needed.
+ * On machines (or containers) without NUMA, everything falls back to a
+ * single node.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_NUMA_PLACEMENT_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_NUMA_PLACEMENT_
+
+// HostArray HostAccessHint
+#include "host_array.h"
+// Host_CSR_Graph
+#include "host_csr_graph.h"
+// HostThreadPool
+#include "host_thread_pool.h"
+
+enum NumaPolicy {
+    // leave the graph where the loader put it (all on one node)
+    NUMA_NONE,
+    // copy each thread's partition of nodes (and their edges) from that
+    // thread, so it lands on the thread's node
+    NUMA_FIRST_TOUCH,
+    // spread the pages round-robin over all nodes
+    NUMA_INTERLEAVE
+};
+
+// The placement of the host graph and per-node arrays
+// (set by the driver's -N option)
+extern NumaPolicy NUMA_POLICY;
+
+// If set, HostThreadPools pin their threads with numa_thread_cpu
+// (set by the driver's -N option, unless the policy is none)
+extern bool PIN_HOST_THREADS;
+
+/**
+ * @param name "none", "first-touch" or "interleave"
+ * @return false if *name* is not a policy
+ */
+bool parse_numa_policy(const char *name, NumaPolicy &policy);
+
+/**
+ * The CPU to pin thread *thread* of *num_threads* to.
+ * Threads are spread evenly over the allowed CPUs in node order, so
+ * consecutive threads (and so consecutive partitions of a loop) share a node.
+ */
+int numa_thread_cpu(unsigned thread, unsigned num_threads);
+
+/**
+ * Pin the calling thread to *cpu*
+ *
+ * @return false if the affinity could not be set
+ */
+bool pin_current_thread(int cpu);
+
+/**
+ * Move the arrays of *graph* to memory placed by *policy*, copying in
+ * parallel on *pool*, and report where the pages ended up.
+ * Each thread copies a contiguous partition of the nodes, the same
+ * partition HostThreadPool::parallel_for starts each thread with.
+ */
+void numa_place_graph(Host_CSR_Graph &graph, NumaPolicy policy, HostThreadPool &pool);
+
+/**
+ * Interleave the pages of the mapping [addr, addr + bytes) if
+ * NUMA_POLICY is NUMA_INTERLEAVE. Otherwise they are left untouched, so
+ * the first thread to write each page places it.
+ */
+void numa_place_pages(void *addr, size_t bytes);
+
+/**
+ * Allocate *count* zeroed Ts into *array* for an app's per-node array
+ * (e.g. PageRank's ranks), backed like the graph's arrays by huge pages
+ * and placed by NUMA_POLICY
+ *
+ * @return false if out of memory
+ */
+template <typename T>
+bool numa_alloc_node_array(HostArray<T> &array, size_t count, HostAccessHint hint) {
+    if(!array.allocate(count, hint)) {
+        return false;
+    }
+    numa_place_pages(array.get(), array.mapped_size());
+    return true;
+}
+
+#endif
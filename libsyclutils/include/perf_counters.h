@@ -0,0 +1,112 @@
+/**
+ * perf_counters.h
+ *
+ * Hardware counters of the driver's phases (the -P option), read with
+ * the perf_event_open system call, so neither libpfm nor the perf tool
+ * is needed.
+ *
+ * Only user-space events of this process are counted, and the counters
+ * are inherited by threads started after they are opened (the host
+ * backend's pool and a CPU device's runtime threads). Kernels on a GPU
+ * are not counted, only the host threads driving them.
+ *
+ * Counters the kernel or hardware does not provide (e.g. in VMs and
+ * containers, or with a restrictive perf_event_paranoid) are reported
+ * as unavailable, and the phase times are still reported.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_PERF_COUNTERS_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_PERF_COUNTERS_
+
+#include <chrono>
+#include <cstdio>
+
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    // last-level cache misses
+    PERF_LLC_MISSES,
+    // data TLB read misses
+    PERF_DTLB_MISSES,
+    NUM_PERF_EVENTS
+};
+
+enum PerfPhase {
+    // reading (or generating) the graph and placing it
+    PERF_LOAD,
+    // copying the graph onto the device
+    PERF_UPLOAD,
+    // sycl_main or host_main
+    PERF_COMPUTE,
+    // writing the result
+    PERF_OUTPUT,
+    NUM_PERF_PHASES
+};
+
+/**
+ * Counts of each event and the wall-clock time in each phase, summed
+ * over the runs of the phase since the last reset
+ */
+class PerfCounters {
+    public:
+        PerfCounters();
+        ~PerfCounters();
+
+        /**
+         * Open the counters. Should be called before any threads whose
+         * events should be counted are started.
+         *
+         * @return false if no counter could be opened (phases are then
+         *         still timed)
+         */
+        bool open();
+
+        /** Start counting *phase*. Does nothing unless open() was called. */
+        void start(PerfPhase phase);
+        /** Stop counting *phase* and add to its totals */
+        void stop(PerfPhase phase);
+
+        /** Forget the totals of *phase* */
+        void reset(PerfPhase phase);
+        /** Forget the totals of every phase */
+        void reset();
+
+        /**
+         * Print a table of each phase per run, with IPC and a
+         * memory bandwidth estimate (a cache line per LLC miss)
+         */
+        void report(FILE *f) const;
+
+        /**
+         * Print a line of totals for each phase which ran, for
+         * bench/bench-suite to parse:
+         *
+         *   PERF phase=<name> runs=<n> time_ms=<t> cycles=<n> instructions=<n>
+         *        llc_misses=<n> dtlb_misses=<n>
+         *
+         * Unavailable events are left out.
+         */
+        void print_lines(FILE *f) const;
+
+    private:
+        struct PhaseTotals {
+            double counts[NUM_PERF_EVENTS];
+            double seconds;
+            unsigned runs;
+        };
+
+        bool enabled = false;
+        // -1 for events which could not be opened
+        int fds[NUM_PERF_EVENTS];
+        PhaseTotals totals[NUM_PERF_PHASES];
+        // counts and time when the running phase started
+        double start_counts[NUM_PERF_EVENTS];
+        std::chrono::steady_clock::time_point start_time;
+
+        /** @return the count of *event* so far, scaled up if it was multiplexed */
+        double read_count(PerfEvent event) const;
+
+        /** Print a row of report() */
+        void report_row(FILE *f, const char *name, unsigned runs, const PhaseTotals &per_run) const;
+};
+
+#endif
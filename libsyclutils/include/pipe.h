@@ -1,4 +1,5 @@
 /*  -*- mode: c++ -*- */
+#include <vector>
 #include <CL/sycl.hpp>
 
 // WARP_SIZE THREAD_BLOCK_SIZE
@@ -23,6 +24,14 @@ class ResetOutWorklistOffsets;
 class ClaimOwnership;
 class DeDupe;
 
+/**
+ * The events of the kernels Pipe::compress submits, so that callers
+ * can profile the de-duping and compression phases separately
+ */
+struct PipeEvents {
+    std::vector<sycl::event> dedupe, compress;
+};
+
 /**
  * Manages an in-worklist and an out-worklist of nodes.
  *
@@ -56,7 +65,7 @@ class Pipe {
         /**
          * Used by compress to dedupe.
          */
-        void dedupe(sycl::queue &queue);
+        void dedupe(sycl::queue &queue, PipeEvents *events);
     public:
         Pipe(gpu_size_t worklist_capacity,
              gpu_size_t nnodes,
@@ -78,6 +87,25 @@ class Pipe {
             , owner_buf{ sycl::range<1>{NNODES} }
             { }
 
+        /**
+         * The number of bytes of device global memory a Pipe
+         * constructed with the same arguments will allocate.
+         *
+         * Useful for planning device memory before constructing a Pipe.
+         */
+        static size_t device_footprint(gpu_size_t worklist_capacity,
+                                       gpu_size_t nnodes,
+                                       gpu_size_t num_work_groups)
+        {
+            // same rounding as the constructor
+            size_t capacity = worklist_capacity + num_work_groups
+                              + (num_work_groups - (worklist_capacity) % num_work_groups)
+                                % num_work_groups;
+            return 2 * capacity * sizeof(index_type)                  // worklist1/2
+                   + (1 + 2 * num_work_groups) * sizeof(gpu_size_t)   // sizes and offsets
+                   + nnodes * sizeof(size_t);                         // owner
+        }
+
         /**
          * useful constant getters
          */ 
@@ -168,15 +196,21 @@ class Pipe {
     /**
      * Compress the out-worklist into a contiguous array
      *
-     * De-dupes any entry (in the non-contiguous portion)
-     * which appears more than once
+     * If *dedupe* is true, de-dupes any entry (in the non-contiguous
+     * portion) which appears more than once. Operators which make sure
+     * each node is pushed at most once can skip the de-duping kernels.
+     *
+     * If *events* is not null, the events of the submitted kernels
+     * are appended to it.
      */ 
-    void compress(sycl::queue &queue) {
+    void compress(sycl::queue &queue, bool dedupe = true, PipeEvents *events = nullptr) {
         /// First, de-dupe
-        this->dedupe(queue);
+        if(dedupe) {
+            this->dedupe(queue, events);
+        }
         /// Next, submit a job to copy memory from each group's portion of 
         // the out-worklist into the contiguous portion of the out-worklist
-        queue.submit([&] (sycl::handler &cgh) {
+        sycl::event compress_event = queue.submit([&] (sycl::handler &cgh) {
             // copy constants
             const gpu_size_t NUM_WORK_GROUPS = this->NUM_WORK_GROUPS;
             const gpu_size_t WORKLIST_CAPACITY = this->WORKLIST_CAPACITY;
@@ -259,7 +293,7 @@ class Pipe {
                 }
         }); });
         /// Next, submit a job to reset the out-worklist sizes and offsets
-        queue.submit([&] (sycl::handler &cgh) {
+        sycl::event reset_event = queue.submit([&] (sycl::handler &cgh) {
             // copy constants
             const gpu_size_t NUM_WORK_GROUPS = this->NUM_WORK_GROUPS;
             const gpu_size_t WORKLIST_CAPACITY = this->WORKLIST_CAPACITY;
@@ -287,13 +321,17 @@ class Pipe {
                 }
             });
         });
+        if(events) {
+            events->compress.push_back(compress_event);
+            events->compress.push_back(reset_event);
+        }
     }
 };
 
-void Pipe::dedupe(sycl::queue &queue) {
+void Pipe::dedupe(sycl::queue &queue, PipeEvents *events) {
     /// First, have each node compete for ownership. Whoever owns
     // a node on the worklist has the one that is "not a duplicate"
-    queue.submit([&](sycl::handler &cgh) {
+    sycl::event claim_event = queue.submit([&](sycl::handler &cgh) {
         // global accessors
         auto owner = this->owner_buf.get_access<sycl::access::mode::write>(cgh);
         auto out_worklist = this->out_worklist_buf->get_access<sycl::access::mode::read>(cgh);
@@ -329,7 +367,7 @@ void Pipe::dedupe(sycl::queue &queue) {
         });
     });
     /// Next, de-dupe
-    queue.submit([&](sycl::handler &cgh) {
+    sycl::event dedupe_event = queue.submit([&](sycl::handler &cgh) {
         // global accessors
         auto owner = this->owner_buf.get_access<sycl::access::mode::read_write>(cgh);
         auto out_worklist = this->out_worklist_buf->get_access<sycl::access::mode::read_write>(cgh);
@@ -406,6 +444,10 @@ void Pipe::dedupe(sycl::queue &queue) {
             }
         });
     });
+    if(events) {
+        events->dedupe.push_back(claim_event);
+        events->dedupe.push_back(dedupe_event);
+    }
 }
 
 #endif
@@ -0,0 +1,115 @@
+#include <CL/sycl.hpp>
+//
+// THREAD_BLOCK_SIZE
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph index_type
+#include "sycl_csr_graph.h"
+// gpu_size_t
+#include "pipe.h"
+
+#ifndef BREADTHNPAGEINSYCL_LIBSYCLUTILS_PULLSCHEDULER_
+#define BREADTHNPAGEINSYCL_LIBSYCLUTILS_PULLSCHEDULER_
+
+// "derive" from this class using the
+// curiously recurring template pattern, just like the PushScheduler.
+//
+// The PullScheduler runs over the transpose of a graph
+// (see Host_CSR_Graph::buildTranspose), so that the out-edges it reads
+// are the in-edges of the original graph.
+// Each work-item pulls into one node at a time, and hands the
+// node's whole in-edge range to the PullOperator's
+// applyPullOperator, which is free to stop early
+// (e.g. once a bottom-up BFS finds a parent).
+//
+// Since a node is only ever written by the work-item pulling into it,
+// pull operators need no atomics and no barriers.
+//
+// The OperatorInfo class can be used by the PullOperator as a way of carrying
+// extra data. The PullScheduler will use the copy constructor to
+// make its own copy.
+// The PullScheduler calls OperatorInfo's initialize(nd_item<1>) method at
+// the beginning of scheduling.
+//
+// A PullOperator may hide isActive(index_type) to have the scheduler
+// skip some nodes without reading their in-edges
+// (e.g. nodes which a bottom-up BFS has already visited).
+//
+template <class PullOperator, class OperatorInfo>
+class PullScheduler {
+    protected:
+    const gpu_size_t NNODES,
+                     NEDGES,
+                     NUM_WORK_GROUPS,
+                     WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                     NUM_WORK_ITEMS = WORK_GROUP_SIZE * NUM_WORK_GROUPS;
+    // global SYCL memory:
+    sycl::accessor<index_type, 1,
+                   sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+                       // read-access to the transposed CSR graph
+                       in_row_start,
+                       in_edge_src;
+    // Operator-specific information
+    OperatorInfo opInfo;
+
+    public:
+        PullScheduler(gpu_size_t num_work_groups,
+                      SYCL_CSR_Graph &sycl_transpose, sycl::handler &cgh,
+                      OperatorInfo &operatorInfo)
+            // This cast is okay because sycl_driver does a check
+            : NNODES{ (gpu_size_t) sycl_transpose.nnodes }
+            , NEDGES{ (gpu_size_t) sycl_transpose.nedges }
+            , NUM_WORK_GROUPS{ num_work_groups }
+            // transposed CSR Graph in memory
+            , in_row_start{ sycl_transpose.row_start, cgh }
+            , in_edge_src { sycl_transpose.edge_dst , cgh }
+            // operator-specific information
+            , opInfo{ operatorInfo }
+        { }
+
+    // SYCL Kernel
+    void operator()(sycl::nd_item<1>);
+
+    /**
+     * Apply the pull operator to the in-edges of a node
+     *
+     * my_item: my sycl work-item
+     * dst_node: the node being pulled into
+     * first_in_edge: the index of dst_node's first in-edge
+     * last_in_edge: one past the index of dst_node's last in-edge
+     */
+    void applyPullOperator(const sycl::nd_item<1> &my_item,
+                           index_type dst_node,
+                           index_type first_in_edge,
+                           index_type last_in_edge)
+    {
+        static_cast<PullOperator&>(*this).applyPullOperator(my_item,
+                                                            dst_node,
+                                                            first_in_edge,
+                                                            last_in_edge);
+    };
+
+    /**
+     * Should *node* pull from its in-edges?
+     *
+     * Every node is active unless the PullOperator hides this method.
+     */
+    bool isActive(index_type node) const {
+        return true;
+    }
+};
+
+/// SYCL Kernel //////////////////////////////////////////////////////////////
+template <class PullOperator, class OperatorInfo>
+void PullScheduler<PullOperator, OperatorInfo>::operator()(sycl::nd_item<1> my_item) {
+    // Initialize operator info
+    opInfo.initialize(my_item);
+    for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+        if(static_cast<PullOperator&>(*this).isActive(node)) {
+            applyPullOperator(my_item, node, in_row_start[node], in_row_start[node+1]);
+        }
+    }
+}
+///////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -16,6 +16,93 @@ extern const uint64_t INF = std::numeric_limits<uint64_t>::max();
 #ifndef BREADTHNPAGEINSYCL_LIBSYCLUTILS_PUSHSCHEDULER_
 #define BREADTHNPAGEINSYCL_LIBSYCLUTILS_PUSHSCHEDULER_
 
+/// Scheduler Counters ////////////////////////////////////////////////////////
+// (see scheduler_counters.h)
+#ifdef SCHEDULER_COUNTERS
+/**
+ * An item's own counts, kept in private memory
+ */
+struct SchedulerTally {
+    gpu_size_t counts[NUM_SCHEDULER_COUNTERS] = {};
+
+    void add(SchedulerCounter counter, gpu_size_t n = 1) {
+        counts[counter] += n;
+    }
+};
+
+/**
+ * Sums the items' tallies in local memory, and then adds each group's
+ * sums into the graph's scheduler counters
+ */
+class SchedulerCounters {
+    private:
+        sycl::accessor<uint32_t, 1,
+                       sycl::access::mode::atomic,
+                       sycl::access::target::global_buffer>
+                           words;
+        sycl::accessor<gpu_size_t, 1,
+                       sycl::access::mode::atomic,
+                       sycl::access::target::local>
+                           group_counts;
+    public:
+        SchedulerCounters(SYCL_CSR_Graph &sycl_graph, sycl::handler &cgh)
+            : words{ sycl_graph.scheduler_counters, cgh }
+            , group_counts{ sycl::range<1>{NUM_SCHEDULER_COUNTERS}, cgh }
+        { }
+
+        /**
+         * Zero the group's sums. Local memory must be synchronized
+         * before publish().
+         */
+        void initialize(const sycl::nd_item<1> &my_item) const {
+            if(my_item.get_local_id()[0] == 0) {
+                for(int c = 0; c < NUM_SCHEDULER_COUNTERS; ++c) {
+                    group_counts[c].store(0);
+                }
+            }
+        }
+
+        /**
+         * Add *tally* into the group's sums, and the sums into the
+         * counters. Every item in the group must call this.
+         */
+        void publish(const sycl::nd_item<1> &my_item, const SchedulerTally &tally) const {
+            for(int c = 0; c < NUM_SCHEDULER_COUNTERS; ++c) {
+                if(tally.counts[c] > 0) {
+                    group_counts[c].fetch_add(tally.counts[c]);
+                }
+            }
+            my_item.barrier(sycl::access::fence_space::local_space);
+            if(my_item.get_local_id()[0] == 0) {
+                for(int c = 0; c < NUM_SCHEDULER_COUNTERS; ++c) {
+                    uint32_t count = group_counts[c].load();
+                    if(count == 0) {
+                        continue;
+                    }
+                    // carry into the high word if the low word wrapped
+                    uint32_t low = words[2 * c].fetch_add(count);
+                    if((uint32_t) (low + count) < low) {
+                        words[2 * c + 1].fetch_add(1);
+                    }
+                }
+            }
+        }
+};
+#else
+// Without SCHEDULER_COUNTERS, counting does nothing
+struct SchedulerTally {
+    void add(SchedulerCounter, gpu_size_t = 1) { }
+};
+
+class SchedulerCounters {
+    public:
+        SchedulerCounters(SYCL_CSR_Graph &, sycl::handler &) { }
+        void initialize(const sycl::nd_item<1> &) const { }
+        void publish(const sycl::nd_item<1> &, const SchedulerTally &) const { }
+};
+#endif
+///////////////////////////////////////////////////////////////////////////////
+
 // "derive" from this class using the
 // curiously recurring template pattern as described in
 // https://developer.codeplay.com/products/computecpp/ce/guides/sycl-guide/limitations
@@ -26,6 +113,14 @@ extern const uint64_t INF = std::numeric_limits<uint64_t>::max();
 // The PushScheduler calls OperatorInfo's initialize(nd_item<1>) method at
 // the beginning of scheduling.
 //
+// A PushOperator may hide isActive(index_type) to have the scheduler
+// skip some nodes on the in-worklist without reading their edges
+// (e.g. nodes which are not in a bitmap frontier).
+//
+// A PushOperator may also hide finalize(nd_item<1>), which every item
+// calls once the whole group is done scheduling (e.g. to publish
+// group-local counters).
+//
 template <class PushOperator, class OperatorInfo>
 class PushScheduler {
     protected:
@@ -85,6 +180,9 @@ class PushScheduler {
                    sycl::access::target::local>
                        // fine-grained scheduling queue size
                        num_fine_grained_edges;
+    // edges per scheduling method, bidding rounds and idle calls
+    // (only counted with SCHEDULER_COUNTERS)
+    SchedulerCounters scheduler_counters;
     // Operator-specific information
     OperatorInfo opInfo;
 
@@ -103,9 +201,11 @@ class PushScheduler {
      * my_item: sycl object representing my item
      * my_work_left: the amount of work my item still wants done.
      *               May be modified.
+     * tally: my scheduler counts
      */
     void group_scheduling(const sycl::nd_item<1> &my_item,
-                          index_type &my_work_left);
+                          index_type &my_work_left,
+                          SchedulerTally &tally);
 
     /**
      * Run warp-scheduling using a push operator
@@ -122,9 +222,11 @@ class PushScheduler {
      * my_item: sycl object representing my item
      * my_work_left: the amount of work my item still wants done.
      *               May be modified.
+     * tally: my scheduler counts
      */
     void warp_scheduling(const sycl::nd_item<1> &my_item,
-                         index_type &my_work_left);
+                         index_type &my_work_left,
+                         SchedulerTally &tally);
 
     /**
      * Run fine-grained-scheduling on a push operator
@@ -144,11 +246,13 @@ class PushScheduler {
      * my_src_node: the source node of my edges
      * my_first_edge: the edge index of the first out-edge from the node
      *                I want worked on, if any
+     * tally: my scheduler counts
      */
     void fine_grained_scheduling(const sycl::nd_item<1> &my_item,
                                  index_type &my_work_left,
                                  index_type my_src_node,
-                                 index_type my_first_edge);
+                                 index_type my_first_edge,
+                                 SchedulerTally &tally);
 
     public:
         PushScheduler(gpu_size_t num_work_groups,
@@ -178,6 +282,7 @@ class PushScheduler {
             , warp_still_has_work{ sycl::range<1>{1}, cgh }
             , out_worklist_full  { sycl::range<1>{1}, cgh }
             , num_fine_grained_edges{ sycl::range<1>{1}, cgh }
+            , scheduler_counters{ sycl_graph, cgh }
             // operator-specific information
             , opInfo{ operatorInfo }
         { }
@@ -204,12 +309,32 @@ class PushScheduler {
                                                             src_node,
                                                             current_edge);
     };
+
+    /**
+     * Should the out-edges of *node* be scheduled?
+     *
+     * Every node on the in-worklist is active unless the
+     * PushOperator hides this method.
+     *
+     * node: a node popped off of the in-worklist
+     */
+    bool isActive(index_type node) const {
+        return true;
+    }
+
+    /**
+     * Called by every item of a group once the group has applied the
+     * push operator to all of its edges. Does nothing unless the
+     * PushOperator hides this method.
+     */
+    void finalize(const sycl::nd_item<1> &my_item) { }
 };
 
 /// Group Scheduling //////////////////////////////////////////////////////////
 template <class PushOperator, class OperatorInfo>
 void PushScheduler<PushOperator, OperatorInfo>::group_scheduling(const sycl::nd_item<1> &my_item,
-                                                                 index_type &my_work_left)
+                                                                 index_type &my_work_left,
+                                                                 SchedulerTally &tally)
 {
     my_item.barrier(sycl::access::fence_space::local_space);
     // Initialize work_node to its invalid value
@@ -230,6 +355,9 @@ void PushScheduler<PushOperator, OperatorInfo>::group_scheduling(const sycl::nd_
         if(group_work_node[0] == WORK_GROUP_SIZE) {
             break;
         }
+        if(my_item.get_local_id()[0] == 0) {
+            tally.add(SCHED_GROUP_ROUNDS);
+        }
         // Otherwise, copy the work node into private memory
         // and clear the group-work-node for next time
         index_type work_node = group_work_node[0];
@@ -252,6 +380,7 @@ void PushScheduler<PushOperator, OperatorInfo>::group_scheduling(const sycl::nd_
             if(current_edge >= last_edge) {
                 current_edge = NEDGES;
             }
+            tally.add(current_edge < NEDGES ? SCHED_GROUP_EDGES : SCHED_IDLE_CALLS);
             applyPushOperator(my_item, src_node, current_edge);
             if(current_edge < last_edge) {
                 current_edge += WORK_GROUP_SIZE;
@@ -266,7 +395,8 @@ void PushScheduler<PushOperator, OperatorInfo>::group_scheduling(const sycl::nd_
 /// Warp Scheduling ///////////////////////////////////////////////////////////
 template <class PushOperator, class OperatorInfo>
 void PushScheduler<PushOperator, OperatorInfo>::warp_scheduling(const sycl::nd_item<1> &my_item,
-                                                                index_type &my_work_left)
+                                                                index_type &my_work_left,
+                                                                SchedulerTally &tally)
 {
     my_item.barrier(sycl::access::fence_space::local_space);
     // set up for warp scheduling
@@ -292,6 +422,9 @@ void PushScheduler<PushOperator, OperatorInfo>::warp_scheduling(const sycl::nd_i
         if(!warp_still_has_work[0]) {
             break;
         }
+        if(my_item.get_local_id()[0] == 0) {
+            tally.add(SCHED_WARP_ROUNDS);
+        }
         // We want every worker in the group to enters the function call
         // or no worker in the group enters the function call, so we need
         // to know how many times to enter the loop
@@ -337,6 +470,7 @@ void PushScheduler<PushOperator, OperatorInfo>::warp_scheduling(const sycl::nd_i
             if(current_edge >= last_edge) {
                 current_edge = NEDGES;
             }
+            tally.add(current_edge < NEDGES ? SCHED_WARP_EDGES : SCHED_IDLE_CALLS);
             applyPushOperator(my_item, src_node, current_edge);
             if(current_edge < last_edge) {
                 current_edge += WARP_SIZE;
@@ -353,7 +487,8 @@ template <class PushOperator, class OperatorInfo>
 void PushScheduler<PushOperator, OperatorInfo>::fine_grained_scheduling(const sycl::nd_item<1> &my_item,
                                                                         index_type &my_work_left,
                                                                         index_type my_src_node,
-                                                                        index_type my_first_edge)
+                                                                        index_type my_first_edge,
+                                                                        SchedulerTally &tally)
 {
     /// Setup /////////////////////////////////////////////////////////////////
     my_item.barrier(sycl::access::fence_space::global_and_local);
@@ -377,6 +512,9 @@ void PushScheduler<PushOperator, OperatorInfo>::fine_grained_scheduling(const sy
     /// Work on fine-grained edges ////////////////////////////////////////////
     gpu_size_t total_work = num_fine_grained_edges[0].load();
     for(gpu_size_t i = 0; i < total_work; i += FINE_GRAINED_EDGE_CAPACITY) {
+        if(my_item.get_local_id()[0] == 0) {
+            tally.add(SCHED_FINE_GRAINED_ROUNDS);
+        }
         // If I have work to do and
         // my edges fit on the fine-grained edges array,
         // put my edges on the array!
@@ -395,6 +533,7 @@ void PushScheduler<PushOperator, OperatorInfo>::fine_grained_scheduling(const sy
             index_type edge_index = fine_grained_edges[j],
                         src_node = fine_grained_src_nodes[j];
             fine_grained_edges[j] = NEDGES;
+            tally.add(edge_index < NEDGES ? SCHED_FINE_GRAINED_EDGES : SCHED_IDLE_CALLS);
             // apply!
             applyPushOperator(my_item, src_node, edge_index);
         }
@@ -423,6 +562,8 @@ void PushScheduler<PushOperator, OperatorInfo>::operator()(sycl::nd_item<1> my_i
     }
     // Initialize operator info
     opInfo.initialize(my_item);
+    scheduler_counters.initialize(my_item);
+    SchedulerTally tally;
     my_item.barrier();
     // now iterate through the worklist (making sure that if anyone
     //                                   in my group has work, then
@@ -434,9 +575,11 @@ void PushScheduler<PushOperator, OperatorInfo>::operator()(sycl::nd_item<1> my_i
     {
         // figure out what work I need to do (if any)
         index_type my_work_left, my_src_node, my_first_edge, my_last_edge;
-        if(wl_index < in_wl.getSize()) {
-            // get my src node, first edge, and last edge in private memory
-            in_wl.pop(wl_index, my_src_node);
+        if(wl_index < in_wl.getSize()
+           && in_wl.pop(wl_index, my_src_node)
+           && static_cast<PushOperator&>(*this).isActive(my_src_node))
+        {
+            // get my first edge and last edge in private memory
             my_first_edge = row_start[my_src_node],
             my_last_edge = row_start[my_src_node+1];
             // put first/last edge and src node into local memory
@@ -454,13 +597,15 @@ void PushScheduler<PushOperator, OperatorInfo>::operator()(sycl::nd_item<1> my_i
         }
         wl_index += NUM_WORK_ITEMS;
         // Work on nodes as a group
-        group_scheduling(my_item, my_work_left);
-        warp_scheduling(my_item, my_work_left);
-        fine_grained_scheduling(my_item, my_work_left, my_src_node, my_first_edge);
+        group_scheduling(my_item, my_work_left, tally);
+        warp_scheduling(my_item, my_work_left, tally);
+        fine_grained_scheduling(my_item, my_work_left, my_src_node, my_first_edge, tally);
         // break if out-worklist is full
         if(out_worklist_full[0]) { break; }
     }
     my_item.barrier();
+    static_cast<PushOperator&>(*this).finalize(my_item);
+    scheduler_counters.publish(my_item, tally);
     if(my_local_id[0] == 0) {
         out_wl.publishLocalMemory(my_item);
         if(out_worklist_full[0]) {
@@ -0,0 +1,44 @@
+/**
+ * scheduler_counters.h
+ *
+ * Counters of how PushScheduler spreads edges over its scheduling
+ * methods. They are only compiled in when SCHEDULER_COUNTERS is defined
+ * (cmake -DSCHEDULER_COUNTERS=ON); otherwise the scheduler's counting
+ * compiles away.
+ *
+ * The device side is in push_scheduler.h, and the counts live in a
+ * buffer of the SYCL_CSR_Graph, which the driver reads after each run.
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_SCHEDULER_COUNTERS_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_SCHEDULER_COUNTERS_
+
+#include <cstddef>
+#include <cstdint>
+
+enum SchedulerCounter {
+    // edges pushed along by group, warp and fine-grained scheduling
+    SCHED_GROUP_EDGES,
+    SCHED_WARP_EDGES,
+    SCHED_FINE_GRAINED_EDGES,
+    // bidding rounds of group and warp scheduling which found work,
+    // and batches of fine-grained edges
+    SCHED_GROUP_ROUNDS,
+    SCHED_WARP_ROUNDS,
+    SCHED_FINE_GRAINED_ROUNDS,
+    // applyPushOperator calls with an invalid edge (edge_index >= NEDGES),
+    // made by items with nothing to do so that the group stays together
+    SCHED_IDLE_CALLS,
+    NUM_SCHEDULER_COUNTERS
+};
+
+// Devices without 64-bit atomics keep each count as a pair of 32-bit
+// words (low, high), the high word taking the carries of the low one
+const size_t SCHEDULER_COUNTER_WORDS = 2 * NUM_SCHEDULER_COUNTERS;
+
+/**
+ * Print the counts in *words* (SCHEDULER_COUNTER_WORDS of them) to stderr,
+ * with the share of edges each scheduling method handled
+ */
+void report_scheduler_counters(const uint32_t *words);
+
+#endif
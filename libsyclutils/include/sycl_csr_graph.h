@@ -13,6 +13,8 @@
 //
 // HOST_CSR_Graph index_type node_data_type
 #include "host_csr_graph.h"
+// SCHEDULER_COUNTER_WORDS
+#include "scheduler_counters.h"
 
 /**
  * A CSR graph with node data represented
@@ -23,15 +25,43 @@ struct SYCL_CSR_Graph {
     // All are 1-D buffers
     cl::sycl::buffer<index_type, 1> row_start, edge_dst;
     cl::sycl::buffer<node_data_type, 1> node_data;
+#ifdef SCHEDULER_COUNTERS
+    // counts of every PushScheduler run on this graph
+    cl::sycl::buffer<uint32_t, 1> scheduler_counters;
+#endif
 
     /** Construct SYCL_CSR_Graph from a CSR_Graph */
     SYCL_CSR_Graph( Host_CSR_Graph *graph )
         : nnodes   {graph->nnodes}
         , nedges   {graph->nedges}
-        , row_start{graph->row_start, cl::sycl::range<1>{graph->nnodes+1}}
-        , edge_dst {graph->edge_dst,  cl::sycl::range<1>{graph->nedges}}
-        , node_data{graph->node_data, cl::sycl::range<1>{graph->nnodes}}
+        , row_start{graph->row_start.get(), cl::sycl::range<1>{graph->nnodes+1}}
+        , edge_dst {graph->edge_dst.get(),  cl::sycl::range<1>{graph->nedges}}
+        , node_data{node_data_buffer(graph)}
+#ifdef SCHEDULER_COUNTERS
+        // (copies the zeros, and is not written back)
+        , scheduler_counters{(const uint32_t *) ZERO_SCHEDULER_COUNTS,
+                             cl::sycl::range<1>{SCHEDULER_COUNTER_WORDS}}
+#endif
         { }
+
+    private:
+        /**
+         * A graph without node data (a transpose, see
+         * Host_CSR_Graph::buildTranspose) gets a one-element placeholder,
+         * which is never copied to the device
+         */
+        static cl::sycl::buffer<node_data_type, 1> node_data_buffer(Host_CSR_Graph *graph) {
+            if(!graph->node_data.get()) {
+                return cl::sycl::buffer<node_data_type, 1>{cl::sycl::range<1>{1}};
+            }
+            return cl::sycl::buffer<node_data_type, 1>{graph->node_data.get(),
+                                                       cl::sycl::range<1>{graph->nnodes}};
+        }
+
+#ifdef SCHEDULER_COUNTERS
+    private:
+        static constexpr uint32_t ZERO_SCHEDULER_COUNTS[SCHEDULER_COUNTER_WORDS] = {};
+#endif
 };
 
 #endif
@@ -0,0 +1,38 @@
+/**
+ * sycl_sell_graph.h
+ *
+ * Just a container for SYCL buffers for the arrays of
+ * a SELL-C-sigma graph
+ */
+#ifndef BREADTHNPAGEINSYCL_SYCLUTILS_SYCL_SELL_GRAPH_
+#define BREADTHNPAGEINSYCL_SYCLUTILS_SYCL_SELL_GRAPH_
+
+#include <algorithm>
+#include <CL/sycl.hpp>
+
+// Host_SELL_Graph index_type
+#include "host_sell_graph.h"
+
+/**
+ * A SELL-C-sigma graph represented
+ * as SYCL buffers
+ */
+struct SYCL_SELL_Graph {
+    index_type nnodes, slice_height, nslices, nentries;
+    // All are 1-D buffers
+    cl::sycl::buffer<index_type, 1> slice_start, row_node, neighbors;
+
+    /** Construct SYCL_SELL_Graph from a Host_SELL_Graph */
+    SYCL_SELL_Graph( Host_SELL_Graph *graph )
+        : nnodes      {graph->nnodes}
+        , slice_height{graph->slice_height}
+        , nslices     {graph->nslices}
+        , nentries    {graph->nentries}
+        , slice_start {graph->slice_start.get(), cl::sycl::range<1>{graph->nslices+1}}
+        , row_node    {graph->row_node.get(),    cl::sycl::range<1>{graph->nslices * graph->slice_height}}
+        // SYCL buffers can't be empty
+        , neighbors   {graph->neighbors.get(),   cl::sycl::range<1>{std::max(graph->nentries, (index_type) 1)}}
+        { }
+};
+
+#endif
@@ -0,0 +1,232 @@
+/*  -*- mode: c++ -*- */
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include <CL/sycl.hpp>
+
+// THREAD_BLOCK_SIZE
+#include "kernel_sizing.h"
+// index_type
+#include "sycl_csr_graph.h"
+// float_to_bits gpu_size_t
+#include "float_atomics.h"
+
+#ifndef BREADTHNPAGEINSYCL_LIBSYCLUTILS_TOPK_
+#define BREADTHNPAGEINSYCL_LIBSYCLUTILS_TOPK_
+
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class TopKHistogram;
+class TopKCollect;
+class DeviceSumPartials;
+class DeviceSumFinal;
+
+// radix select looks at this many bits of the keys per pass
+#define TOP_K_RADIX_BITS 8
+#define TOP_K_RADIX (1 << TOP_K_RADIX_BITS)
+
+/**
+ * @return a key whose unsigned order is the order of *value*
+ *         (for non-NaN floats)
+ */
+inline uint32_t float_order_key(float value) {
+    uint32_t bits = float_to_bits(value);
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+/**
+ * Sum the first *n* values on the device
+ *
+ * Each work-group reduces its share in local memory, and a single task
+ * adds up the per-group sums, so only the sum is copied back.
+ */
+inline float device_sum(sycl::queue &queue, sycl::buffer<float, 1> &values_buf,
+                        size_t n, size_t num_work_groups)
+{
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    sycl::buffer<float, 1> partial_sums_buf(sycl::range<1>{NUM_WORK_GROUPS}),
+                           sum_buf(sycl::range<1>{1});
+    queue.submit([&] (sycl::handler &cgh) {
+        auto values = values_buf.get_access<sycl::access::mode::read>(cgh);
+        auto partial_sums = partial_sums_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        sycl::accessor<float, 1,
+                       sycl::access::mode::read_write,
+                       sycl::access::target::local>
+                           group_sums{sycl::range<1>{WORK_GROUP_SIZE}, cgh};
+        cgh.parallel_for<class DeviceSumPartials>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                    sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            const size_t local_id = my_item.get_local_id()[0];
+            float my_sum = 0;
+            for(size_t i = my_item.get_global_id()[0]; i < n; i += NUM_WORK_ITEMS) {
+                my_sum += values[i];
+            }
+            group_sums[local_id] = my_sum;
+            for(size_t stride = WORK_GROUP_SIZE / 2; stride > 0; stride /= 2) {
+                my_item.barrier(sycl::access::fence_space::local_space);
+                if(local_id < stride) {
+                    group_sums[local_id] += group_sums[local_id + stride];
+                }
+            }
+            if(local_id == 0) {
+                partial_sums[my_item.get_group(0)] = group_sums[0];
+            }
+    }); });
+    queue.submit([&] (sycl::handler &cgh) {
+        auto partial_sums = partial_sums_buf.get_access<sycl::access::mode::read>(cgh);
+        auto sum = sum_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        cgh.single_task<class DeviceSumFinal>([=]() {
+            float total = 0;
+            for(size_t wg = 0; wg < NUM_WORK_GROUPS; ++wg) {
+                total += partial_sums[wg];
+            }
+            sum[0] = total;
+    }); });
+    auto sum = sum_buf.get_access<sycl::access::mode::read>();
+    return sum[0];
+}
+
+/**
+ * Find the *k* largest of the first *n* values on the device,
+ * and copy only them (and their indices) back.
+ *
+ * Uses a most-significant-digit radix select on float_order_key:
+ * each pass histograms the next TOP_K_RADIX_BITS bits of the keys which
+ * still match the known prefix of the k-th largest key, and the host
+ * picks the digit of the k-th largest key from the histogram.
+ * Then one kernel collects every value above the k-th largest key, and
+ * as many ties with it as are needed.
+ *
+ * @param top_indices set to the indices of the top values, largest first
+ * @param top_values set to the top values, largest first
+ */
+inline void top_k(sycl::queue &queue, sycl::buffer<float, 1> &values_buf,
+                  size_t n, size_t k, size_t num_work_groups,
+                  std::vector<index_type> &top_indices, std::vector<float> &top_values)
+{
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    k = std::min(k, n);
+    top_indices.clear();
+    top_values.clear();
+    if(k == 0) {
+        return;
+    }
+    // Find the k-th largest key one digit at a time.
+    // Invariant: the k-th largest key starts with *prefix*, and it is the
+    //            *rank*-th largest of the keys starting with *prefix*
+    uint32_t prefix = 0, prefix_mask = 0;
+    size_t rank = k;
+    sycl::buffer<gpu_size_t, 1> histogram_buf(sycl::range<1>{TOP_K_RADIX});
+    for(int shift = 32 - TOP_K_RADIX_BITS; shift >= 0; shift -= TOP_K_RADIX_BITS) {
+        {
+            auto histogram = histogram_buf.get_access<sycl::access::mode::discard_write>();
+            for(size_t digit = 0; digit < TOP_K_RADIX; ++digit) {
+                histogram[digit] = 0;
+            }
+        }
+        queue.submit([&] (sycl::handler &cgh) {
+            auto values = values_buf.get_access<sycl::access::mode::read>(cgh);
+            auto histogram = histogram_buf.get_access<sycl::access::mode::atomic>(cgh);
+            sycl::accessor<gpu_size_t, 1,
+                           sycl::access::mode::atomic,
+                           sycl::access::target::local>
+                               group_histogram{sycl::range<1>{TOP_K_RADIX}, cgh};
+            const uint32_t PREFIX = prefix, PREFIX_MASK = prefix_mask;
+            const int SHIFT = shift;
+            cgh.parallel_for<class TopKHistogram>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                    sycl::range<1>{WORK_GROUP_SIZE}},
+            [=](sycl::nd_item<1> my_item) {
+                const size_t local_id = my_item.get_local_id()[0];
+                for(size_t digit = local_id; digit < TOP_K_RADIX; digit += WORK_GROUP_SIZE) {
+                    group_histogram[digit].store(0);
+                }
+                my_item.barrier(sycl::access::fence_space::local_space);
+                for(size_t i = my_item.get_global_id()[0]; i < n; i += NUM_WORK_ITEMS) {
+                    uint32_t key = float_order_key(values[i]);
+                    if((key & PREFIX_MASK) == PREFIX) {
+                        group_histogram[(key >> SHIFT) & (TOP_K_RADIX - 1)].fetch_add(1);
+                    }
+                }
+                my_item.barrier(sycl::access::fence_space::local_space);
+                for(size_t digit = local_id; digit < TOP_K_RADIX; digit += WORK_GROUP_SIZE) {
+                    gpu_size_t count = group_histogram[digit].load();
+                    if(count > 0) {
+                        histogram[digit].fetch_add(count);
+                    }
+                }
+        }); });
+        // pick the digit holding the rank-th largest key
+        auto histogram = histogram_buf.get_access<sycl::access::mode::read>();
+        size_t digit = TOP_K_RADIX - 1;
+        while(histogram[digit] < rank) {
+            rank -= histogram[digit];
+            digit--;
+        }
+        prefix |= (uint32_t) digit << shift;
+        prefix_mask |= (uint32_t) (TOP_K_RADIX - 1) << shift;
+    }
+
+    // prefix is now the k-th largest key. Collect everything above it,
+    // and *rank* of the keys equal to it
+    const gpu_size_t NUM_ABOVE = k - rank,
+                     NUM_TIES = rank;
+    const uint32_t KTH_KEY = prefix;
+    sycl::buffer<index_type, 1> top_indices_buf(sycl::range<1>{k});
+    sycl::buffer<float, 1> top_values_buf(sycl::range<1>{k});
+    sycl::buffer<gpu_size_t, 1> counts_buf(sycl::range<1>{2});
+    {
+        auto counts = counts_buf.get_access<sycl::access::mode::discard_write>();
+        counts[0] = 0;
+        counts[1] = 0;
+    }
+    queue.submit([&] (sycl::handler &cgh) {
+        auto values = values_buf.get_access<sycl::access::mode::read>(cgh);
+        auto indices_out = top_indices_buf.get_access<sycl::access::mode::write>(cgh);
+        auto values_out = top_values_buf.get_access<sycl::access::mode::write>(cgh);
+        // number of keys above and equal to the k-th largest key found so far
+        auto counts = counts_buf.get_access<sycl::access::mode::atomic>(cgh);
+        cgh.parallel_for<class TopKCollect>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                              sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(size_t i = my_item.get_global_id()[0]; i < n; i += NUM_WORK_ITEMS) {
+                uint32_t key = float_order_key(values[i]);
+                gpu_size_t slot = k;
+                if(key > KTH_KEY) {
+                    slot = counts[0].fetch_add(1);
+                }
+                else if(key == KTH_KEY) {
+                    gpu_size_t tie = counts[1].fetch_add(1);
+                    if(tie < NUM_TIES) {
+                        slot = NUM_ABOVE + tie;
+                    }
+                }
+                if(slot < k) {
+                    indices_out[slot] = i;
+                    values_out[slot] = values[i];
+                }
+            }
+    }); });
+
+    // sort the k results on the host
+    auto indices = top_indices_buf.get_access<sycl::access::mode::read>();
+    auto values = top_values_buf.get_access<sycl::access::mode::read>();
+    std::vector<std::pair<float, index_type> > top(k);
+    for(size_t i = 0; i < k; ++i) {
+        top[i] = std::make_pair(values[i], indices[i]);
+    }
+    std::sort(top.begin(), top.end(), [](const std::pair<float, index_type> &a,
+                                         const std::pair<float, index_type> &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    for(const auto &value_index : top) {
+        top_values.push_back(value_index.first);
+        top_indices.push_back(value_index.second);
+    }
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// SampleSummary summarize_samples mann_whitney_greater
+#include "bench_stats.h"
+
+// the most samples (of both kinds) for which the exact U distribution is used
+static const size_t MANN_WHITNEY_EXACT_MAX = 40;
+
+/** @return the median of the sorted values */
+static double sorted_median(const std::vector<double> &sorted) {
+  size_t n = sorted.size();
+  return n % 2 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+/** @return P(X <= k) for X ~ Binomial(n, 1/2) */
+static double binomial_half_cdf(size_t n, size_t k) {
+  double cdf = 0;
+  for (size_t i = 0; i <= k && i <= n; ++i) {
+    cdf += std::exp(std::lgamma(n + 1.0) - std::lgamma(i + 1.0)
+                    - std::lgamma(n - i + 1.0) - n * std::log(2.0));
+  }
+  return cdf;
+}
+
+SampleSummary summarize_samples(std::vector<double> samples) {
+  SampleSummary summary = {};
+  size_t n = samples.size();
+  if (n == 0) {
+    return summary;
+  }
+  std::sort(samples.begin(), samples.end());
+  summary.count = n;
+  summary.min = samples.front();
+  summary.max = samples.back();
+  summary.median = sorted_median(samples);
+
+  std::vector<double> deviations(n);
+  for (size_t i = 0; i < n; ++i) {
+    deviations[i] = std::fabs(samples[i] - summary.median);
+  }
+  std::sort(deviations.begin(), deviations.end());
+  summary.mad = sorted_median(deviations);
+
+  // The number of samples below the median is Binomial(n, 1/2), so the
+  // k-th smallest and k-th largest samples bracket the median with
+  // probability 1 - 2 P(X <= k - 1). Take the narrowest such interval
+  // which still reaches SAMPLE_CONFIDENCE.
+  const double tail = (1 - SAMPLE_CONFIDENCE) / 2;
+  size_t k = 0;
+  while (k + 1 <= n / 2 && binomial_half_cdf(n, k) <= tail) {
+    ++k;
+  }
+  summary.ci_low = k > 0 ? samples[k - 1] : summary.min;
+  summary.ci_high = k > 0 ? samples[n - k] : summary.max;
+  return summary;
+}
+
+/**
+ * @return P(U >= u) for the U statistic of *n* samples against *m* when
+ *         all orderings are equally likely and there are no ties
+ */
+static double mann_whitney_exact_tail(size_t n, size_t m, double u) {
+  // ways[i][j][k]: orderings of i samples and j baseline samples with
+  // U = k. The largest value is either a sample, beating all j baseline
+  // values, or a baseline value, beating nothing.
+  std::vector<std::vector<std::vector<double> > > ways(
+      n + 1, std::vector<std::vector<double> >(m + 1, std::vector<double>(n * m + 1, 0)));
+  for (size_t i = 0; i <= n; ++i) {
+    for (size_t j = 0; j <= m; ++j) {
+      if (i == 0 || j == 0) {
+        ways[i][j][0] = 1;
+        continue;
+      }
+      for (size_t k = 0; k <= i * j; ++k) {
+        ways[i][j][k] = (k >= j ? ways[i - 1][j][k - j] : 0) + ways[i][j - 1][k];
+      }
+    }
+  }
+  double total = 0, tail = 0;
+  for (size_t k = 0; k <= n * m; ++k) {
+    total += ways[n][m][k];
+    if (k >= u) {
+      tail += ways[n][m][k];
+    }
+  }
+  return tail / total;
+}
+
+double mann_whitney_greater(const std::vector<double> &samples,
+                            const std::vector<double> &baseline) {
+  size_t n = samples.size(), m = baseline.size();
+  if (n == 0 || m == 0) {
+    return 1;
+  }
+  // U counts the pairs in which the sample is larger (ties count half)
+  double u = 0;
+  bool ties = false;
+  for (double x : samples) {
+    for (double y : baseline) {
+      u += x > y ? 1 : x == y ? 0.5 : 0;
+      ties = ties || x == y;
+    }
+  }
+  if (!ties && n + m <= MANN_WHITNEY_EXACT_MAX) {
+    return mann_whitney_exact_tail(n, m, u);
+  }
+
+  // tie correction of the variance: sum of t^3 - t over groups of t equal values
+  std::vector<double> all(samples);
+  all.insert(all.end(), baseline.begin(), baseline.end());
+  std::sort(all.begin(), all.end());
+  double tie_sum = 0;
+  for (size_t i = 0; i < all.size();) {
+    size_t j = i;
+    while (j < all.size() && all[j] == all[i]) {
+      ++j;
+    }
+    double t = j - i;
+    tie_sum += t * t * t - t;
+    i = j;
+  }
+  double N = n + m,
+         mean = n * m / 2.0,
+         variance = n * m / 12.0 * ((N + 1) - tie_sum / (N * (N - 1)));
+  if (variance <= 0) {
+    return 1;
+  }
+  // (with a continuity correction)
+  double z = (u - mean - 0.5) / std::sqrt(variance);
+  return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
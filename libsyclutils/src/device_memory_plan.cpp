@@ -0,0 +1,47 @@
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+
+// bytes per MB
+static const double BYTES_PER_MB = 1048576.0;
+
+void DeviceMemoryPlan::add(const char *name, size_t bytes) {
+    this->entries.push_back(Entry{std::string(name), bytes});
+}
+
+void DeviceMemoryPlan::clear() {
+    this->entries.clear();
+}
+
+size_t DeviceMemoryPlan::total_bytes() const {
+    size_t total = 0;
+    for(const Entry &entry : this->entries) {
+        total += entry.bytes;
+    }
+    return total;
+}
+
+size_t DeviceMemoryPlan::largest_bytes() const {
+    size_t largest = 0;
+    for(const Entry &entry : this->entries) {
+        largest = (entry.bytes > largest) ? entry.bytes : largest;
+    }
+    return largest;
+}
+
+bool DeviceMemoryPlan::fits(size_t global_mem_size, size_t max_mem_alloc_size) const {
+    return this->total_bytes() <= global_mem_size
+        && this->largest_bytes() <= max_mem_alloc_size;
+}
+
+void DeviceMemoryPlan::print(FILE *f, size_t global_mem_size, size_t max_mem_alloc_size) const {
+    fprintf(f, "Device memory plan:\n");
+    for(const Entry &entry : this->entries) {
+        fprintf(f, "\t%-32s %10.2f MB%s\n",
+                entry.name.c_str(),
+                entry.bytes / BYTES_PER_MB,
+                (entry.bytes > max_mem_alloc_size) ? "  (exceeds max_mem_alloc_size)" : "");
+    }
+    fprintf(f, "\t%-32s %10.2f MB\n", "TOTAL", this->total_bytes() / BYTES_PER_MB);
+    fprintf(f, "\t%-32s %10.2f MB\n", "device global_mem_size", global_mem_size / BYTES_PER_MB);
+    fprintf(f, "\t%-32s %10.2f MB\n", "device max_mem_alloc_size", max_mem_alloc_size / BYTES_PER_MB);
+}
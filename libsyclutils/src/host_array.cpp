@@ -0,0 +1,123 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// HostArray host_pages_alloc host_pages_free
+#include "host_array.h"
+
+// from <linux/mman.h>, which older C libraries don't pass on
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+HostPageMode HOST_PAGE_MODE = HOST_PAGES_TRANSPARENT;
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+static size_t round_up(size_t bytes, size_t granule) {
+  return (bytes + granule - 1) / granule * granule;
+}
+
+static void advise_access(void *ptr, size_t bytes, HostAccessHint hint) {
+  if (hint == HOST_ACCESS_SEQUENTIAL) {
+    madvise(ptr, bytes, MADV_SEQUENTIAL);
+  } else if (hint == HOST_ACCESS_RANDOM) {
+    madvise(ptr, bytes, MADV_RANDOM);
+  }
+}
+
+bool parse_host_page_mode(const char *name, HostPageMode &mode) {
+  if (strcmp(name, "small") == 0) {
+    mode = HOST_PAGES_SMALL;
+  } else if (strcmp(name, "transparent") == 0) {
+    mode = HOST_PAGES_TRANSPARENT;
+  } else if (strcmp(name, "explicit") == 0) {
+    mode = HOST_PAGES_EXPLICIT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void *host_pages_alloc(size_t bytes, HostAccessHint hint, size_t &mapped_bytes) {
+  const size_t page = sysconf(_SC_PAGESIZE);
+  bytes = bytes > 0 ? bytes : 1;
+  bool huge = bytes >= HUGE_PAGE_SIZE && HOST_PAGE_MODE != HOST_PAGES_SMALL;
+
+  if (huge && HOST_PAGE_MODE == HOST_PAGES_EXPLICIT) {
+    mapped_bytes = round_up(bytes, HUGE_PAGE_SIZE);
+    void *ptr = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+    if (ptr != MAP_FAILED) {
+      advise_access(ptr, mapped_bytes, hint);
+      return ptr;
+    }
+    // the hugetlbfs pool is empty (or absent): use transparent huge pages
+  }
+
+  if (!huge) {
+    mapped_bytes = round_up(bytes, page);
+    void *ptr = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) {
+      return nullptr;
+    }
+    if (HOST_PAGE_MODE == HOST_PAGES_SMALL) {
+      // even if transparent huge pages are enabled system-wide
+      madvise(ptr, mapped_bytes, MADV_NOHUGEPAGE);
+    }
+    advise_access(ptr, mapped_bytes, hint);
+    return ptr;
+  }
+
+  // Over-map by a huge page and trim both ends, so that the mapping
+  // starts on a 2 MB boundary and whole huge pages can back it
+  mapped_bytes = round_up(bytes, HUGE_PAGE_SIZE);
+  size_t padded_bytes = mapped_bytes + HUGE_PAGE_SIZE;
+  void *padded = mmap(NULL, padded_bytes, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (padded == MAP_FAILED) {
+    return nullptr;
+  }
+  uintptr_t start = round_up((uintptr_t) padded, HUGE_PAGE_SIZE);
+  size_t head = start - (uintptr_t) padded,
+         tail = padded_bytes - head - mapped_bytes;
+  if (head > 0) {
+    munmap(padded, head);
+  }
+  if (tail > 0) {
+    munmap((void *) (start + mapped_bytes), tail);
+  }
+  madvise((void *) start, mapped_bytes, MADV_HUGEPAGE);
+  advise_access((void *) start, mapped_bytes, hint);
+  return (void *) start;
+}
+
+void host_pages_free(void *ptr, size_t mapped_bytes) {
+  munmap(ptr, mapped_bytes);
+}
+
+long long host_huge_page_bytes() {
+  std::ifstream smaps("/proc/self/smaps_rollup");
+  if (!smaps) {
+    return -1;
+  }
+  long long total_kb = 0;
+  std::string line;
+  while (std::getline(smaps, line)) {
+    long long kb;
+    if (sscanf(line.c_str(), "AnonHugePages: %lld kB", &kb) == 1
+        || sscanf(line.c_str(), "Private_Hugetlb: %lld kB", &kb) == 1
+        || sscanf(line.c_str(), "Shared_Hugetlb: %lld kB", &kb) == 1) {
+      total_kb += kb;
+    }
+  }
+  return total_kb * 1024;
+}
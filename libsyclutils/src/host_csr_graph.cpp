@@ -1,12 +1,21 @@
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
 // Host_CSR_Graph index_type node_data_type
 #include "host_csr_graph.h"
 
 Host_CSR_Graph::Host_CSR_Graph() {
     nnodes = 0;
     nedges = 0;
-    row_start = NULL;
-    edge_dst = NULL;
-    node_data = NULL;
+}
+
+void Host_CSR_Graph::release() {
+    nnodes = 0;
+    nedges = 0;
+    row_start.release();
+    edge_dst.release();
+    node_data.release();
 }
 
 unsigned Host_CSR_Graph::readFromGR(char file[]) {
@@ -24,7 +33,8 @@ unsigned Host_CSR_Graph::readFromGR(char file[]) {
   int f = fstat(masterFD, &buf);
   if (f == -1) {
     printf("Host_CSR_Graph::readFromGR: unable to stat %s.\n", file);
-    abort();
+    close(masterFD);
+    return 1;
   }
   size_t masterLength = buf.st_size;
 
@@ -33,19 +43,38 @@ unsigned Host_CSR_Graph::readFromGR(char file[]) {
   void* m = mmap(0, masterLength, PROT_READ, _MAP_BASE, masterFD, 0);
   if (m == MAP_FAILED) {
     m = 0;
-    printf("Host_CSR_Graph::readFromGR: mmap failed.\n");
-    abort();
+    printf("Host_CSR_Graph::readFromGR: mmap of %s failed.\n", file);
+    close(masterFD);
+    return 1;
   }
+  // the file is parsed front to back, so read ahead aggressively
+  madvise(m, masterLength, MADV_SEQUENTIAL);
 
   auto startTime = std::chrono::system_clock::now();
 
   // parse file
+  const size_t HEADER_BYTES = 4 * sizeof(uint64_t);
+  if (masterLength < HEADER_BYTES) {
+    printf("Host_CSR_Graph::readFromGR: %s is too short for a .gr header.\n", file);
+    munmap(m, masterLength);
+    close(masterFD);
+    return 1;
+  }
   uint64_t* fptr                           = (uint64_t*)m;
   __attribute__((unused)) uint64_t version = le64toh(*fptr++);
   assert(version == 1);
   uint64_t sizeEdgeTy = le64toh(*fptr++);
   uint64_t numNodes   = le64toh(*fptr++);
   uint64_t numEdges   = le64toh(*fptr++);
+  // (compared by division, so a corrupt header can't overflow the sizes)
+  size_t body_bytes = masterLength - HEADER_BYTES;
+  if (numNodes > body_bytes / sizeof(uint64_t)
+      || numEdges > (body_bytes - numNodes * sizeof(uint64_t)) / sizeof(uint32_t)) {
+    printf("Host_CSR_Graph::readFromGR: %s is truncated.\n", file);
+    munmap(m, masterLength);
+    close(masterFD);
+    return 1;
+  }
   uint64_t* outIdx    = fptr;
   fptr += numNodes;
   uint32_t* fptr32 = (uint32_t*)fptr;
@@ -59,7 +88,12 @@ unsigned Host_CSR_Graph::readFromGR(char file[]) {
   this->nedges = numEdges;
 
   printf("nnodes=%d, nedges=%d, sizeEdge=%d.\n", this->nnodes, this->nedges, sizeEdgeTy);
-  this->allocSpace();
+  if (!this->allocSpace()) {
+    printf("Host_CSR_Graph::readFromGR: unable to allocate space.\n");
+    munmap(m, masterLength);
+    close(masterFD);
+    return 1;
+  }
 
   row_start[0] = 0;
 
@@ -82,7 +116,9 @@ unsigned Host_CSR_Graph::readFromGR(char file[]) {
     progressPrint(this->nnodes, ii);
   }
 
-  cfile.close(); // probably galois doesn't close its file due to mmap.
+  cfile.close();
+  munmap(m, masterLength);
+  close(masterFD);
   auto endTime = std::chrono::system_clock::now();
   double time_in_ms = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
 
@@ -93,24 +129,105 @@ unsigned Host_CSR_Graph::readFromGR(char file[]) {
   return 0;
 }
 
+unsigned Host_CSR_Graph::buildTranspose(index_type nnodes, index_type nedges,
+                                        const index_type *row_start, const index_type *edge_dst) {
+  this->nnodes = nnodes;
+  this->nedges = nedges;
+  if(!this->allocSpace(false)) {
+    printf("Host_CSR_Graph::buildTranspose: unable to allocate space.\n");
+    return 1;
+  }
+
+  // count the in-degree of each node into row_start[node+1]
+  // (allocSpace zeroes the arrays)
+  for (index_type edge = 0; edge < nedges; ++edge) {
+    this->row_start[edge_dst[edge] + 1]++;
+  }
+  for (index_type node = 0; node < nnodes; ++node) {
+    this->row_start[node + 1] += this->row_start[node];
+  }
+
+  // place each edge at the next free position of its destination.
+  // Sources are visited in increasing order, so edges end up sorted.
+  index_type *next_edge = (index_type*)malloc(nnodes * sizeof(index_type));
+  if(next_edge == NULL) {
+    printf("Host_CSR_Graph::buildTranspose: unable to allocate space.\n");
+    return 1;
+  }
+  memcpy(next_edge, this->row_start, nnodes * sizeof(index_type));
+  for (index_type src = 0; src < nnodes; ++src) {
+    for (index_type edge = row_start[src]; edge < row_start[src + 1]; ++edge) {
+      this->edge_dst[next_edge[edge_dst[edge]]++] = src;
+    }
+  }
+  free(next_edge);
+
+  return 0;
+}
+
+unsigned Host_CSR_Graph::buildUndirected(index_type nnodes, index_type nedges,
+                                         const index_type *edge_src, const index_type *edge_dst) {
+  // count the degree of each node into row_start[node+1]
+  // (allocSpace zeroes the arrays)
+  index_type num_self_loops = 0;
+  for (index_type edge = 0; edge < nedges; ++edge) {
+    num_self_loops += (edge_src[edge] == edge_dst[edge]);
+  }
+  this->nnodes = nnodes;
+  this->nedges = 2 * nedges - num_self_loops;
+  if(!this->allocSpace()) {
+    printf("Host_CSR_Graph::buildUndirected: unable to allocate space.\n");
+    return 1;
+  }
+  for (index_type edge = 0; edge < nedges; ++edge) {
+    this->row_start[edge_src[edge] + 1]++;
+    if (edge_src[edge] != edge_dst[edge]) {
+      this->row_start[edge_dst[edge] + 1]++;
+    }
+  }
+  for (index_type node = 0; node < nnodes; ++node) {
+    this->row_start[node + 1] += this->row_start[node];
+  }
+
+  // place each edge at the next free position of its source
+  index_type *next_edge = (index_type*)malloc(nnodes * sizeof(index_type));
+  if(next_edge == NULL) {
+    printf("Host_CSR_Graph::buildUndirected: unable to allocate space.\n");
+    return 1;
+  }
+  memcpy(next_edge, this->row_start, nnodes * sizeof(index_type));
+  for (index_type edge = 0; edge < nedges; ++edge) {
+    index_type src = edge_src[edge], dst = edge_dst[edge];
+    this->edge_dst[next_edge[src]++] = dst;
+    if (src != dst) {
+      this->edge_dst[next_edge[dst]++] = src;
+    }
+  }
+  free(next_edge);
+
+  return 0;
+}
+
 // Copied from
 // https://github.com/IntelligentSoftwareSystems/Galois/blob/c6ab08b14b1daa20d6b408720696c8a36ffe30cb/libgpu/src/csr_graph.cu#L28
-unsigned Host_CSR_Graph::allocSpace() {
+unsigned Host_CSR_Graph::allocSpace(bool with_node_data) {
   assert(this->nnodes > 0);
 
-  if (this->row_start != NULL) // already allocated
-    return true;
-
   size_t mem_usage = ((this->nnodes + 1) + this->nedges) * sizeof(index_type) +
-                     (this->nnodes) * sizeof(node_data_type);
+                     (with_node_data ? this->nnodes * sizeof(node_data_type) : 0);
 
-  printf("Host memory for graph: %3u MB\n", mem_usage / 1048756);
+  printf("Host memory for graph: %3u MB\n", (unsigned) (mem_usage / 1048576));
 
-  this->row_start = (index_type*)calloc(this->nnodes + 1, sizeof(index_type));
-  this->edge_dst  = (index_type*)calloc(this->nedges, sizeof(index_type));
-  this->node_data = (node_data_type*)calloc(this->nnodes, sizeof(node_data_type));
+  // zeroed, like calloc
+  this->row_start.allocate(this->nnodes + 1, HOST_ACCESS_NORMAL);
+  this->edge_dst.allocate(this->nedges, HOST_ACCESS_SEQUENTIAL);
+  if (!with_node_data) {
+    this->node_data.release();
+    return (this->row_start.get() && this->edge_dst.get());
+  }
+  this->node_data.allocate(this->nnodes, HOST_ACCESS_RANDOM);
 
-  return (this->row_start && this->edge_dst && this->node_data);
+  return (this->row_start.get() && this->edge_dst.get() && this->node_data.get());
 }
 
 // Copied from https://github.com/IntelligentSoftwareSystems/Galois/blob/c6ab08b14b1daa20d6b408720696c8a36ffe30cb/libgpu/src/csr_graph.cu#L156
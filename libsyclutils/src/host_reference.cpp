@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// reference_bfs reference_pagerank host_reference_isa
+#include "host_reference.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HOST_REFERENCE_X86 1
+#include <immintrin.h>
+#endif
+
+// The vector gathers index with 64-bit lanes
+static_assert(sizeof(index_type) == 8, "host_reference expects a 64-bit index_type");
+
+// Beamer's direction-switching parameters, as in bfs-direction-optimizing
+static const size_t BEAMER_ALPHA = 14,
+                    BEAMER_BETA = 24;
+
+// bitmap words per chunk of BFS scheduling, and nodes per chunk of PageRank
+static const size_t WORDS_PER_CHUNK = 16,
+                    NODES_PER_CHUNK = 1024;
+
+namespace {
+
+/**
+ * The vectorized inner loops, one version per instruction set
+ */
+struct Kernels {
+  const char *isa;
+  /** @return the sum of values[indices[i]] over [first, last) */
+  float (*gather_sum)(const float *values, const index_type *indices,
+                      index_type first, index_type last);
+  /** @return true iff the bit of some indices[i] over [first, last) is set in *bitmap* */
+  bool (*any_in_bitmap)(const uint64_t *bitmap, const index_type *indices,
+                        index_type first, index_type last);
+};
+
+float gather_sum_portable(const float *values, const index_type *indices,
+                          index_type first, index_type last) {
+  float sum = 0.0f;
+  for (index_type i = first; i < last; ++i) {
+    sum += values[indices[i]];
+  }
+  return sum;
+}
+
+bool any_in_bitmap_portable(const uint64_t *bitmap, const index_type *indices,
+                            index_type first, index_type last) {
+  for (index_type i = first; i < last; ++i) {
+    if (bitmap[indices[i] / 64] & ((uint64_t) 1 << (indices[i] % 64))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef HOST_REFERENCE_X86
+// 4 lanes of 64-bit indices per gather
+__attribute__((target("avx2")))
+float gather_sum_avx2(const float *values, const index_type *indices,
+                      index_type first, index_type last) {
+  __m128 sum = _mm_setzero_ps();
+  index_type i = first;
+  for (; i + 4 <= last; i += 4) {
+    __m256i idx = _mm256_loadu_si256((const __m256i *) (indices + i));
+    sum = _mm_add_ps(sum, _mm256_i64gather_ps(values, idx, sizeof(float)));
+  }
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_movehdup_ps(sum));
+  float total = _mm_cvtss_f32(sum);
+  for (; i < last; ++i) {
+    total += values[indices[i]];
+  }
+  return total;
+}
+
+__attribute__((target("avx2")))
+bool any_in_bitmap_avx2(const uint64_t *bitmap, const index_type *indices,
+                        index_type first, index_type last) {
+  const __m256i one = _mm256_set1_epi64x(1),
+                bit_mask = _mm256_set1_epi64x(63);
+  index_type i = first;
+  for (; i + 4 <= last; i += 4) {
+    __m256i idx = _mm256_loadu_si256((const __m256i *) (indices + i));
+    __m256i words = _mm256_i64gather_epi64((const long long *) bitmap,
+                                           _mm256_srli_epi64(idx, 6), sizeof(uint64_t));
+    __m256i bits = _mm256_sllv_epi64(one, _mm256_and_si256(idx, bit_mask));
+    if (!_mm256_testz_si256(words, bits)) {
+      return true;
+    }
+  }
+  return any_in_bitmap_portable(bitmap, indices, i, last);
+}
+
+// 8 lanes per gather, and the tail is a masked gather
+__attribute__((target("avx512f")))
+float gather_sum_avx512(const float *values, const index_type *indices,
+                        index_type first, index_type last) {
+  __m256 sum = _mm256_setzero_ps();
+  index_type i = first;
+  for (; i + 8 <= last; i += 8) {
+    __m512i idx = _mm512_loadu_si512((const void *) (indices + i));
+    sum = _mm256_add_ps(sum, _mm512_i64gather_ps(idx, values, sizeof(float)));
+  }
+  if (i < last) {
+    __mmask8 tail = (__mmask8) ((1u << (last - i)) - 1);
+    __m512i idx = _mm512_maskz_loadu_epi64(tail, (const void *) (indices + i));
+    sum = _mm256_add_ps(sum, _mm512_mask_i64gather_ps(_mm256_setzero_ps(), tail, idx,
+                                                      values, sizeof(float)));
+  }
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum), _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_movehdup_ps(half));
+  return _mm_cvtss_f32(half);
+}
+
+__attribute__((target("avx512f")))
+bool any_in_bitmap_avx512(const uint64_t *bitmap, const index_type *indices,
+                          index_type first, index_type last) {
+  const __m512i one = _mm512_set1_epi64(1),
+                bit_mask = _mm512_set1_epi64(63);
+  for (index_type i = first; i < last; i += 8) {
+    __mmask8 lanes = (__mmask8) (last - i >= 8 ? 0xff : (1u << (last - i)) - 1);
+    __m512i idx = _mm512_maskz_loadu_epi64(lanes, (const void *) (indices + i));
+    __m512i words = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), lanes,
+                                                _mm512_srli_epi64(idx, 6), bitmap,
+                                                sizeof(uint64_t));
+    __m512i bits = _mm512_sllv_epi64(one, _mm512_and_epi64(idx, bit_mask));
+    if (_mm512_mask_test_epi64_mask(lanes, words, bits)) {
+      return true;
+    }
+  }
+  return false;
+}
+#endif
+
+/**
+ * Pick the widest version the CPU supports.
+ * HOST_REFERENCE_ISA=avx2|portable in the environment caps the choice.
+ */
+Kernels choose_kernels() {
+  const char *cap = getenv("HOST_REFERENCE_ISA");
+  bool allow_avx512 = !cap || strcmp(cap, "avx512") == 0,
+       allow_avx2 = allow_avx512 || strcmp(cap, "avx2") == 0;
+#ifdef HOST_REFERENCE_X86
+  __builtin_cpu_init();
+  if (allow_avx512 && __builtin_cpu_supports("avx512f")) {
+    return Kernels{ "avx512", gather_sum_avx512, any_in_bitmap_avx512 };
+  }
+  if (allow_avx2 && __builtin_cpu_supports("avx2")) {
+    return Kernels{ "avx2", gather_sum_avx2, any_in_bitmap_avx2 };
+  }
+#else
+  (void) allow_avx2;
+#endif
+  return Kernels{ "portable", gather_sum_portable, any_in_bitmap_portable };
+}
+
+const Kernels &kernels() {
+  static const Kernels chosen = choose_kernels();
+  return chosen;
+}
+
+// each thread's statistics for a level or iteration, on its own cache line
+struct alignas(64) ThreadStats {
+  size_t nodes, edges;
+  // the largest change in rank, relative to max(1, rank)
+  float max_delta;
+};
+
+}  // namespace
+
+const char *host_reference_isa() {
+  return kernels().isa;
+}
+
+size_t reference_bfs(HostThreadPool &pool,
+                     const Host_CSR_Graph &graph, const Host_CSR_Graph &transpose,
+                     index_type start_node, node_data_type unvisited,
+                     node_data_type *levels) {
+  const Kernels &k = kernels();
+  const index_type nnodes = graph.nnodes;
+  const size_t nwords = (nnodes + 63) / 64;
+  std::vector<uint64_t> frontier(nwords, 0), next(nwords, 0), visited(nwords, 0);
+  std::vector<ThreadStats> stats(pool.size());
+
+  pool.parallel_for_range(nnodes, NODES_PER_CHUNK, [&](unsigned, size_t first, size_t last) {
+    std::fill(levels + first, levels + last, unvisited);
+  });
+  if (!graph.is_valid_node(start_node)) {
+    return 0;
+  }
+  levels[start_node] = 0;
+  frontier[start_node / 64] = visited[start_node / 64] = (uint64_t) 1 << (start_node % 64);
+
+  size_t level = 0,
+         frontier_size = 1,
+         frontier_edges = graph.get_out_degree(start_node),
+         // edges out of nodes which have already been in a frontier
+         explored_edges = 0;
+  bool bottom_up = false;
+  while (frontier_size > 0) {
+    level++;
+    // Pick a direction
+    size_t unexplored_edges = graph.nedges - explored_edges;
+    if (!bottom_up && frontier_edges > unexplored_edges / BEAMER_ALPHA) {
+      bottom_up = true;
+    } else if (bottom_up && frontier_size < nnodes / BEAMER_BETA) {
+      bottom_up = false;
+    }
+    explored_edges += frontier_edges;
+    for (auto &s : stats) {
+      s.nodes = s.edges = 0;
+    }
+
+    if (bottom_up) {
+      // Each thread owns whole words of *next* and *visited*, so no atomics
+      pool.parallel_for_range(nwords, WORDS_PER_CHUNK, [&](unsigned thread, size_t first, size_t last) {
+        ThreadStats &s = stats[thread];
+        for (size_t w = first; w < last; ++w) {
+          uint64_t candidates = ~visited[w];
+          if (w == nwords - 1 && nnodes % 64) {
+            candidates &= ((uint64_t) 1 << (nnodes % 64)) - 1;
+          }
+          uint64_t found = 0;
+          while (candidates) {
+            unsigned b = __builtin_ctzll(candidates);
+            candidates &= candidates - 1;
+            index_type node = w * 64 + b;
+            if (k.any_in_bitmap(frontier.data(), transpose.edge_dst,
+                                transpose.row_start[node], transpose.row_start[node + 1])) {
+              found |= (uint64_t) 1 << b;
+              levels[node] = level;
+              s.nodes++;
+              s.edges += graph.get_out_degree(node);
+            }
+          }
+          next[w] = found;
+          visited[w] |= found;
+        }
+      });
+    } else {
+      std::fill(next.begin(), next.end(), 0);
+      // Claim each node by setting its visited bit, so it is discovered once
+      pool.parallel_for_range(nwords, WORDS_PER_CHUNK, [&](unsigned thread, size_t first, size_t last) {
+        ThreadStats &s = stats[thread];
+        for (size_t w = first; w < last; ++w) {
+          uint64_t members = frontier[w];
+          while (members) {
+            index_type src = w * 64 + __builtin_ctzll(members);
+            members &= members - 1;
+            for (index_type edge = graph.row_start[src]; edge < graph.row_start[src + 1]; ++edge) {
+              index_type dst = graph.edge_dst[edge];
+              uint64_t bit = (uint64_t) 1 << (dst % 64);
+              if (__atomic_load_n(&visited[dst / 64], __ATOMIC_RELAXED) & bit) {
+                continue;
+              }
+              if (!(__atomic_fetch_or(&visited[dst / 64], bit, __ATOMIC_RELAXED) & bit)) {
+                levels[dst] = level;
+                __atomic_fetch_or(&next[dst / 64], bit, __ATOMIC_RELAXED);
+                s.nodes++;
+                s.edges += graph.get_out_degree(dst);
+              }
+            }
+          }
+        }
+      });
+    }
+
+    std::swap(frontier, next);
+    frontier_size = frontier_edges = 0;
+    for (const auto &s : stats) {
+      frontier_size += s.nodes;
+      frontier_edges += s.edges;
+    }
+  }
+  return level;
+}
+
+int reference_pagerank(HostThreadPool &pool,
+                       const Host_CSR_Graph &graph, const Host_CSR_Graph &transpose,
+                       float alpha, float epsilon, int max_iterations,
+                       float *ranks) {
+  const Kernels &k = kernels();
+  const index_type nnodes = graph.nnodes;
+  // rank / out-degree of each node, which its out-neighbours pull
+  HostArray<float> contributions(nnodes, HOST_ACCESS_RANDOM);
+  std::vector<ThreadStats> stats(pool.size());
+
+  pool.parallel_for_range(nnodes, NODES_PER_CHUNK, [&](unsigned, size_t first, size_t last) {
+    std::fill(ranks + first, ranks + last, 1.0f - alpha);
+  });
+  int iteration = 0;
+  while (iteration < max_iterations) {
+    pool.parallel_for_range(nnodes, NODES_PER_CHUNK, [&](unsigned, size_t first, size_t last) {
+      for (index_type node = first; node < last; ++node) {
+        index_type degree = graph.get_out_degree(node);
+        contributions[node] = degree > 0 ? ranks[node] / degree : 0.0f;
+      }
+    });
+    for (auto &s : stats) {
+      s.max_delta = 0.0f;
+    }
+    pool.parallel_for_range(nnodes, NODES_PER_CHUNK, [&](unsigned thread, size_t first, size_t last) {
+      ThreadStats &s = stats[thread];
+      for (index_type node = first; node < last; ++node) {
+        float rank = (1.0f - alpha)
+                     + alpha * k.gather_sum(contributions.get(), transpose.edge_dst,
+                                            transpose.row_start[node], transpose.row_start[node + 1]);
+        s.max_delta = std::max(s.max_delta,
+                               std::fabs(rank - ranks[node]) / std::max(1.0f, rank));
+        ranks[node] = rank;
+      }
+    });
+    iteration++;
+
+    float max_delta = 0.0f;
+    for (const auto &s : stats) {
+      max_delta = std::max(max_delta, s.max_delta);
+    }
+    if (max_delta < epsilon) {
+      break;
+    }
+  }
+  return iteration;
+}
@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+// Host_SELL_Graph index_type
+#include "host_sell_graph.h"
+
+Host_SELL_Graph::Host_SELL_Graph() {
+    nnodes = 0;
+    slice_height = 0;
+    nslices = 0;
+    nentries = 0;
+}
+
+unsigned Host_SELL_Graph::buildFromCSR(index_type nnodes,
+                                       const index_type *row_start, const index_type *edge_dst,
+                                       index_type slice_height, index_type sort_window) {
+  assert(slice_height > 0);
+  assert(sort_window % slice_height == 0);
+  this->nnodes = nnodes;
+  this->slice_height = slice_height;
+  this->nslices = (nnodes + slice_height - 1) / slice_height;
+
+  // sort the rows of each window by decreasing degree.
+  // Rows padding out the last slice hold the dummy node.
+  const index_type nrows = this->nslices * slice_height;
+  if(!this->row_node.allocate(nrows, HOST_ACCESS_NORMAL)
+     || !this->slice_start.allocate(this->nslices + 1, HOST_ACCESS_NORMAL)) {
+    printf("Host_SELL_Graph::buildFromCSR: unable to allocate space.\n");
+    return 1;
+  }
+  for (index_type row = 0; row < nrows; ++row) {
+    this->row_node[row] = row < nnodes ? row : nnodes;
+  }
+  auto degree = [=](index_type node) {
+    return node < nnodes ? row_start[node + 1] - row_start[node] : 0;
+  };
+  for (index_type window = 0; window < nnodes; window += sort_window) {
+    index_type *first = this->row_node + window,
+               *last  = this->row_node + std::min(window + sort_window, nnodes);
+    std::stable_sort(first, last, [&](index_type a, index_type b) {
+      return degree(a) > degree(b);
+    });
+  }
+
+  // each slice is as wide as its longest row
+  this->slice_start[0] = 0;
+  for (index_type slice = 0; slice < this->nslices; ++slice) {
+    index_type width = 0;
+    for (index_type r = 0; r < slice_height; ++r) {
+      width = std::max(width, degree(this->row_node[slice * slice_height + r]));
+    }
+    this->slice_start[slice + 1] = this->slice_start[slice] + width * slice_height;
+  }
+  this->nentries = this->slice_start[this->nslices];
+
+  // fill in the entries column-major, padding with the dummy node
+  if(!this->neighbors.allocate(std::max(this->nentries, (index_type) 1), HOST_ACCESS_SEQUENTIAL)) {
+    printf("Host_SELL_Graph::buildFromCSR: unable to allocate space.\n");
+    return 1;
+  }
+  for (index_type slice = 0; slice < this->nslices; ++slice) {
+    index_type width = (this->slice_start[slice + 1] - this->slice_start[slice]) / slice_height;
+    for (index_type r = 0; r < slice_height; ++r) {
+      index_type node = this->row_node[slice * slice_height + r];
+      for (index_type j = 0; j < width; ++j) {
+        this->neighbors[this->slice_start[slice] + j * slice_height + r] =
+            j < degree(node) ? edge_dst[row_start[node] + j] : nnodes;
+      }
+    }
+  }
+
+  printf("Host memory for SELL-%zu-%zu graph: %3u MB\n", slice_height, sort_window,
+         (unsigned) (((this->nslices + 1) + nrows + this->nentries) * sizeof(index_type) / 1048576));
+  return 0;
+}
+
+double Host_SELL_Graph::padding_overhead() const {
+  index_type nedges = 0;
+  for (index_type e = 0; e < this->nentries; ++e) {
+    nedges += this->neighbors[e] != this->nnodes;
+  }
+  return nedges == 0 ? 0.0 : (double) (this->nentries - nedges) / nedges;
+}
@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cassert>
+
+// HostThreadPool
+#include "host_thread_pool.h"
+// PIN_HOST_THREADS numa_thread_cpu pin_current_thread
+#include "numa_placement.h"
+
+static inline uint64_t pack_range(uint32_t begin, uint32_t end) {
+  return ((uint64_t) begin << 32) | end;
+}
+static inline uint32_t range_begin(uint64_t range) {
+  return (uint32_t) (range >> 32);
+}
+static inline uint32_t range_end(uint64_t range) {
+  return (uint32_t) range;
+}
+
+HostThreadPool::HostThreadPool(unsigned num_threads)
+    : num_threads{ num_threads > 0 ? num_threads
+                                   : std::max(1u, std::thread::hardware_concurrency()) }
+    , ranges{ new ChunkRange[this->num_threads] }
+    , body{ nullptr }
+    , each_body{ nullptr }
+    , caller_pinned{ false }
+    , generation{ 0 }
+    , num_busy{ 0 }
+    , stopping{ false } {
+  for (unsigned t = 0; t < this->num_threads; ++t) {
+    ranges[t].range.store(pack_range(0, 0));
+  }
+  // the calling thread is thread 0
+  if (PIN_HOST_THREADS && pthread_getaffinity_np(pthread_self(), sizeof(caller_affinity), &caller_affinity) == 0) {
+    caller_pinned = pin_current_thread(numa_thread_cpu(0, this->num_threads));
+  }
+  for (unsigned t = 1; t < this->num_threads; ++t) {
+    workers.emplace_back(&HostThreadPool::worker_loop, this, t);
+  }
+}
+
+HostThreadPool::~HostThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start_loop.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  if (caller_pinned) {
+    pthread_setaffinity_np(pthread_self(), sizeof(caller_affinity), &caller_affinity);
+  }
+}
+
+void HostThreadPool::parallel_for(size_t num_chunks,
+                                  const std::function<void(unsigned, size_t)> &body) {
+  assert(num_chunks < UINT32_MAX);
+  if (num_chunks == 0) {
+    return;
+  }
+  for (unsigned t = 0; t < num_threads; ++t) {
+    ranges[t].range.store(pack_range(num_chunks * t / num_threads,
+                                     num_chunks * (t + 1) / num_threads));
+  }
+  this->body = &body;
+  run_loop();
+  this->body = nullptr;
+}
+
+void HostThreadPool::for_each_thread(const std::function<void(unsigned)> &body) {
+  this->each_body = &body;
+  run_loop();
+  this->each_body = nullptr;
+}
+
+void HostThreadPool::run_loop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    num_busy = num_threads - 1;
+    generation++;
+  }
+  start_loop.notify_all();
+  if (each_body) {
+    (*each_body)(0);
+  } else {
+    work(0);
+  }
+  std::unique_lock<std::mutex> lock(mutex);
+  finish_loop.wait(lock, [this]() { return num_busy == 0; });
+}
+
+void HostThreadPool::parallel_for_range(size_t n, size_t chunk_size,
+                                        const std::function<void(unsigned, size_t, size_t)> &body) {
+  parallel_for((n + chunk_size - 1) / chunk_size, [&](unsigned thread, size_t chunk) {
+    size_t first = chunk * chunk_size;
+    body(thread, first, std::min(first + chunk_size, n));
+  });
+}
+
+void HostThreadPool::work(unsigned thread) {
+  do {
+    uint64_t range = ranges[thread].range.load();
+    while (range_begin(range) < range_end(range)) {
+      uint32_t chunk = range_begin(range);
+      // on failure, *range* is reloaded and we try again
+      if (ranges[thread].range.compare_exchange_weak(range, pack_range(chunk + 1, range_end(range)))) {
+        (*body)(thread, chunk);
+        range = ranges[thread].range.load();
+      }
+    }
+  } while (steal(thread));
+}
+
+bool HostThreadPool::steal(unsigned thread) {
+  for (unsigned i = 1; i < num_threads; ++i) {
+    unsigned victim = (thread + i) % num_threads;
+    uint64_t range = ranges[victim].range.load();
+    while (range_begin(range) < range_end(range)) {
+      uint32_t begin = range_begin(range),
+               end = range_end(range),
+               split = end - (end - begin + 1) / 2;
+      if (ranges[victim].range.compare_exchange_weak(range, pack_range(begin, split))) {
+        ranges[thread].range.store(pack_range(split, end));
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void HostThreadPool::worker_loop(unsigned thread) {
+  if (PIN_HOST_THREADS) {
+    pin_current_thread(numa_thread_cpu(thread, num_threads));
+  }
+  size_t seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start_loop.wait(lock, [&]() { return stopping || generation != seen_generation; });
+      if (stopping) {
+        return;
+      }
+      seen_generation = generation;
+    }
+    if (each_body) {
+      (*each_body)(thread);
+    } else {
+      work(thread);
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      num_busy--;
+    }
+    finish_loop.notify_one();
+  }
+}
@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <cstring>
+
+// IterationRecord write_iteration_stats ITERATION_STATS_FILE
+#include "iteration_record.h"
+
+const char *ITERATION_STATS_FILE = nullptr;
+bool RECORD_ITERATION_STATS = true;
+
+static const char *PHASE_NAMES[NUM_ITERATION_PHASES] = {
+  "schedule_ms", "dedupe_ms", "compress_ms", "update_ms"
+};
+
+static void write_table(FILE *f, const std::vector<IterationRecord> &records) {
+  fprintf(f, "%6s %5s %5s %10s %12s %10s %8s %10s", "iter", "dense", "rerun",
+          "frontier", "edges", "pushes", "failed", "duplicates");
+  for (const char *name : PHASE_NAMES) {
+    fprintf(f, " %12s", name);
+  }
+  fprintf(f, "\n");
+
+  IterationRecord total = {};
+  size_t total_duplicates = 0;
+  for (const IterationRecord &r : records) {
+    fprintf(f, "%6zu %5d %5d %10zu %12zu %10zu %8zu %10zu", r.iteration, r.dense, r.rerun,
+            r.frontier_size, r.counters[ITERATION_EDGES], r.counters[ITERATION_PUSHES],
+            r.counters[ITERATION_PUSH_FAILURES], r.duplicates());
+    for (int phase = 0; phase < NUM_ITERATION_PHASES; ++phase) {
+      fprintf(f, " %12.4f", r.phase_ms[phase]);
+      total.phase_ms[phase] += r.phase_ms[phase];
+    }
+    fprintf(f, "\n");
+    total.frontier_size += r.frontier_size;
+    total_duplicates += r.duplicates();
+    for (int c = 0; c < NUM_ITERATION_COUNTERS; ++c) {
+      total.counters[c] += r.counters[c];
+    }
+  }
+  fprintf(f, "%6s %5s %5s %10zu %12zu %10zu %8zu %10zu", "total", "", "",
+          total.frontier_size, total.counters[ITERATION_EDGES], total.counters[ITERATION_PUSHES],
+          total.counters[ITERATION_PUSH_FAILURES], total_duplicates);
+  for (int phase = 0; phase < NUM_ITERATION_PHASES; ++phase) {
+    fprintf(f, " %12.4f", total.phase_ms[phase]);
+  }
+  fprintf(f, "\n");
+}
+
+static void write_json(FILE *f, const std::vector<IterationRecord> &records, size_t dropped) {
+  fprintf(f, "{\n  \"dropped\": %zu,\n  \"iterations\": [", dropped);
+  for (size_t i = 0; i < records.size(); ++i) {
+    const IterationRecord &r = records[i];
+    fprintf(f, "%s\n    {\"iteration\": %zu, \"dense\": %s, \"rerun\": %s, \"frontier\": %zu, "
+               "\"edges\": %zu, \"pushes\": %zu, \"failed_pushes\": %zu, \"duplicates\": %zu",
+            i ? "," : "", r.iteration, r.dense ? "true" : "false", r.rerun ? "true" : "false",
+            r.frontier_size, r.counters[ITERATION_EDGES], r.counters[ITERATION_PUSHES],
+            r.counters[ITERATION_PUSH_FAILURES], r.duplicates());
+    for (int phase = 0; phase < NUM_ITERATION_PHASES; ++phase) {
+      fprintf(f, ", \"%s\": %.6f", PHASE_NAMES[phase], r.phase_ms[phase]);
+    }
+    fprintf(f, "}");
+  }
+  fprintf(f, "\n  ]\n}\n");
+}
+
+void write_iteration_stats(const std::vector<IterationRecord> &records, size_t dropped) {
+  if (!ITERATION_STATS_FILE) {
+    return;
+  }
+  if (strcmp(ITERATION_STATS_FILE, "-") == 0) {
+    fprintf(stderr, "ITERATION STATS:\n");
+    write_table(stderr, records);
+  } else {
+    FILE *f = fopen(ITERATION_STATS_FILE, "w");
+    if (!f) {
+      fprintf(stderr, "Cannot write iteration stats to '%s'\n", ITERATION_STATS_FILE);
+      return;
+    }
+    size_t len = strlen(ITERATION_STATS_FILE);
+    if (len >= 5 && strcmp(ITERATION_STATS_FILE + len - 5, ".json") == 0) {
+      write_json(f, records, dropped);
+    } else {
+      write_table(f, records);
+    }
+    fclose(f);
+    fprintf(stderr, "Iteration stats written to %s\n", ITERATION_STATS_FILE);
+  }
+  if (dropped > 0) {
+    fprintf(stderr, "Iteration stats: the last %zu launches did not fit and were not recorded\n", dropped);
+  }
+}
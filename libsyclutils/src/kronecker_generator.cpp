@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <cstdio>
+#include <numeric>
+#include <random>
+#include <thread>
+
+// generate_kronecker_edges index_type
+#include "kronecker_generator.h"
+
+/**
+ * Fill edges [first, last) of the edge list using the Graph500
+ * reference generator's recursive quadrant choice
+ */
+static void generate_chunk(unsigned scale, uint64_t seed, size_t chunk,
+                           size_t first, size_t last,
+                           std::vector<index_type> &edge_src,
+                           std::vector<index_type> &edge_dst) {
+  std::seed_seq seq{seed, (uint64_t) chunk};
+  std::mt19937_64 rng(seq);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  const double ab = KRONECKER_A + KRONECKER_B,
+               c_norm = KRONECKER_C / (1.0 - ab),
+               a_norm = KRONECKER_A / ab;
+  for (size_t edge = first; edge < last; ++edge) {
+    index_type src = 0, dst = 0;
+    for (unsigned bit = 0; bit < scale; ++bit) {
+      bool src_bit = uniform(rng) > ab;
+      bool dst_bit = uniform(rng) > (src_bit ? c_norm : a_norm);
+      src |= ((index_type) src_bit) << bit;
+      dst |= ((index_type) dst_bit) << bit;
+    }
+    edge_src[edge] = src;
+    edge_dst[edge] = dst;
+  }
+}
+
+void generate_kronecker_edges(unsigned scale, unsigned edge_factor, uint64_t seed,
+                              std::vector<index_type> &edge_src,
+                              std::vector<index_type> &edge_dst) {
+  const index_type nnodes = ((index_type) 1) << scale;
+  const size_t nedges = (size_t) edge_factor * nnodes,
+               nchunks = (nedges + KRONECKER_CHUNK_SIZE - 1) / KRONECKER_CHUNK_SIZE;
+  printf("Generating Kronecker graph: scale=%u, edge factor=%u, seed=%llu\n",
+         scale, edge_factor, (unsigned long long) seed);
+  edge_src.resize(nedges);
+  edge_dst.resize(nedges);
+
+  // generate the chunks in parallel
+  unsigned nthreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> threads;
+  for (unsigned t = 0; t < nthreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t chunk = t; chunk < nchunks; chunk += nthreads) {
+        size_t first = chunk * KRONECKER_CHUNK_SIZE,
+               last = std::min(first + KRONECKER_CHUNK_SIZE, nedges);
+        generate_chunk(scale, seed, chunk, first, last, edge_src, edge_dst);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // hide the structure of the generator by relabelling the nodes
+  // and shuffling the edges
+  std::mt19937_64 rng(seed);
+  std::vector<index_type> label(nnodes);
+  std::iota(label.begin(), label.end(), 0);
+  std::shuffle(label.begin(), label.end(), rng);
+  for (size_t edge = 0; edge < nedges; ++edge) {
+    edge_src[edge] = label[edge_src[edge]];
+    edge_dst[edge] = label[edge_dst[edge]];
+  }
+  for (size_t edge = nedges; edge > 1; --edge) {
+    size_t other = std::uniform_int_distribution<size_t>(0, edge - 1)(rng);
+    std::swap(edge_src[edge - 1], edge_src[other]);
+    std::swap(edge_dst[edge - 1], edge_dst[other]);
+  }
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// NumaPolicy numa_place_graph numa_thread_cpu pin_current_thread
+#include "numa_placement.h"
+
+// from <numaif.h>, which comes with libnuma
+#ifndef MPOL_INTERLEAVE
+#define MPOL_INTERLEAVE 3
+#endif
+
+NumaPolicy NUMA_POLICY = NUMA_NONE;
+bool PIN_HOST_THREADS = false;
+
+namespace {
+
+/**
+ * The NUMA nodes with CPUs this process may run on
+ */
+struct NumaTopology {
+  // node numbers (as in /sys/devices/system/node/nodeN), ascending
+  std::vector<int> node_ids;
+  // the allowed CPUs of each node
+  std::vector<std::vector<int> > node_cpus;
+  // all allowed CPUs, in node order
+  std::vector<int> cpu_order;
+};
+
+/** Parse a sysfs CPU list such as "0-3,8-11" */
+std::vector<int> parse_cpu_list(const std::string &list) {
+  std::vector<int> cpus;
+  size_t pos = 0;
+  while (pos < list.size()) {
+    size_t end = list.find(',', pos);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    int first, last;
+    std::string range = list.substr(pos, end - pos);
+    if (sscanf(range.c_str(), "%d-%d", &first, &last) == 2) {
+      for (int cpu = first; cpu <= last; ++cpu) {
+        cpus.push_back(cpu);
+      }
+    } else if (sscanf(range.c_str(), "%d", &first) == 1) {
+      cpus.push_back(first);
+    }
+    pos = end + 1;
+  }
+  return cpus;
+}
+
+NumaTopology read_topology() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, &allowed);
+    }
+  }
+
+  NumaTopology topo;
+  std::vector<std::pair<int, std::vector<int> > > nodes;
+  if (DIR *dir = opendir("/sys/devices/system/node")) {
+    while (struct dirent *entry = readdir(dir)) {
+      int id;
+      if (sscanf(entry->d_name, "node%d", &id) != 1) {
+        continue;
+      }
+      std::ifstream cpulist(std::string("/sys/devices/system/node/") + entry->d_name + "/cpulist");
+      std::string list;
+      std::getline(cpulist, list);
+      std::vector<int> cpus;
+      for (int cpu : parse_cpu_list(list)) {
+        if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+          cpus.push_back(cpu);
+        }
+      }
+      // memory-only nodes and nodes we may not run on are left out
+      if (!cpus.empty()) {
+        nodes.push_back(std::make_pair(id, cpus));
+      }
+    }
+    closedir(dir);
+  }
+  std::sort(nodes.begin(), nodes.end());
+  if (nodes.empty()) {
+    // no NUMA information: one node holding every allowed CPU
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+    nodes.push_back(std::make_pair(0, cpus));
+  }
+  for (const auto &node : nodes) {
+    topo.node_ids.push_back(node.first);
+    topo.node_cpus.push_back(node.second);
+    topo.cpu_order.insert(topo.cpu_order.end(), node.second.begin(), node.second.end());
+  }
+  return topo;
+}
+
+const NumaTopology &topology() {
+  static const NumaTopology topo = read_topology();
+  return topo;
+}
+
+/**
+ * Set the policy of the pages of [addr, addr + bytes) to interleave over
+ * every node of the topology. *addr* must be page aligned.
+ *
+ * @return false if there is only one node or mbind failed
+ */
+bool interleave_pages(void *addr, size_t bytes) {
+#ifdef SYS_mbind
+  const NumaTopology &topo = topology();
+  if (topo.node_ids.size() < 2) {
+    return false;
+  }
+  const size_t BITS = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(topo.node_ids.back() / BITS + 1, 0);
+  for (int id : topo.node_ids) {
+    mask[id / BITS] |= 1ul << (id % BITS);
+  }
+  // the kernel reads one bit fewer than maxnode
+  return syscall(SYS_mbind, addr, bytes, MPOL_INTERLEAVE,
+                 mask.data(), mask.size() * BITS + 1, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+/**
+ * Allocate *count* Ts into *array*, interleaved with NUMA_INTERLEAVE.
+ * The pages are fresh and untouched, so with NUMA_FIRST_TOUCH they are
+ * placed by the first thread to write them.
+ *
+ * @return false if out of memory
+ */
+template <typename T>
+bool alloc_placed(HostArray<T> &array, size_t count, HostAccessHint hint,
+                  NumaPolicy policy, bool &interleaved) {
+  if (!array.allocate(count, hint)) {
+    return false;
+  }
+  if (policy == NUMA_INTERLEAVE) {
+    interleaved = interleave_pages(array.get(), array.mapped_size()) && interleaved;
+  }
+  return true;
+}
+
+/**
+ * Print the share of the pages of [ptr, ptr + bytes) resident on each
+ * node, sampling at most 1024 pages with move_pages
+ */
+void report_pages(const char *name, const void *ptr, size_t bytes) {
+  const NumaTopology &topo = topology();
+  fprintf(stderr, "  %-10s %9.1f MB:", name, bytes / 1048576.0);
+#ifdef SYS_move_pages
+  const size_t MAX_SAMPLES = 1024;
+  size_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t base = (uintptr_t) ptr / page * page;
+  size_t npages = ((uintptr_t) ptr + bytes - base + page - 1) / page;
+  size_t samples = std::min(npages, MAX_SAMPLES);
+  std::vector<void *> pages(samples);
+  std::vector<int> status(samples);
+  for (size_t i = 0; i < samples; ++i) {
+    pages[i] = (void *) (base + (npages * i / samples) * page);
+  }
+  // with no target nodes, move_pages only reports each page's node
+  if (samples > 0 && syscall(SYS_move_pages, 0, samples, pages.data(), NULL, status.data(), 0) == 0) {
+    std::vector<size_t> counts(topo.node_ids.size() + 1, 0);
+    for (int node : status) {
+      auto it = std::find(topo.node_ids.begin(), topo.node_ids.end(), node);
+      // the last count holds pages which aren't resident (or are on other nodes)
+      counts[it - topo.node_ids.begin()]++;
+    }
+    for (size_t n = 0; n < topo.node_ids.size(); ++n) {
+      fprintf(stderr, " node%d %5.1f%%", topo.node_ids[n], 100.0 * counts[n] / samples);
+    }
+    if (counts.back() > 0) {
+      fprintf(stderr, " elsewhere %5.1f%%", 100.0 * counts.back() / samples);
+    }
+    fprintf(stderr, "\n");
+    return;
+  }
+#endif
+  fprintf(stderr, " page locations unavailable\n");
+}
+
+}  // namespace
+
+bool parse_numa_policy(const char *name, NumaPolicy &policy) {
+  if (strcmp(name, "none") == 0) {
+    policy = NUMA_NONE;
+  } else if (strcmp(name, "first-touch") == 0) {
+    policy = NUMA_FIRST_TOUCH;
+  } else if (strcmp(name, "interleave") == 0) {
+    policy = NUMA_INTERLEAVE;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+int numa_thread_cpu(unsigned thread, unsigned num_threads) {
+  const std::vector<int> &cpus = topology().cpu_order;
+  if (cpus.empty()) {
+    return -1;
+  }
+  if (num_threads <= cpus.size()) {
+    return cpus[(size_t) thread * cpus.size() / num_threads];
+  }
+  return cpus[thread % cpus.size()];
+}
+
+bool pin_current_thread(int cpu) {
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void numa_place_pages(void *addr, size_t bytes) {
+  if (NUMA_POLICY == NUMA_INTERLEAVE && addr) {
+    interleave_pages(addr, bytes);
+  }
+}
+
+void numa_place_graph(Host_CSR_Graph &graph, NumaPolicy policy, HostThreadPool &pool) {
+  const NumaTopology &topo = topology();
+  fprintf(stderr, "NUMA NODES: %zu (cpus:", topo.node_ids.size());
+  for (size_t n = 0; n < topo.node_ids.size(); ++n) {
+    fprintf(stderr, " node%d=%zu", topo.node_ids[n], topo.node_cpus[n].size());
+  }
+  fprintf(stderr, ")\n");
+
+  const char *placement = "as loaded";
+  if (policy != NUMA_NONE) {
+    bool interleaved = true;
+    HostArray<index_type> row_start, edge_dst;
+    HostArray<node_data_type> node_data;
+    if (!alloc_placed(row_start, graph.nnodes + 1, HOST_ACCESS_NORMAL, policy, interleaved)
+        || !alloc_placed(edge_dst, graph.nedges, HOST_ACCESS_SEQUENTIAL, policy, interleaved)
+        || !alloc_placed(node_data, graph.nnodes, HOST_ACCESS_RANDOM, policy, interleaved)) {
+      fprintf(stderr, "NUMA placement: out of memory, leaving the graph as loaded\n");
+    } else {
+      // Thread t copies the t-th of pool.size() partitions of the nodes,
+      // along with their out-edges
+      const index_type nnodes = graph.nnodes;
+      const unsigned num_threads = pool.size();
+      pool.for_each_thread([&](unsigned thread) {
+        index_type first = nnodes * thread / num_threads,
+                   last = nnodes * (thread + 1) / num_threads;
+        std::copy(graph.row_start + first, graph.row_start + last + (thread == num_threads - 1),
+                  row_start + first);
+        std::copy(graph.edge_dst + graph.row_start[first], graph.edge_dst + graph.row_start[last],
+                  edge_dst + graph.row_start[first]);
+        std::copy(graph.node_data + first, graph.node_data + last, node_data + first);
+      });
+      graph.row_start = std::move(row_start);
+      graph.edge_dst = std::move(edge_dst);
+      graph.node_data = std::move(node_data);
+
+      if (policy == NUMA_FIRST_TOUCH) {
+        placement = "first-touch by partition";
+      } else if (interleaved) {
+        placement = "interleaved";
+      } else {
+        // e.g. a single node, or mbind is not permitted
+        placement = "first-touch by partition (interleave unavailable)";
+      }
+    }
+  }
+  fprintf(stderr, "NUMA PLACEMENT: %s, %u %s threads\n", placement, pool.size(),
+          PIN_HOST_THREADS ? "pinned" : "unpinned");
+  report_pages("row_start", graph.row_start, (graph.nnodes + 1) * sizeof(index_type));
+  report_pages("edge_dst", graph.edge_dst, graph.nedges * sizeof(index_type));
+  report_pages("node_data", graph.node_data, graph.nnodes * sizeof(node_data_type));
+}
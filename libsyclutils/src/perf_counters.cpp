@@ -0,0 +1,213 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// PerfCounters PerfEvent PerfPhase
+#include "perf_counters.h"
+
+namespace {
+
+const char *EVENT_NAMES[NUM_PERF_EVENTS] = {
+  "cycles", "instructions", "llc_misses", "dtlb_misses"
+};
+
+const char *PHASE_NAMES[NUM_PERF_PHASES] = {
+  "load", "upload", "compute", "output"
+};
+
+// bytes moved from memory per last-level cache miss
+const double CACHE_LINE_BYTES = 64;
+
+#if defined(__linux__) && defined(SYS_perf_event_open)
+struct EventConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+const EventConfig EVENT_CONFIGS[NUM_PERF_EVENTS] = {
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+  // "usually" the last-level cache, as the kernel documents it
+  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+  { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB
+                        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+};
+
+/**
+ * Open a counter of *config* for this process and the threads it starts
+ *
+ * @return the file descriptor, or -1 with errno set
+ */
+int open_event(const EventConfig &config) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = config.type;
+  attr.config = config.config;
+  // (scaled by the time the counter was actually scheduled when the
+  //  hardware counters are multiplexed)
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.inherit = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+}  // namespace
+
+PerfCounters::PerfCounters() {
+  for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+    fds[e] = -1;
+  }
+  reset();
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fds) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+bool PerfCounters::open() {
+  enabled = true;
+  int available = 0;
+  for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+#if defined(__linux__) && defined(SYS_perf_event_open)
+    fds[e] = open_event(EVENT_CONFIGS[e]);
+    if (fds[e] >= 0) {
+      ++available;
+      continue;
+    }
+    const char *hint = (errno == EACCES || errno == EPERM)
+                       ? " (see /proc/sys/kernel/perf_event_paranoid)" : "";
+    fprintf(stderr, "Perf counter %s unavailable: %s%s\n", EVENT_NAMES[e], strerror(errno), hint);
+#endif
+  }
+  if (available == 0) {
+    fprintf(stderr, "No perf counters available; only phase times will be reported\n");
+  }
+  return available > 0;
+}
+
+double PerfCounters::read_count(PerfEvent event) const {
+  // value, time enabled, time running
+  uint64_t values[3];
+  if (fds[event] < 0 || read(fds[event], values, sizeof(values)) != sizeof(values)
+      || values[2] == 0) {
+    return 0;
+  }
+  return values[2] < values[1] ? (double) values[0] * values[1] / values[2]
+                               : (double) values[0];
+}
+
+void PerfCounters::start(PerfPhase) {
+  if (!enabled) {
+    return;
+  }
+  for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+    start_counts[e] = read_count((PerfEvent) e);
+  }
+  start_time = std::chrono::steady_clock::now();
+}
+
+void PerfCounters::stop(PerfPhase phase) {
+  if (!enabled) {
+    return;
+  }
+  auto end_time = std::chrono::steady_clock::now();
+  PhaseTotals &total = totals[phase];
+  for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+    total.counts[e] += read_count((PerfEvent) e) - start_counts[e];
+  }
+  total.seconds += std::chrono::duration<double>(end_time - start_time).count();
+  total.runs++;
+}
+
+void PerfCounters::reset(PerfPhase phase) {
+  memset(&totals[phase], 0, sizeof(PhaseTotals));
+}
+
+void PerfCounters::reset() {
+  for (int p = 0; p < NUM_PERF_PHASES; ++p) {
+    reset((PerfPhase) p);
+  }
+}
+
+void PerfCounters::report_row(FILE *f, const char *name, unsigned runs,
+                              const PhaseTotals &per_run) const {
+  fprintf(f, "  %-8s %5u %12.3f", name, runs, 1e3 * per_run.seconds);
+  for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+    if (fds[e] < 0) {
+      fprintf(f, " %16s", "-");
+    } else {
+      fprintf(f, " %16.0f", per_run.counts[e]);
+    }
+  }
+  if (fds[PERF_CYCLES] < 0 || fds[PERF_INSTRUCTIONS] < 0 || per_run.counts[PERF_CYCLES] == 0) {
+    fprintf(f, " %6s", "-");
+  } else {
+    fprintf(f, " %6.2f", per_run.counts[PERF_INSTRUCTIONS] / per_run.counts[PERF_CYCLES]);
+  }
+  if (fds[PERF_LLC_MISSES] < 0 || per_run.seconds == 0) {
+    fprintf(f, " %9s\n", "-");
+  } else {
+    fprintf(f, " %9.3f\n", per_run.counts[PERF_LLC_MISSES] * CACHE_LINE_BYTES / per_run.seconds / 1e9);
+  }
+}
+
+void PerfCounters::report(FILE *f) const {
+  if (!enabled) {
+    return;
+  }
+  fprintf(f, "PERF COUNTERS (per run, user space):\n");
+  fprintf(f, "  %-8s %5s %12s", "phase", "runs", "time_ms");
+  for (const char *name : EVENT_NAMES) {
+    fprintf(f, " %16s", name);
+  }
+  fprintf(f, " %6s %9s\n", "IPC", "est_GB/s");
+  // the sum of one run of each phase
+  PhaseTotals run = {};
+  for (int p = 0; p < NUM_PERF_PHASES; ++p) {
+    const PhaseTotals &total = totals[p];
+    if (total.runs == 0) {
+      continue;
+    }
+    PhaseTotals per_run = {};
+    for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+      per_run.counts[e] = total.counts[e] / total.runs;
+      run.counts[e] += per_run.counts[e];
+    }
+    per_run.seconds = total.seconds / total.runs;
+    run.seconds += per_run.seconds;
+    report_row(f, PHASE_NAMES[p], total.runs, per_run);
+  }
+  report_row(f, "run", 1, run);
+}
+
+void PerfCounters::print_lines(FILE *f) const {
+  if (!enabled) {
+    return;
+  }
+  for (int p = 0; p < NUM_PERF_PHASES; ++p) {
+    const PhaseTotals &total = totals[p];
+    if (total.runs == 0) {
+      continue;
+    }
+    fprintf(f, "PERF phase=%s runs=%u time_ms=%.6f", PHASE_NAMES[p], total.runs, 1e3 * total.seconds);
+    for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+      if (fds[e] >= 0) {
+        fprintf(f, " %s=%.0f", EVENT_NAMES[e], total.counts[e]);
+      }
+    }
+    fprintf(f, "\n");
+  }
+}
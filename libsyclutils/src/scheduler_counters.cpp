@@ -0,0 +1,43 @@
+#include <cstdio>
+
+// SchedulerCounter SCHEDULER_COUNTER_WORDS
+#include "scheduler_counters.h"
+
+/**
+ * Join the (low, high) words of *counter*
+ */
+static uint64_t scheduler_count(const uint32_t *words, SchedulerCounter counter) {
+  return ((uint64_t) words[2 * counter + 1] << 32) | words[2 * counter];
+}
+
+/**
+ * @return 100 * part / whole, or 0 if whole is 0
+ */
+static double percent(uint64_t part, uint64_t whole) {
+  return whole ? 100.0 * part / whole : 0.0;
+}
+
+void report_scheduler_counters(const uint32_t *words) {
+  static const char *METHOD_NAMES[] = { "group", "warp", "fine-grained" };
+  static const SchedulerCounter EDGES[] = { SCHED_GROUP_EDGES, SCHED_WARP_EDGES,
+                                            SCHED_FINE_GRAINED_EDGES },
+                                ROUNDS[] = { SCHED_GROUP_ROUNDS, SCHED_WARP_ROUNDS,
+                                             SCHED_FINE_GRAINED_ROUNDS };
+  uint64_t total_edges = 0;
+  for (SchedulerCounter counter : EDGES) {
+    total_edges += scheduler_count(words, counter);
+  }
+  uint64_t idle_calls = scheduler_count(words, SCHED_IDLE_CALLS);
+
+  fprintf(stderr, "SCHEDULER COUNTERS:\n");
+  fprintf(stderr, "  %-12s %14s %7s %12s %14s\n", "method", "edges", "share", "rounds", "edges/round");
+  for (int m = 0; m < 3; ++m) {
+    uint64_t edges = scheduler_count(words, EDGES[m]),
+             rounds = scheduler_count(words, ROUNDS[m]);
+    fprintf(stderr, "  %-12s %14lu %6.2f%% %12lu %14.2f\n", METHOD_NAMES[m],
+            (unsigned long) edges, percent(edges, total_edges), (unsigned long) rounds,
+            rounds ? (double) edges / rounds : 0.0);
+  }
+  fprintf(stderr, "  idle calls: %lu (%.2f%% of applyPushOperator calls)\n",
+          (unsigned long) idle_calls, percent(idle_calls, total_edges + idle_calls));
+}
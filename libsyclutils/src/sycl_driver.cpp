@@ -10,19 +10,50 @@
  *  - sycl_main
  *  - output
  *
+ *  - plan_device_memory  (describe the device buffers sycl_main allocates)
+ *
  *  And may implement
  *  - process_prog_opt  (process options e.g. foo -a <arg>)
  *  - process_prog_arg  (process non-option arguments e.g. foo <arg>)
+ *  - host_main         (run on host threads instead of a SYCL device, with -H)
+ *  - prepare_graph     (build anything derived from the graph, such as its
+ *                       transpose, once it is loaded and before any timing)
+ *  - verify_output     (check the result against a host reference, with -V)
  *
  *  Look at the bfs/ directory for examples of how to implement these
+ *
+ *  With -B, sycl_main (or host_main) is called several times in one
+ *  process, so applications must reset any global state they keep
+ *  between calls. Each call gets a freshly copied SYCL_CSR_Graph.
 */ 
+#include <algorithm>
 #include <chrono>
+#include <cinttypes>
+#include <climits>
+#include <string>
 #include <unistd.h>
+#include <vector>
 
 // libsyclutils/include
 //
+// summarize_samples SAMPLE_CONFIDENCE
+#include "bench_stats.h"
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// HOST_PAGE_MODE parse_host_page_mode host_huge_page_bytes
+#include "host_array.h"
 // Host_CSR_Graph
 #include "host_csr_graph.h"
+// ITERATION_STATS_FILE RECORD_ITERATION_STATS
+#include "iteration_record.h"
+// generate_kronecker_edges KRONECKER_EDGE_FACTOR
+#include "kronecker_generator.h"
+// NumaPolicy NUMA_POLICY numa_place_graph PIN_HOST_THREADS
+#include "numa_placement.h"
+// PerfCounters PerfPhase
+#include "perf_counters.h"
+// report_scheduler_counters
+#include "scheduler_counters.h"
 // SYCL_CSR_Graph
 #include "sycl_csr_graph.h"
 // NVIDIA_Selector
@@ -31,12 +62,42 @@
 // Application-implemented functions
 extern int sycl_main(SYCL_CSR_Graph&, cl::sycl::queue&);
 extern void output(Host_CSR_Graph&, const char *output_file);
+extern void plan_device_memory(DeviceMemoryPlan&, const Host_CSR_Graph&, size_t num_work_groups);
+// Optional: applications without a host backend leave this undefined
+extern int host_main(Host_CSR_Graph&) __attribute__((weak));
+// Optional: returns nonzero if the result in the graph is wrong
+extern int verify_output(Host_CSR_Graph&) __attribute__((weak));
+// Optional: returns nonzero if what it builds from the graph can't be built
+extern int prepare_graph(const Host_CSR_Graph&) __attribute__((weak));
 
 int QUIET = 0;
 char *INPUT, *OUTPUT;
+// argv[0], to name the application in -B reports
+const char *PROGRAM_NAME = "";
 
 int CUDA_DEVICE = -1;
 size_t num_work_groups = 4;
+// With -B, each of the -b values in turn is run BENCH_WARMUPS times
+// untimed and then BENCH_REPETITIONS times timed, in a single process
+unsigned BENCH_REPETITIONS = 0;
+unsigned BENCH_WARMUPS = 1;
+std::vector<size_t> WORK_GROUP_COUNTS;
+// If positive, generate a Graph500 Kronecker graph with
+// 2^KRONECKER_SCALE nodes instead of reading a graph file
+unsigned KRONECKER_SCALE = 0;
+const uint64_t KRONECKER_SEED = 1;
+// If set, run host_main on host threads instead of using a SYCL device
+int HOST_BACKEND = 0;
+// number of host threads for host_main (0 means one per hardware thread)
+unsigned num_host_threads = 0;
+// If set, check the result with verify_output before writing it
+int VERIFY = 0;
+// With -N, place the host graph by NUMA_POLICY (and pin host threads
+// unless it is none)
+int NUMA_AWARE = 0;
+// With -P, count hardware events in each phase of the run
+int PERF_EVENTS = 0;
+PerfCounters PERF_COUNTERS;
 
 //mgpu::ContextPtr mgc;
 
@@ -47,15 +108,294 @@ extern int process_prog_opt(char optchar, char *optarg);
 extern int process_prog_arg(int argc, char *argv[], int arg_start);
 
 
-int load_graph_and_run_kernel(char *graph_file, cl::sycl::device_selector &dev_sel) {
-     // read in graph
-     Host_CSR_Graph host_graph;
-     host_graph.readFromGR(graph_file);
+/**
+ * Read *graph_file* (or generate a Kronecker graph with -K) into *host_graph*,
+ * then let the application prepare_graph it
+ */
+void load_graph(Host_CSR_Graph &host_graph, char *graph_file) {
+     PERF_COUNTERS.start(PERF_LOAD);
+     if(KRONECKER_SCALE > 0) {
+         std::vector<index_type> edge_src, edge_dst;
+         generate_kronecker_edges(KRONECKER_SCALE, KRONECKER_EDGE_FACTOR, KRONECKER_SEED,
+                                  edge_src, edge_dst);
+         if(host_graph.buildUndirected(((index_type) 1) << KRONECKER_SCALE, edge_src.size(),
+                                       edge_src.data(), edge_dst.data())) {
+             std::exit(1);
+         }
+     }
+     else if(host_graph.readFromGR(graph_file)) {
+         fprintf(stderr, "Cannot load graph %s\n", graph_file);
+         std::exit(EXIT_FAILURE);
+     }
      // Make sure the graph doesn't have more than 32 bits of nodes
      if(host_graph.nnodes >= std::numeric_limits<uint32_t>::max()) {
          printf("SYCL targeting ptx (NVIDIA) does not support 64-bit atomics. num nodes must be < uint32_max");
          std::exit(1);
      }
+     if(NUMA_AWARE) {
+         HostThreadPool pool(num_host_threads);
+         numa_place_graph(host_graph, NUMA_POLICY, pool);
+     }
+     // once per graph, so that no run (or -B repetition) pays for it
+     if(prepare_graph && prepare_graph(host_graph)) {
+         fprintf(stderr, "Cannot prepare graph %s\n", graph_file ? graph_file : "(Kronecker)");
+         std::exit(EXIT_FAILURE);
+     }
+     long long huge_bytes = host_huge_page_bytes();
+     if(huge_bytes >= 0) {
+         fprintf(stderr, "Host memory in huge pages: %lld MB\n", huge_bytes / 1048576);
+     }
+     PERF_COUNTERS.stop(PERF_LOAD);
+}
+
+/**
+ * With -V, check the application's result against its host reference
+ *
+ * @param r the application's return value
+ * @return *r*, or 1 if verification failed
+ */
+int verify_result(Host_CSR_Graph &host_graph, int r) {
+    if(!VERIFY) {
+        return r;
+    }
+    if(!verify_output) {
+        fprintf(stderr, "No host reference to verify against\n");
+        return r;
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    int failed = verify_output(host_graph);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double time_in_ms = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+    fprintf(stderr, "Verification %s (%" PRIu64 " ms)\n", failed ? "FAILED" : "passed", (uint64_t) time_in_ms);
+    return failed ? 1 : r;
+}
+
+/**
+ * Print the -B summary of *samples_ms* to stderr, and a line for
+ * bench/bench-suite to parse to stdout:
+ *
+ *   BENCH app=<name> backend=<device|host> device=<name> work_groups=<n>
+ *         edges=<n> warmups=<n> reps=<n> samples_ms=<t1>,<t2>,...
+ *         [upload_ms=<t1>,<t2>,...]
+ *
+ * Spaces in the device name are replaced by underscores. On the host
+ * backend, work_groups is the -T thread count (0 for one per hardware
+ * thread), and there are no upload times.
+ *
+ * @param upload_samples_ms the time each run took to copy the graph onto
+ *                          the device (empty on the host backend)
+ */
+void report_bench(const char *backend, std::string device, size_t work_groups, size_t edges,
+                  const std::vector<double> &samples_ms,
+                  const std::vector<double> &upload_samples_ms) {
+    SampleSummary summary = summarize_samples(samples_ms);
+    fprintf(stderr, "Benchmark (%zu work-groups, %zu runs): median %.3f ms "
+                    "(%.0f%% CI %.3f - %.3f), MAD %.3f ms, min %.3f ms, max %.3f ms\n",
+            work_groups, summary.count, summary.median, 100 * SAMPLE_CONFIDENCE,
+            summary.ci_low, summary.ci_high, summary.mad, summary.min, summary.max);
+
+    std::replace(device.begin(), device.end(), ' ', '_');
+    const char *app = strrchr(PROGRAM_NAME, '/') ? strrchr(PROGRAM_NAME, '/') + 1 : PROGRAM_NAME;
+    printf("BENCH app=%s backend=%s device=%s work_groups=%zu edges=%zu warmups=%u reps=%u samples_ms=",
+           app, backend, device.c_str(), work_groups, edges, BENCH_WARMUPS, BENCH_REPETITIONS);
+    for(size_t i = 0; i < samples_ms.size(); ++i) {
+        printf("%s%.6f", i ? "," : "", samples_ms[i]);
+    }
+    for(size_t i = 0; i < upload_samples_ms.size(); ++i) {
+        printf("%s%.6f", i ? "," : " upload_ms=", upload_samples_ms[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * With -P, print the hardware counters of each phase since the last
+ * report to stderr (and, with -B, PERF lines for bench/bench-suite to
+ * stdout, after the BENCH line they belong to), then start over
+ */
+void report_perf() {
+    if(!PERF_EVENTS) {
+        return;
+    }
+    PERF_COUNTERS.report(stderr);
+    if(BENCH_REPETITIONS > 0) {
+        PERF_COUNTERS.print_lines(stdout);
+        fflush(stdout);
+    }
+    PERF_COUNTERS.reset();
+}
+
+/**
+ * Load the graph and run host_main on it
+ * (repeatedly with -B)
+ */
+int load_graph_and_run_host(char *graph_file) {
+    Host_CSR_Graph host_graph;
+    load_graph(host_graph, graph_file);
+    fprintf(stderr, "Running on host threads\n");
+
+    int r = 0;
+    std::vector<double> samples_ms;
+    unsigned runs = BENCH_REPETITIONS > 0 ? BENCH_WARMUPS + BENCH_REPETITIONS : 1;
+    for(unsigned run = 0; run < runs; ++run) {
+        // only count the timed runs
+        if(BENCH_REPETITIONS > 0 && run == BENCH_WARMUPS) {
+            PERF_COUNTERS.reset(PERF_COMPUTE);
+        }
+        PERF_COUNTERS.start(PERF_COMPUTE);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        int run_r = host_main(host_graph);
+        auto endTime = std::chrono::high_resolution_clock::now();
+        PERF_COUNTERS.stop(PERF_COMPUTE);
+        double time_in_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+
+        if(BENCH_REPETITIONS == 0) {
+            // Report time
+            double time_in_ms = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+            fprintf(stderr, "Total time: %" PRIu64 " ms\n", (uint64_t) time_in_ms);
+            fprintf(stderr, "Total time: %" PRIu64 " ns\n", (uint64_t) time_in_ns);
+            r = verify_result(host_graph, run_r);
+        }
+        else if(run >= BENCH_WARMUPS) {
+            samples_ms.push_back(time_in_ns / 1e6);
+            // the result is the same every run, so check it once
+            if(run == BENCH_WARMUPS) {
+                r = verify_result(host_graph, run_r);
+            }
+        }
+    }
+
+    if(BENCH_REPETITIONS > 0) {
+        report_bench("host", "host threads", num_host_threads, host_graph.nedges, samples_ms, {});
+    }
+    else if(!QUIET) {
+        PERF_COUNTERS.start(PERF_OUTPUT);
+        output(host_graph, OUTPUT);
+        PERF_COUNTERS.stop(PERF_OUTPUT);
+    }
+    report_perf();
+
+    return r;
+}
+
+/**
+ * The -I file of the configuration with *work_groups* work-groups: with
+ * several work-group counts each gets its own file, so stats.json becomes
+ * stats-wg<n>.json (a table on stderr, "-", is shared)
+ */
+std::string iteration_stats_file(const std::string &file, size_t work_groups) {
+    if(WORK_GROUP_COUNTS.size() <= 1 || file == "-") {
+        return file;
+    }
+    size_t slash = file.rfind('/'),
+           dot = file.rfind('.');
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        dot = file.size();
+    }
+    return file.substr(0, dot) + "-wg" + std::to_string(work_groups) + file.substr(dot);
+}
+
+/**
+ * Find the number of work-groups (at most *requested*) whose device
+ * buffers fit on the device. The per-group structures are the only ones
+ * we can shrink, so halve the number of work-groups until everything fits.
+ */
+size_t plan_work_groups(const Host_CSR_Graph &host_graph, cl::sycl::queue &queue, size_t requested) {
+    size_t global_mem_size = queue.get_device().get_info<cl::sycl::info::device::global_mem_size>(),
+           max_mem_alloc_size = queue.get_device().get_info<cl::sycl::info::device::max_mem_alloc_size>();
+    size_t work_groups = requested;
+    DeviceMemoryPlan plan;
+    while(true) {
+        plan.clear();
+        plan.add("graph row_start", (host_graph.nnodes + 1) * sizeof(index_type));
+        plan.add("graph edge_dst", host_graph.nedges * sizeof(index_type));
+        plan.add("graph node_data", host_graph.nnodes * sizeof(node_data_type));
+        plan_device_memory(plan, host_graph, work_groups);
+        if(plan.fits(global_mem_size, max_mem_alloc_size)) {
+            break;
+        }
+        if(work_groups <= 1) {
+            fprintf(stderr, "Not enough device memory to run on this graph.\n");
+            plan.print(stderr, global_mem_size, max_mem_alloc_size);
+            std::exit(1);
+        }
+        work_groups /= 2;
+        fprintf(stderr, "Device memory exceeded, reducing number of work-groups to %zu\n",
+                work_groups);
+    }
+    plan.print(stderr, global_mem_size, max_mem_alloc_size);
+    return work_groups;
+}
+
+/**
+ * Copy *host_graph* onto the device and run sycl_main on it once.
+ * The device graph is destroyed before returning, which writes its
+ * node data back into *host_graph*.
+ *
+ * @param r set to the return value of sycl_main
+ * @param upload_ns set to the time the graph took to copy, in nanoseconds
+ * @return the time sycl_main took, in nanoseconds
+ */
+double run_kernel(Host_CSR_Graph &host_graph, cl::sycl::queue &queue, int &r, double &upload_ns) {
+    PERF_COUNTERS.start(PERF_UPLOAD);
+    auto uploadStartTime = std::chrono::high_resolution_clock::now();
+    // Create SYCL graph
+    SYCL_CSR_Graph sycl_graph(&host_graph);
+
+    // Explicitly copy graph onto device
+    try{
+        queue.submit([&] (cl::sycl::handler &cgh) {
+            auto row_start_host = sycl_graph.row_start.get_access<
+                                    cl::sycl::access::mode::read>(cgh);
+            auto row_start_dev = sycl_graph.row_start.get_access<
+                                    cl::sycl::access::mode::read_write,
+                                    cl::sycl::access::target::global_buffer>(cgh);
+            cgh.copy(row_start_host, row_start_dev);
+        });
+        queue.submit([&] (cl::sycl::handler &cgh) {
+            auto edge_dst_host = sycl_graph.edge_dst.get_access<
+                                    cl::sycl::access::mode::read>(cgh);
+            auto edge_dst_dev = sycl_graph.edge_dst.get_access<
+                                    cl::sycl::access::mode::read_write,
+                                    cl::sycl::access::target::global_buffer>(cgh);
+            cgh.copy(edge_dst_host, edge_dst_dev);
+        });
+    } catch(cl::sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+        std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+    // wait for copy to finish, throwing asynchronous exception to
+    // handler if one is found
+    queue.wait_and_throw();
+    auto uploadEndTime = std::chrono::high_resolution_clock::now();
+    PERF_COUNTERS.stop(PERF_UPLOAD);
+    upload_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(uploadEndTime - uploadStartTime).count();
+    if(BENCH_REPETITIONS == 0) {
+        std::cerr << "Graph copied onto device" << std::endl;
+    }
+
+    // Run application
+    PERF_COUNTERS.start(PERF_COMPUTE);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    r = sycl_main(sycl_graph, queue);
+    auto endTime = std::chrono::high_resolution_clock::now();
+    PERF_COUNTERS.stop(PERF_COMPUTE);
+#ifdef SCHEDULER_COUNTERS
+    {
+        auto words = sycl_graph.scheduler_counters.get_access<cl::sycl::access::mode::read>();
+        report_scheduler_counters(words.get_pointer());
+    }
+#endif
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+}
+
+int load_graph_and_run_kernel(char *graph_file, cl::sycl::device_selector &dev_sel) {
+     // read in (or generate) graph
+     Host_CSR_Graph host_graph;
+     load_graph(host_graph, graph_file);
    
      // Build an exception handler for the command queue as in
      // https://developer.codeplay.com/products/computecpp/ce/guides/sycl-guide/error-handling
@@ -72,67 +412,80 @@ int load_graph_and_run_kernel(char *graph_file, cl::sycl::device_selector &dev_s
             }
         }
     };
-// Begin SYCL scope
     // return value declared outside of SYCL scope
-    int r;
+    int r = 0;
     // Begin SYCL scope
     {
         // Build command queue with profiling enabled and report the device
         cl::sycl::property::queue::enable_profiling enab_prof;
         cl::sycl::property_list prop_list(enab_prof);
         cl::sycl::queue queue(dev_sel, exception_handler, prop_list);
-        fprintf(stderr, "Running on %s\n",
-                queue.get_device().get_info<cl::sycl::info::device::name>().c_str());
-
-
-        // Create SYCL graph
-        SYCL_CSR_Graph sycl_graph(&host_graph);
-
-        // Explicitly copy graph onto device
-        try{
-            queue.submit([&] (cl::sycl::handler &cgh) {
-                auto row_start_host = sycl_graph.row_start.get_access<
-                                        cl::sycl::access::mode::read>(cgh);
-                auto row_start_dev = sycl_graph.row_start.get_access<
-                                        cl::sycl::access::mode::read_write,
-                                        cl::sycl::access::target::global_buffer>(cgh);
-                cgh.copy(row_start_host, row_start_dev);
-            });
-            queue.submit([&] (cl::sycl::handler &cgh) {
-                auto edge_dst_host = sycl_graph.edge_dst.get_access<
-                                        cl::sycl::access::mode::read>(cgh);
-                auto edge_dst_dev = sycl_graph.edge_dst.get_access<
-                                        cl::sycl::access::mode::read_write,
-                                        cl::sycl::access::target::global_buffer>(cgh);
-                cgh.copy(edge_dst_host, edge_dst_dev);
-            });
-        } catch(cl::sycl::exception const& e) {
-            std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
-            if(e.get_cl_code() != CL_SUCCESS) {
-            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        std::string device_name = queue.get_device().get_info<cl::sycl::info::device::name>();
+        fprintf(stderr, "Running on %s\n", device_name.c_str());
+
+        if(BENCH_REPETITIONS == 0) {
+            // Plan device memory before allocating anything
+            num_work_groups = plan_work_groups(host_graph, queue, num_work_groups);
+            double upload_ns;
+            double time_in_ns = run_kernel(host_graph, queue, r, upload_ns);
+
+            // Report time
+            fprintf(stderr, "Total time: %" PRIu64 " ms\n", (uint64_t) (time_in_ns / 1e6));
+            fprintf(stderr, "Total time: %" PRIu64 " ns\n", (uint64_t) time_in_ns);
+        }
+        else {
+            // The graph stays loaded (and the queue built) across every
+            // configuration; only the device copy is redone for each run
+            const char *stats_file = ITERATION_STATS_FILE;
+            std::string config_stats_file;
+            for(size_t requested : WORK_GROUP_COUNTS) {
+                num_work_groups = plan_work_groups(host_graph, queue, requested);
+                if(stats_file) {
+                    config_stats_file = iteration_stats_file(stats_file, num_work_groups);
+                    ITERATION_STATS_FILE = config_stats_file.c_str();
+                }
+                std::vector<double> samples_ms, upload_samples_ms;
+                for(unsigned run = 0; run < BENCH_WARMUPS + BENCH_REPETITIONS; ++run) {
+                    // only count the timed runs
+                    if(run == BENCH_WARMUPS) {
+                        PERF_COUNTERS.reset(PERF_UPLOAD);
+                        PERF_COUNTERS.reset(PERF_COMPUTE);
+                    }
+                    // -I records the run which is checked, once per configuration
+                    RECORD_ITERATION_STATS = run == BENCH_WARMUPS;
+                    int run_r;
+                    double upload_ns;
+                    double time_in_ns = run_kernel(host_graph, queue, run_r, upload_ns);
+                    if(run < BENCH_WARMUPS) {
+                        continue;
+                    }
+                    samples_ms.push_back(time_in_ns / 1e6);
+                    upload_samples_ms.push_back(upload_ns / 1e6);
+                    // the result is the same every run, so check it once
+                    // per configuration
+                    if(run == BENCH_WARMUPS && verify_result(host_graph, run_r) != 0) {
+                        r = 1;
+                    }
+                }
+                report_bench("device", device_name, num_work_groups, host_graph.nedges,
+                             samples_ms, upload_samples_ms);
+                report_perf();
             }
-            std::exit(1);
+            ITERATION_STATS_FILE = stats_file;
+            RECORD_ITERATION_STATS = true;
         }
-        // wait for copy to finish, throwing asynchronous exception to
-        // handler if one is found
-        queue.wait_and_throw();
-        std::cerr << "Graph copied onto device" << std::endl;
- 
-        // Run application
-        auto startTime = std::chrono::high_resolution_clock::now();
-        r = sycl_main(sycl_graph, queue);
-        auto endTime = std::chrono::high_resolution_clock::now();
- 
-        // Report time
-        double time_in_ms = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-        double time_in_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
-        fprintf(stderr, "Total time: %u ms\n", (uint64_t) time_in_ms);
-        fprintf(stderr, "Total time: %u ns\n", (uint64_t) time_in_ns);
     } // end sycl scope
   
    // Finish
-   if(!QUIET)
-     output(host_graph, OUTPUT);
+   if(BENCH_REPETITIONS == 0) {
+     r = verify_result(host_graph, r);
+     if(!QUIET) {
+       PERF_COUNTERS.start(PERF_OUTPUT);
+       output(host_graph, OUTPUT);
+       PERF_COUNTERS.stop(PERF_OUTPUT);
+     }
+     report_perf();
+   }
  
    return r;
 }
@@ -140,15 +493,15 @@ int load_graph_and_run_kernel(char *graph_file, cl::sycl::device_selector &dev_s
 void usage(int argc, char *argv[]) 
 {
   if(strlen(prog_usage)) 
-    fprintf(stderr, "usage: %s [-q quiet] [-g gpunum] [-b numblocks] [-o output-file] %s graph-file \n %s\n", argv[0], prog_usage, prog_args_usage);
+    fprintf(stderr, "usage: %s [-q quiet] [-g gpunum] [-b numblocks[,numblocks...]] [-B reps[:warmups]] [-H [-T numthreads]] [-N numa-policy] [-M page-mode] [-V verify] [-I stats-file] [-P] [-o output-file] %s (graph-file | -K scale) \n %s\n", argv[0], prog_usage, prog_args_usage);
   else
-    fprintf(stderr, "usage: %s [-q quiet] [-g gpunum] [-b numblocks] [-o output-file] graph-file %s\n", argv[0], prog_args_usage);
+    fprintf(stderr, "usage: %s [-q quiet] [-g gpunum] [-b numblocks[,numblocks...]] [-B reps[:warmups]] [-H [-T numthreads]] [-N numa-policy] [-M page-mode] [-V verify] [-I stats-file] [-P] [-o output-file] (graph-file | -K scale) %s\n", argv[0], prog_args_usage);
 }
 
 void parse_args(int argc, char *argv[]) 
 {
   int c;
-  const char *skel_opts = "g:qo:b:";
+  const char *skel_opts = "g:qo:b:B:K:HT:VN:M:I:P";
   char *opts;
   int len = 0;
   
@@ -175,11 +528,89 @@ void parse_args(int argc, char *argv[])
         }
         break;
       case 'b':
-        char *wg_end;
+        {
+          // a comma-separated list, each run in turn with -B
+          char *wg_start = optarg, *wg_end;
+          WORK_GROUP_COUNTS.clear();
+          while(true) {
+            errno = 0;
+            long count = strtol(wg_start, &wg_end, 10);
+            if(errno != 0 || wg_end == wg_start || (*wg_end != '\0' && *wg_end != ',') || count <= 0) {
+              fprintf(stderr, "Invalid number of work-groups '%s'. A comma-separated list of positive integers must be specified.\n", optarg);
+              exit(EXIT_FAILURE);
+            }
+            WORK_GROUP_COUNTS.push_back((size_t) count);
+            if(*wg_end == '\0') {
+              break;
+            }
+            wg_start = wg_end + 1;
+          }
+          num_work_groups = WORK_GROUP_COUNTS.front();
+        }
+        break;
+      case 'B':
+        {
+          char *reps_end, *warmups_start = nullptr;
+          errno = 0;
+          long reps = strtol(optarg, &reps_end, 10), warmups = BENCH_WARMUPS;
+          if(errno == 0 && reps_end != optarg && *reps_end == ':') {
+            warmups_start = reps_end + 1;
+            warmups = strtol(warmups_start, &reps_end, 10);
+          }
+          if(errno != 0 || reps_end == optarg || reps_end == warmups_start || *reps_end != '\0'
+             || reps <= 0 || reps > UINT_MAX || warmups < 0 || warmups > UINT_MAX) {
+            fprintf(stderr, "Invalid benchmark repetitions '%s'. A positive integer, optionally followed by :warmups (a non-negative integer), must be specified.\n", optarg);
+            exit(EXIT_FAILURE);
+          }
+          BENCH_REPETITIONS = reps;
+          BENCH_WARMUPS = warmups;
+        }
+        break;
+      case 'K':
+        char *scale_end;
         errno = 0;
-        num_work_groups = strtol(optarg, &wg_end, 10);
-        if(errno != 0 || *wg_end != '\0') {
-          fprintf(stderr, "Invalid number of work-groups '%s'. An integer must be specified.\n", optarg);
+        KRONECKER_SCALE = strtol(optarg, &scale_end, 10);
+        if(errno != 0 || *scale_end != '\0' || KRONECKER_SCALE == 0 || KRONECKER_SCALE >= 32) {
+          fprintf(stderr, "Invalid Kronecker scale '%s'. An integer in [1, 32) must be specified.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        break;
+      case 'H':
+        HOST_BACKEND = 1;
+        break;
+      case 'T':
+        {
+          char *threads_end;
+          errno = 0;
+          long threads = strtol(optarg, &threads_end, 10);
+          if(errno != 0 || threads_end == optarg || *threads_end != '\0' || threads < 0 || threads > UINT_MAX) {
+            fprintf(stderr, "Invalid number of host threads '%s'. A non-negative integer (0 for one per hardware thread) must be specified.\n", optarg);
+            exit(EXIT_FAILURE);
+          }
+          num_host_threads = threads;
+        }
+        break;
+      case 'V':
+        VERIFY = 1;
+        break;
+      case 'I':
+        ITERATION_STATS_FILE = optarg;
+        break;
+      case 'P':
+        PERF_EVENTS = 1;
+        break;
+      case 'N':
+        if(!parse_numa_policy(optarg, NUMA_POLICY)) {
+          fprintf(stderr, "Invalid NUMA policy '%s'. One of none, first-touch or interleave must be specified.\n", optarg);
+          exit(EXIT_FAILURE);
+        }
+        NUMA_AWARE = 1;
+        // placement only lasts if the threads stay on their nodes
+        PIN_HOST_THREADS = NUMA_POLICY != NUMA_NONE;
+        break;
+      case 'M':
+        if(!parse_host_page_mode(optarg, HOST_PAGE_MODE)) {
+          fprintf(stderr, "Invalid page mode '%s'. One of small, transparent or explicit must be specified.\n", optarg);
           exit(EXIT_FAILURE);
         }
         break;
@@ -192,7 +623,26 @@ void parse_args(int argc, char *argv[])
     }
   }
 
-  if(optind < argc) {
+  if(WORK_GROUP_COUNTS.empty()) {
+    WORK_GROUP_COUNTS.push_back(num_work_groups);
+  }
+  else if(WORK_GROUP_COUNTS.size() > 1 && BENCH_REPETITIONS == 0) {
+    fprintf(stderr, "Several numbers of work-groups can only be run with -B.\n");
+    exit(EXIT_FAILURE);
+  }
+  else if(WORK_GROUP_COUNTS.size() > 1 && HOST_BACKEND) {
+    fprintf(stderr, "The host backend runs on -T threads, not work-groups; give -b one number with -H.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  if(KRONECKER_SCALE > 0) {
+    // no graph file to read
+    if(!process_prog_arg(argc, argv, optind)) {
+      usage(argc, argv);
+      exit(EXIT_FAILURE);
+    }
+  }
+  else if(optind < argc) {
     INPUT = argv[optind];
     if(!process_prog_arg(argc, argv, optind + 1)) {
       usage(argc, argv);
@@ -216,10 +666,22 @@ int main(int argc, char *argv[]) {
     exit(1);
   }
 
+  PROGRAM_NAME = argv[0];
   parse_args(argc, argv);
+  // before any host or runtime threads are started, so they are counted too
+  if( PERF_EVENTS ) {
+      PERF_COUNTERS.open();
+  }
   
   int r;
-  if( CUDA_DEVICE < 0 ) {
+  if( HOST_BACKEND ) {
+      if( !host_main ) {
+          fprintf(stderr, "%s has no host backend\n", argv[0]);
+          exit(EXIT_FAILURE);
+      }
+      r = load_graph_and_run_host(INPUT);
+  }
+  else if( CUDA_DEVICE < 0 ) {
       cl::sycl::default_selector dev_selector;
       r = load_graph_and_run_kernel(INPUT, dev_selector);
   }
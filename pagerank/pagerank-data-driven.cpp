@@ -1,7 +1,14 @@
+#include <atomic>
 #include <climits>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
 #include <CL/sycl.hpp>
 
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
 // SYCL_CSR_Graph node_data_type index_type
 #include "sycl_csr_graph.h"
 // Pipe
@@ -10,11 +17,23 @@
 #include "out_worklist.h"
 // InWorklist
 #include "in_worklist.h"
+// BitmapFrontier InBitmap OutBitmap use_dense_frontier
+#include "bitmap_frontier.h"
+// float_bits_t atomic_add_float bits_to_float float_to_bits GroupUpdateCombiner
+#include "float_atomics.h"
 // PushScheduler
 #include "push_scheduler.h"
+// P_CURR alloc_ranks host_top_ranks device_top_ranks
+#include "top_ranks.h"
+// HostPushScheduler HostOutWorklist HostThreadPool HOST_CHUNK_SIZE host_atomic_add_float
+#include "host_push_scheduler.h"
+// IterationStats IterationCounters
+#include "iteration_stats.h"
 
 extern const float ALPHA = 0.85;
 extern const float EPSILON = 0.000001;
+// -w and -d are accepted (see warm_start)
+extern const bool SUPPORTS_WARM_START = true;
 extern int MAX_ITERATIONS ;
 int iterations = 0 ;
 
@@ -25,57 +44,77 @@ class init;
 class prob_update;
 class InitOnOutWL;
 class HardReset;
+class WarmStartIncoming;
+class WarmStartWorklist;
+
+// from support.cpp
+extern bool WARM_START, HAVE_EDGE_DELTA;
+extern std::vector<std::pair<index_type, float> > PREV_RANKS;
+extern std::vector<std::pair<index_type, index_type> > EDGE_DELTA;
 
 extern size_t num_work_groups;
+extern unsigned num_host_threads;
+extern int QUIET;
 
 struct PROperatorInfo {
+    // true iff the frontier is stored in bitmaps instead of worklists
+    bool dense;
     // global accessors
-    sycl::accessor<float, 2,
-                   sycl::access::mode::read_write,
+    sycl::accessor<float_bits_t, 1,
+                   sycl::access::mode::atomic,
                    sycl::access::target::global_buffer>
-                       // residuals (separated by group) (NNODES, NUM_WORK_GROUP)
-                       //   my group's portion of next residual goes in [node][group_nr]
-                       residuals_by_group;
+                       // next residual of each node
+                       //   (stored as bits so that it can be updated atomically)
+                       residuals;
     sycl::accessor<float, 1,
                    sycl::access::mode::read,
                    sycl::access::target::global_buffer>
                        // update coming out of this node
                        outgoing_update;
-    sycl::accessor<size_t, 1,
-                   sycl::access::mode::read_write,
-                   sycl::access::target::global_buffer>
-                       mutex;
     sycl::accessor<bool, 1,
                    sycl::access::mode::read_write,
                    sycl::access::target::global_buffer>
                        on_out_wl;
-    // local memory
-    sycl::accessor<bool, 1,
-                   sycl::access::mode::read_write,
-                   sycl::access::target::local>
-                       bids_made;
+    // dense frontiers
+    InBitmap in_bitmap;
+    OutBitmap out_bitmap;
+    // local memory: combines my group's updates to the same node
+    GroupUpdateCombiner combiner;
+    // per-iteration statistics (when -I is given)
+    IterationCounters counters;
     /** Called at start of push scheduling */
-    void initialize(const sycl::nd_item<1> &my_item) { }
+    void initialize(const sycl::nd_item<1> &my_item) {
+        combiner.initialize(my_item);
+        counters.initialize(my_item);
+    }
 
     /** Constructor **/
-    PROperatorInfo( sycl::buffer<float, 2> &residuals_by_group_buf,
+    PROperatorInfo( sycl::buffer<float_bits_t, 1> &residuals_buf,
                     sycl::buffer<float, 1> &outgoing_update_buf,
                     sycl::buffer<bool, 1> &on_out_wl_buf,
-                    sycl::buffer<size_t, 1> &mutex_buf,
+                    BitmapFrontier &frontier,
+                    IterationStats &stats,
+                    bool dense,
                     sycl::handler &cgh ) 
-        : residuals_by_group{ residuals_by_group_buf, cgh }
+        : dense{ dense }
+        , residuals{ residuals_buf, cgh }
         , outgoing_update{ outgoing_update_buf, cgh }
         , on_out_wl{ on_out_wl_buf, cgh }
-        , mutex{ mutex_buf, cgh }
-        , bids_made{ sycl::range<1>{1}, cgh }
+        , in_bitmap{ frontier, cgh }
+        , out_bitmap{ frontier, cgh }
+        , combiner{ THREAD_BLOCK_SIZE, cgh }
+        , counters{ stats, cgh }
     { }
     /** We must provide a copy constructor */
     PROperatorInfo( const PROperatorInfo &that )
-        : residuals_by_group{ that.residuals_by_group }
+        : dense{ that.dense }
+        , residuals{ that.residuals }
         , outgoing_update{ that.outgoing_update }
         , on_out_wl{ that.on_out_wl }
-        , mutex{ that.mutex }
-        , bids_made{ that.bids_made }
+        , in_bitmap{ that.in_bitmap }
+        , out_bitmap{ that.out_bitmap }
+        , combiner{ that.combiner }
+        , counters{ that.counters }
     { }
 };
 
@@ -90,69 +129,249 @@ class PRIter : public PushScheduler<PRIter, PROperatorInfo> {
         : PushScheduler{num_work_groups, sycl_graph, pipe, cgh, out_worklist_needs_compression, opInfo}
         { }
 
-    // Do a page-rank update
+    // When the frontier is dense the in-worklist holds every node,
+    // so only work on the ones in the frontier
+    bool isActive(index_type node) const {
+        return !opInfo.dense || opInfo.in_bitmap.contains(node);
+    }
+
+    void finalize(const sycl::nd_item<1> &my_item) {
+        opInfo.counters.publish(my_item);
+    }
+
+    // Do a page-rank update.
+    //
+    // Updates to the same node from within my group are first combined
+    // in local memory, and then added into the node's residual
+    // with one atomic add. Whoever's add carries the residual across
+    // the threshold pushes the node.
     void applyPushOperator(const sycl::nd_item<1> &my_item,
                            index_type src_node,
                            index_type edge_index) 
     {
-        // Get my dest node if my edge is valid
+        // Get my dest node and update if my edge is valid, and try
+        // to combine it with the rest of my group's updates
+        bool have_update = edge_index < NEDGES && src_node < NNODES,
+             combined = false;
         index_type dst_node = NNODES;
-        if(edge_index < NEDGES && src_node < NNODES) {
+        float update = 0;
+        if(have_update) {
+            opInfo.counters.add(ITERATION_EDGES);
             dst_node = edge_dst[edge_index];
+            update = opInfo.outgoing_update[src_node];
+            combined = opInfo.combiner.combine(dst_node, update);
         }
-        // make sure bids_made starts out as false
-        opInfo.bids_made[0] = false;
+        // wait for my group to finish combining
         my_item.barrier(sycl::access::fence_space::local_space);
-        // Sit around til everyone in my group gets a chance to perform
-        // their update!
-        while(true) {
-            // If I have stuff to do, compete for my mutex
-            if(edge_index < NEDGES && dst_node < NNODES && src_node < NNODES) {
-                opInfo.mutex[dst_node] = my_item.get_global_id()[0];
-                opInfo.bids_made[0] = true;
-            }
-            // wait for bids to finalize...
-            my_item.barrier();
-            // If nobody has work to do, great! we're done.
-            if(!opInfo.bids_made[0]) {
-                break;
+        // Add my slot's combined update (if any) into the residuals
+        index_type combined_dst_node;
+        float combined_update;
+        if(opInfo.combiner.take(my_item, combined_dst_node, combined_update)) {
+            addResidual(my_item, combined_dst_node, combined_update);
+        }
+        // If my update collided with another node's slot, add it directly
+        if(have_update && !combined) {
+            addResidual(my_item, dst_node, update);
+        }
+        // make sure every slot is cleared before the next round combines
+        my_item.barrier(sycl::access::fence_space::local_space);
+    }
+
+    // Add *update* into the residual of *dst_node*, and push
+    // *dst_node* if this update is the one that crosses the threshold
+    void addResidual(const sycl::nd_item<1> &my_item,
+                     index_type dst_node,
+                     float update)
+    {
+        float prev = atomic_add_float(opInfo.residuals[dst_node],
+                                      update);
+        // (a warm start can leave negative residuals)
+        if(   sycl::fabs(prev) < EPSILON
+           && sycl::fabs(prev + update) >= EPSILON)
+        {
+            // the out-bitmap never fills up and ignores repeated insertions
+            if(opInfo.dense) {
+                opInfo.out_bitmap.insert(dst_node);
+                opInfo.counters.add(ITERATION_PUSHES);
             }
-            my_item.barrier();
-            opInfo.bids_made[0] = false;
-            // If I have stuff to do and got my mutex, do my work!
-            if(edge_index < NEDGES && dst_node < NNODES && src_node < NNODES
-               && opInfo.mutex[dst_node] == my_item.get_global_id()[0]) 
-            {
-                // do my update
-                float update = opInfo.outgoing_update[src_node];
-                float prev = opInfo.residuals_by_group[dst_node][my_item.get_group(0)];
-                opInfo.residuals_by_group[dst_node][my_item.get_group(0)] += update;
-                // See if I need to push the dst node
-                if(   prev < EPSILON / NUM_WORK_GROUPS
-                   && prev + update >= EPSILON / NUM_WORK_GROUPS
-                   && !opInfo.on_out_wl[dst_node]) 
-                {
-                    bool push_success = out_wl.push(dst_node);
-                    if(push_success) {
-                        opInfo.on_out_wl[dst_node] = true;
-                    }
-                    else {
-                        out_worklist_full[0] = true;
-                    }
+            else if(!opInfo.on_out_wl[dst_node]) {
+                bool push_success = out_wl.push(dst_node);
+                if(push_success) {
+                    opInfo.on_out_wl[dst_node] = true;
+                    opInfo.counters.add(ITERATION_PUSHES);
+                }
+                else {
+                    out_worklist_full[0] = true;
+                    opInfo.counters.add(ITERATION_PUSH_FAILURES);
                 }
-                // I got to do my work! so I'm done
-                edge_index = NEDGES;
-                dst_node = NNODES;
-                src_node = NNODES;
             }
-            // Now wait for everyone's updates to finalize
-            my_item.barrier();
         }
     }
 };
 
 // probability of each node as computed by pagerank
-float *P_CURR;
+HostArray<float> P_CURR;
+
+/**
+ * Describe the device buffers allocated by sycl_pagerank
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    const size_t nnodes = graph.nnodes,
+                 num_work_items = work_groups * THREAD_BLOCK_SIZE;
+    plan.add("P_CURR", nnodes * sizeof(float));
+    plan.add("residuals", nnodes * sizeof(float));
+    plan.add("outgoing_update", nnodes * sizeof(float));
+    plan.add("on_out_wl", nnodes * sizeof(bool));
+    plan.add("bitmap frontier", BitmapFrontier::device_footprint((gpu_size_t) nnodes));
+    plan.add("rerun flag", sizeof(bool));
+    gpu_size_t wl_capacity = sycl::max(sycl::max((gpu_size_t) graph.nedges, (gpu_size_t) num_work_items),
+                                       (gpu_size_t) nnodes);
+    plan.add("worklist pipe", Pipe::device_footprint(wl_capacity, (gpu_size_t) nnodes,
+                                                     (gpu_size_t) work_groups));
+    if(IterationStats::device_footprint() > 0) {
+        plan.add("iteration stats", IterationStats::device_footprint());
+    }
+}
+
+/**
+ * Warm start from the ranks of a previous run (PREV_RANKS) on a graph
+ * which has since changed by EDGE_DELTA.
+ *
+ * Pagerank is the fixed point of
+ *      prob[v] = (1-ALPHA) + ALPHA * sum_{u -> v} prob[u] / out_degree(u)
+ * so starting from the previous ranks, each node's residual is the
+ * difference between the two sides. If the previous run converged, this
+ * is only non-negligible at the destinations of changed edges, at the
+ * out-neighbors of their sources (whose out-degree changed), and at new
+ * nodes. So only those nodes are considered (or every node, when there
+ * is no edge delta).
+ *
+ * Considered nodes whose residual is at least EPSILON are put on the
+ * in-worklist as if their residual had just been absorbed: it is added
+ * to their prob and becomes their outgoing update. The residuals of the
+ * others are left in res_buf.
+ *
+ * @return the number of nodes put on the in-worklist
+ */
+gpu_size_t warm_start(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue,
+                      sycl::buffer<float, 1> &P_CURR_buf,
+                      sycl::buffer<float, 1> &res_buf,
+                      sycl::buffer<float, 1> &outgoing_update_buf,
+                      Pipe &wl_pipe)
+{
+    const index_type NNODES = sycl_graph.nnodes;
+    const size_t NUM_WORK_ITEMS = num_work_groups * THREAD_BLOCK_SIZE;
+    // (chars, since a std::vector<bool> can't back a buffer)
+    std::vector<char> affected(NNODES, true);
+    std::vector<index_type> initial_nodes;
+    if(HAVE_EDGE_DELTA) {
+        auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>();
+        auto edge_dst = sycl_graph.edge_dst.get_access<sycl::access::mode::read>();
+        // new nodes have no previous rank, so they're always affected
+        for(const auto &node_rank : PREV_RANKS) {
+            if(node_rank.first < NNODES) {
+                affected[node_rank.first] = false;
+            }
+        }
+        for(const auto &edge : EDGE_DELTA) {
+            if(edge.first >= NNODES || edge.second >= NNODES) {
+                continue;
+            }
+            affected[edge.second] = true;
+            for(index_type e = row_start[edge.first]; e < row_start[edge.first+1]; ++e) {
+                affected[edge_dst[e]] = true;
+            }
+        }
+    }
+    {
+        auto probs = P_CURR_buf.get_access<sycl::access::mode::discard_write>();
+        for(index_type node = 0; node < NNODES; ++node) {
+            probs[node] = 0;
+        }
+        for(const auto &node_rank : PREV_RANKS) {
+            if(node_rank.first < NNODES) {
+                probs[node_rank.first] = node_rank.second;
+            }
+        }
+    }
+
+    // Sum up what the affected nodes get from their in-neighbors.
+    // Only out-edges are stored, so this visits every edge, on the device.
+    std::vector<float_bits_t> incoming(NNODES, float_to_bits(0.0f));
+    {
+        sycl::buffer<char, 1> affected_buf(affected.data(), sycl::range<1>{NNODES});
+        sycl::buffer<float_bits_t, 1> incoming_buf(incoming.data(), sycl::range<1>{NNODES});
+        queue.submit([&] (sycl::handler &cgh) {
+            auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+            auto edge_dst = sycl_graph.edge_dst.get_access<sycl::access::mode::read>(cgh);
+            auto probs = P_CURR_buf.get_access<sycl::access::mode::read>(cgh);
+            auto is_affected = affected_buf.get_access<sycl::access::mode::read>(cgh);
+            auto sums = incoming_buf.get_access<sycl::access::mode::atomic>(cgh);
+            cgh.parallel_for<class WarmStartIncoming>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                        sycl::range<1>{THREAD_BLOCK_SIZE}},
+            [=](sycl::nd_item<1> my_item) {
+                for(index_type src = my_item.get_global_id()[0]; src < NNODES; src += NUM_WORK_ITEMS) {
+                    index_type first_edge = row_start[src],
+                               last_edge = row_start[src+1];
+                    for(index_type e = first_edge; e < last_edge; ++e) {
+                        if(is_affected[edge_dst[e]]) {
+                            atomic_add_float(sums[edge_dst[e]], probs[src] / (last_edge - first_edge));
+                        }
+                    }
+                }
+        }); });
+    }  // copies the sums back into incoming
+
+    {
+        auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>();
+        auto probs = P_CURR_buf.get_access<sycl::access::mode::read_write>();
+        auto res = res_buf.get_access<sycl::access::mode::discard_write>();
+        auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::discard_write>();
+        for(index_type node = 0; node < NNODES; ++node) {
+            res[node] = 0;
+            outgoing_update[node] = 0;
+            if(!affected[node]) {
+                continue;
+            }
+            float residual = (1-ALPHA) + ALPHA * bits_to_float(incoming[node]) - probs[node];
+            if(std::fabs(residual) >= EPSILON) {
+                probs[node] += residual;
+                outgoing_update[node] = residual * ALPHA / (row_start[node+1] - row_start[node]);
+                initial_nodes.push_back(node);
+            }
+            else {
+                res[node] = residual;
+            }
+        }
+    }
+    if(!QUIET) {
+        std::cerr << "WARM START NODES: " << initial_nodes.size() << "\n";
+    }
+
+    // put the initial nodes on the in-worklist
+    // (SYCL buffers can't be empty)
+    initial_nodes.push_back(NNODES);
+    sycl::buffer<index_type, 1> initial_nodes_buf(initial_nodes.data(), sycl::range<1>{initial_nodes.size()});
+    const gpu_size_t NUM_INITIAL_NODES = initial_nodes.size() - 1;
+    queue.submit([&] (sycl::handler &cgh) {
+        InWorklist in_wl(wl_pipe, cgh);
+        auto nodes = initial_nodes_buf.get_access<sycl::access::mode::read>(cgh);
+        cgh.parallel_for<class WarmStartWorklist>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                    sycl::range<1>{THREAD_BLOCK_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            // make sure in_wl has enough room
+            if(my_item.get_local_id()[0] == 0) {
+                in_wl.setSize(NUM_INITIAL_NODES);
+            }
+            my_item.barrier(sycl::access::fence_space::global_space);
+            for(gpu_size_t i = my_item.get_global_id()[0]; i < NUM_INITIAL_NODES; i += NUM_WORK_ITEMS) {
+                in_wl.push(i, nodes[i]);
+            }
+    }); });
+    // wait for the kernel before initial_nodes goes out of scope
+    queue.wait_and_throw();
+    return NUM_INITIAL_NODES;
+}
 
 // declaration of pagerank function, which wil be called by main
 void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue);
@@ -180,12 +399,14 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
                  NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE,
                  WARPS_PER_GROUP = WORK_GROUP_SIZE / WARP_SIZE;
     // build buffers for probability and probability residuals
-    P_CURR = (float*) calloc(sycl_graph.nnodes, sizeof(float));
-    assert(P_CURR != NULL);
-    sycl::buffer<float, 1> P_CURR_buf(P_CURR, sycl::range<1>{sycl_graph.nnodes});
-    sycl::buffer<float, 2> res_buf(sycl::range<2>{sycl_graph.nnodes, NUM_WORK_GROUPS});
+    iterations = 0;
+    alloc_ranks(sycl_graph.nnodes);
+    sycl::buffer<float, 1> P_CURR_buf(P_CURR.get(), sycl::range<1>{sycl_graph.nnodes});
+    sycl::buffer<float, 1> res_buf(sycl::range<1>{sycl_graph.nnodes});
     sycl::buffer<float, 1> outgoing_update_buf(sycl::range<1>{sycl_graph.nnodes});
-    sycl::buffer<size_t, 1> mutex_buf(sycl::range<1>{sycl_graph.nnodes});
+    // The push operator adds into the residuals atomically, so it
+    // views them as bits
+    sycl::buffer<float_bits_t, 1> res_bits_buf = res_buf.reinterpret<float_bits_t, 1>(res_buf.get_range());
 
     // Build and initialize the worklist pipe (the max
     // is needed for small graphs so that no group runs out of space
@@ -195,47 +416,52 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
                  (gpu_size_t) NUM_WORK_GROUPS};
     wl_pipe.initialize(queue);
 
-    // Initialize probabilities to 1-ALPHA,
-    // residuals to 0, and outgoing updates to alpha*(1-alpha)/src_degree
-    // for each node.
-    //
-    // Also, put each node on the in-worklist
-    queue.submit([&] (sycl::handler &cgh) {
-        // some constants
-        const gpu_size_t NNODES = (gpu_size_t) sycl_graph.nnodes;
-        // pr probabilities
-        auto prob = P_CURR_buf.get_access<sycl::access::mode::write>(cgh);
-        auto res = res_buf.get_access<sycl::access::mode::write>(cgh);
-        auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::write>(cgh);
-        // out-worklist and graph
-        InWorklist in_wl(wl_pipe, cgh);
-        auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+    // number of nodes on the in-worklist
+    gpu_size_t frontier_size = sycl_graph.nnodes;
+    if(WARM_START) {
+        frontier_size = warm_start(sycl_graph, queue, P_CURR_buf, res_buf, outgoing_update_buf, wl_pipe);
+    }
+    else {
+        // Initialize probabilities to 1-ALPHA,
+        // residuals to 0, and outgoing updates to alpha*(1-alpha)/src_degree
+        // for each node.
+        //
+        // Also, put each node on the in-worklist
+        queue.submit([&] (sycl::handler &cgh) {
+            // some constants
+            const gpu_size_t NNODES = (gpu_size_t) sycl_graph.nnodes;
+            // pr probabilities
+            auto prob = P_CURR_buf.get_access<sycl::access::mode::write>(cgh);
+            auto res = res_buf.get_access<sycl::access::mode::write>(cgh);
+            auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::write>(cgh);
+            // out-worklist and graph
+            InWorklist in_wl(wl_pipe, cgh);
+            auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
 
-        cgh.parallel_for<class init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
-                                                       sycl::range<1>{WORK_GROUP_SIZE}},
-        [=](sycl::nd_item<1> my_item) {
-            // make sure in_wl has enough room
-            if(my_item.get_local_id()[0] == 0) {
-                in_wl.setSize(NNODES);
-            }
-            my_item.barrier(sycl::access::fence_space::global_space);
-            // Add nodes to worklist and set initial probabilities
-            for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
-                prob[node] = 1.0-ALPHA;
-                // put node on *node*th spot of in-worklist
-                in_wl.push(node, node);
-            }
-            // Initialize the residuals to 0
-            for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
-                for(gpu_size_t wg = 0; wg < NUM_WORK_GROUPS; ++wg) {
-                    res[node][wg] = 0.0;
+            cgh.parallel_for<class init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                           sycl::range<1>{WORK_GROUP_SIZE}},
+            [=](sycl::nd_item<1> my_item) {
+                // make sure in_wl has enough room
+                if(my_item.get_local_id()[0] == 0) {
+                    in_wl.setSize(NNODES);
                 }
-            }
-            // Initialize out-going updates to alpha*(1-alpha)/degree
-            for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
-                outgoing_update[node] = ALPHA * (1-ALPHA) / (row_start[node+1] - row_start[node]);
-            }
-    }); });
+                my_item.barrier(sycl::access::fence_space::global_space);
+                // Add nodes to worklist and set initial probabilities
+                for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                    prob[node] = 1.0-ALPHA;
+                    // put node on *node*th spot of in-worklist
+                    in_wl.push(node, node);
+                }
+                // Initialize the residuals to 0
+                for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                    res[node] = 0.0;
+                }
+                // Initialize out-going updates to alpha*(1-alpha)/degree
+                for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                    outgoing_update[node] = ALPHA * (1-ALPHA) / (row_start[node+1] - row_start[node]);
+                }
+        }); });
+    }
     // Initially, nobody is on the out-worklist
     sycl::buffer<bool, 1> on_out_wl_buf(sycl::range<1>{sycl_graph.nnodes});
     queue.submit([&] (sycl::handler &cgh) {
@@ -250,23 +476,37 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
     }); });
 
 
-    size_t num_kernel_reruns = 0;
-    // local copy of in-worklist size
-    gpu_size_t in_wl_size = sycl_graph.nnodes;
+    // The frontier is stored as a bitmap instead of on the worklists
+    // whenever it holds a large fraction of the nodes (which it does
+    // initially, unless warm starting, since every node starts out
+    // on the in-worklist)
+    BitmapFrontier frontier{(gpu_size_t) sycl_graph.nnodes, (gpu_size_t) NUM_WORK_GROUPS};
+    frontier.initialize(queue);
+    bool dense = use_dense_frontier(frontier_size, sycl_graph.nnodes);
+    if(dense) {
+        frontier.fromWorklist(queue, wl_pipe);
+    }
+
+    size_t num_kernel_reruns = 0,
+           num_dense_iterations = 0;
     // Used by PushScheduler to tell if you need to retry.
     bool rerun = false, rerun_host_copy = false;
     sycl::buffer<bool, 1> rerun_buf(&rerun, sycl::range<1>{1});
+    IterationStats stats;
+    stats.initialize(queue);
     // begin pagerank
-    while(in_wl_size > 0 && ++iterations <= MAX_ITERATIONS) {
+    while(frontier_size > 0 && ++iterations <= MAX_ITERATIONS) {
+        stats.begin(iterations, frontier_size, dense);
         // Run an iteration of pagerank
-        queue.submit([&](sycl::handler &cgh) {
-            PROperatorInfo prInfo( res_buf, outgoing_update_buf, on_out_wl_buf, mutex_buf, cgh );
+        stats.add_event(ITERATION_SCHEDULE, queue.submit([&](sycl::handler &cgh) {
+            PROperatorInfo prInfo( res_bits_buf, outgoing_update_buf, on_out_wl_buf,
+                                   frontier, stats, dense, cgh );
             PRIter currentIter(NUM_WORK_GROUPS, sycl_graph, wl_pipe, cgh, rerun_buf, prInfo );
             cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
                                                sycl::range<1>{WORK_GROUP_SIZE}},
                              currentIter);
-        });
-        // Do we need to re-run?
+        }));
+        // Do we need to re-run? (dense iterations never overflow)
         {
             auto rerun_acc = rerun_buf.get_access<sycl::access::mode::read>();
             rerun_host_copy = rerun_acc[0];
@@ -276,16 +516,26 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
         // Update probabilities and reset residuals and outgoing updates.
         if(!rerun_host_copy) {
             // Swap slots
-            wl_pipe.compress(queue);
-            wl_pipe.swapSlots(queue);
+            if(dense) {
+                num_dense_iterations++;
+                frontier.swapSlots(queue);
+            }
+            else {
+                stats.record_queued(queue, wl_pipe);
+                wl_pipe.compress(queue, true, stats.pipe_events());
+                stats.record_compressed(queue, wl_pipe);
+                wl_pipe.swapSlots(queue);
+            }
             // update probs, reset residuals, get outgoing updates, and reset
             // on_out_wl
-            queue.submit([&](sycl::handler &cgh) {
+            stats.add_event(ITERATION_UPDATE, queue.submit([&](sycl::handler &cgh) {
                 // graph and worklists
                 const size_t NNODES = sycl_graph.nnodes;
                 const size_t NEDGES = sycl_graph.nedges;
                 auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
                 InWorklist in_wl(wl_pipe, cgh);
+                InBitmap in_bitmap(frontier, cgh);
+                const bool DENSE = dense;
                 // residual, updates, and probs
                 auto res = res_buf.get_access<sycl::access::mode::read_write>(cgh);
                 auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::write>(cgh);
@@ -300,47 +550,139 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
                     for(size_t index = my_item.get_global_id()[0]; index < in_wl.getSize(); index += NUM_WORK_ITEMS) {
                         // pop *index*th entry of in-worklist into node
                         in_wl.pop(index, node);
-                        // figure out total residual and add it to the prob
-                        float total_residual = 0;
-                        for(gpu_size_t wg = 0; wg < NUM_WORK_GROUPS; ++wg) {
-                            total_residual += res[node][wg];
-                            res[node][wg] = 0;
+                        if(DENSE && !in_bitmap.contains(node)) {
+                            continue;
                         }
+                        // nodes on the in-worklist came off the out-worklist
+                        on_out_wl[node] = false;
+                        // add the residual to the prob
+                        float total_residual = res[node];
+                        res[node] = 0;
                         probs[node] += total_residual;
                         // store the total residual, scaled appropriately, for
                         // future updates
                         index_type src_degree = row_start[node+1] - row_start[node];
                         outgoing_update[node] = total_residual * ALPHA / src_degree;
                     }
-                    // clear on_out_wl
-                    for(size_t node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
-                        on_out_wl[node] = false;
-                    }
-            }); });
-            // Get in-worklist size (inside a new scope so that the
-            //                       host accessor gets destroyed)
+            }); }));
+            stats.end(false);
+            // Get frontier size (inside a new scope so that the
+            //                   host accessor gets destroyed)
             {
-                sycl::buffer<gpu_size_t, 1> in_wl_size_buf = wl_pipe.get_in_worklist_size_buf();
-                auto in_wl_size_acc = in_wl_size_buf.get_access<sycl::access::mode::read>();
-                in_wl_size = in_wl_size_acc[0];
+                sycl::buffer<gpu_size_t, 1> frontier_size_buf = dense ? frontier.get_in_bitmap_size_buf()
+                                                                       : wl_pipe.get_in_worklist_size_buf();
+                auto frontier_size_acc = frontier_size_buf.get_access<sycl::access::mode::read>();
+                frontier_size = frontier_size_acc[0];
+            }
+            // switch representations if the frontier changed density
+            bool next_dense = use_dense_frontier(frontier_size, sycl_graph.nnodes);
+            if(next_dense && !dense) {
+                frontier.fromWorklist(queue, wl_pipe);
+            }
+            else if(!next_dense && dense) {
+                frontier.toWorklist(queue, wl_pipe);
             }
+            dense = next_dense;
         }
         // If re-running, clear residuals and compress
         else {
-            queue.submit([&](sycl::handler &cgh) {
+            stats.add_event(ITERATION_UPDATE, queue.submit([&](sycl::handler &cgh) {
                 auto res = res_buf.get_access<sycl::access::mode::write>(cgh);
                 const size_t NNODES = sycl_graph.nnodes;
                 cgh.parallel_for<class HardReset>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
                                                                     sycl::range<1>{WORK_GROUP_SIZE}},
                 [=](sycl::nd_item<1> my_item) {
                     for(size_t i = my_item.get_global_id()[0]; i < NNODES; i += NUM_WORK_ITEMS) {
-                        for(gpu_size_t j = 0; j < NUM_WORK_GROUPS; ++j) {
-                            res[i][j] = 0.0;
-                    } }
-            }); });
-            wl_pipe.compress(queue);
+                        res[i] = 0.0;
+                    }
+            }); }));
+            stats.record_queued(queue, wl_pipe);
+            wl_pipe.compress(queue, true, stats.pipe_events());
+            stats.record_compressed(queue, wl_pipe);
+            stats.end(true);
         }
     }
+    // With -t, only the top ranks and their sum leave the device
+    device_top_ranks(queue, P_CURR_buf, sycl_graph.nnodes, NUM_WORK_GROUPS);
     queue.wait_and_throw();
     std::cerr << "NUM KERNEL RERUNS: " << num_kernel_reruns << "\n";
+    std::cerr << "NUM DENSE ITERATIONS: " << num_dense_iterations << "\n";
+    stats.report();
+}
+
+
+// Host backend (-H): PRIter's operator on host threads with native atomics.
+// Each thread's updates go straight to the residuals, so there is
+// no group combining.
+struct HostPRIter {
+    const Host_CSR_Graph &graph;
+    std::atomic<float> *residuals;
+    const float *outgoing_update;
+    std::atomic<bool> *on_out_wl;
+
+    bool isActive(index_type node) const {
+        return true;
+    }
+
+    void applyPushOperator(const HostOutWorklist &out_wl,
+                           index_type src_node,
+                           index_type edge_index)
+    {
+        index_type dst_node = graph.edge_dst[edge_index];
+        float update = outgoing_update[src_node];
+        float prev = host_atomic_add_float(residuals[dst_node], update);
+        // whoever's update crosses the threshold pushes dst_node
+        // (unless it is already on the out-worklist)
+        if(   std::fabs(prev) < EPSILON
+           && std::fabs(prev + update) >= EPSILON
+           && !on_out_wl[dst_node].exchange(true, std::memory_order_relaxed)) {
+            out_wl.push(dst_node);
+        }
+    }
+};
+
+
+int host_main(Host_CSR_Graph &graph) {
+    if(WARM_START) {
+        std::cerr << "The host backend does not support warm starts\n";
+        return 1;
+    }
+    HostThreadPool pool(num_host_threads);
+    std::cerr << "NUM HOST THREADS: " << pool.size() << "\n";
+    const index_type NNODES = graph.nnodes;
+    iterations = 0;
+    alloc_ranks(NNODES);
+    std::vector<std::atomic<float> > residuals(NNODES);
+    std::vector<float> outgoing_update(NNODES);
+    std::unique_ptr<std::atomic<bool>[]> on_out_wl(new std::atomic<bool>[NNODES]);
+    // every node starts out on the frontier
+    std::vector<index_type> frontier(NNODES);
+    pool.parallel_for_range(NNODES, HOST_CHUNK_SIZE, [&](unsigned, size_t first, size_t last) {
+        for(index_type node = first; node < last; ++node) {
+            P_CURR[node] = 1.0-ALPHA;
+            residuals[node].store(0, std::memory_order_relaxed);
+            outgoing_update[node] = ALPHA * (1-ALPHA) / graph.get_out_degree(node);
+            on_out_wl[node].store(false, std::memory_order_relaxed);
+            frontier[node] = node;
+        }
+    });
+
+    HostPushScheduler<HostPRIter> scheduler(pool, graph);
+    HostPRIter prIter{ graph, residuals.data(), outgoing_update.data(), on_out_wl.get() };
+    while(!frontier.empty() && ++iterations <= MAX_ITERATIONS) {
+        scheduler.run(prIter, frontier);
+        // absorb the residuals of the nodes pushed
+        pool.parallel_for_range(frontier.size(), HOST_CHUNK_SIZE, [&](unsigned, size_t first, size_t last) {
+            for(size_t i = first; i < last; ++i) {
+                index_type node = frontier[i];
+                on_out_wl[node].store(false, std::memory_order_relaxed);
+                float total_residual = residuals[node].exchange(0, std::memory_order_relaxed);
+                P_CURR[node] += total_residual;
+                outgoing_update[node] = total_residual * ALPHA / graph.get_out_degree(node);
+            }
+        });
+    }
+
+    host_top_ranks(graph);
+    return 0;
 }
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <numeric>
+#include <utility>
+#include <vector>
+#include <CL/sycl.hpp>
+
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// THREAD_BLOCK_SIZE
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph node_data_type index_type
+#include "sycl_csr_graph.h"
+// PullScheduler gpu_size_t
+#include "pull_scheduler.h"
+
+extern const float ALPHA = 0.85;
+extern const float EPSILON = 0.000001;
+extern int MAX_ITERATIONS ;
+int iterations = 0 ;
+
+// Seeds in a batch are tracked by the bits of a 32-bit mask
+typedef uint32_t seed_mask_t;
+extern const size_t PPR_MAX_BATCH = 32;
+
+// from personalized-support.cpp
+extern std::vector<index_type> SEEDS;
+extern size_t BATCH_SIZE;
+extern int PRINT_TOP;
+extern std::vector<index_type> TOP_NODES;
+extern std::vector<float> TOP_RANKS;
+
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class ppr_init;
+
+extern size_t num_work_groups;
+
+struct PPROperatorInfo {
+    // number of seeds in this batch
+    gpu_size_t batch_size;
+    // bit k is set iff seed k of the batch hasn't converged
+    seed_mask_t active_seeds;
+    // global accessors. Per-seed arrays are laid out [seed][node]
+    sycl::accessor<index_type, 1,
+                   sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+                       // out-edges of the (untransposed) graph, used
+                       // to compute out-degrees
+                       out_row_start;
+    sycl::accessor<float, 1,
+                   sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+                       // update coming out of each node for each seed this iteration
+                       outgoing_update;
+    sycl::accessor<float, 1,
+                   sycl::access::mode::write,
+                   sycl::access::target::global_buffer>
+                       // update coming out of each node for each seed next iteration
+                       next_outgoing_update;
+    sycl::accessor<float, 1,
+                   sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+                       probs;
+    sycl::accessor<seed_mask_t, 1,
+                   sycl::access::mode::atomic,
+                   sycl::access::target::global_buffer>
+                       // bit k is set if any node changes by more than
+                       // EPSILON for seed k
+                       still_active_seeds;
+    /** Called at start of pull scheduling */
+    void initialize(const sycl::nd_item<1> &my_item) { }
+
+    /** Constructor **/
+    PPROperatorInfo( SYCL_CSR_Graph &sycl_graph,
+                     gpu_size_t batch_size,
+                     seed_mask_t active_seeds,
+                     sycl::buffer<float, 1> &outgoing_update_buf,
+                     sycl::buffer<float, 1> &next_outgoing_update_buf,
+                     sycl::buffer<float, 1> &probs_buf,
+                     sycl::buffer<seed_mask_t, 1> &still_active_seeds_buf,
+                     sycl::handler &cgh )
+        : batch_size{ batch_size }
+        , active_seeds{ active_seeds }
+        , out_row_start{ sycl_graph.row_start, cgh }
+        , outgoing_update{ outgoing_update_buf, cgh }
+        , next_outgoing_update{ next_outgoing_update_buf, cgh }
+        , probs{ probs_buf, cgh }
+        , still_active_seeds{ still_active_seeds_buf, cgh }
+    { }
+    /** We must provide a copy constructor */
+    PPROperatorInfo( const PPROperatorInfo &that )
+        : batch_size{ that.batch_size }
+        , active_seeds{ that.active_seeds }
+        , out_row_start{ that.out_row_start }
+        , outgoing_update{ that.outgoing_update }
+        , next_outgoing_update{ that.next_outgoing_update }
+        , probs{ that.probs }
+        , still_active_seeds{ that.still_active_seeds }
+    { }
+};
+
+
+// Define our personalized PR pull operator
+class PPRPullIter : public PullScheduler<PPRPullIter, PPROperatorInfo> {
+    public:
+    PPRPullIter(gpu_size_t num_work_groups,
+                SYCL_CSR_Graph &sycl_transpose, sycl::handler &cgh,
+                PPROperatorInfo &opInfo)
+        : PullScheduler{num_work_groups, sycl_transpose, cgh, opInfo}
+        { }
+
+    // Gather the updates coming into dst_node for every seed which
+    // hasn't converged, reading each in-edge once for the whole batch.
+    void applyPullOperator(const sycl::nd_item<1>&,
+                           index_type dst_node,
+                           index_type first_in_edge,
+                           index_type last_in_edge)
+    {
+        float residual[PPR_MAX_BATCH];
+        for(gpu_size_t k = 0; k < opInfo.batch_size; ++k) {
+            residual[k] = 0;
+        }
+        for(index_type in_edge = first_in_edge; in_edge < last_in_edge; ++in_edge) {
+            index_type src_node = in_edge_src[in_edge];
+            for(gpu_size_t k = 0; k < opInfo.batch_size; ++k) {
+                if(opInfo.active_seeds & ((seed_mask_t) 1 << k)) {
+                    residual[k] += opInfo.outgoing_update[k * NNODES + src_node];
+                }
+            }
+        }
+        index_type src_degree = opInfo.out_row_start[dst_node+1] - opInfo.out_row_start[dst_node];
+        seed_mask_t my_active_seeds = 0;
+        for(gpu_size_t k = 0; k < opInfo.batch_size; ++k) {
+            if(opInfo.active_seeds & ((seed_mask_t) 1 << k)) {
+                opInfo.probs[k * NNODES + dst_node] += residual[k];
+                if(residual[k] > EPSILON) {
+                    my_active_seeds |= (seed_mask_t) 1 << k;
+                }
+                opInfo.next_outgoing_update[k * NNODES + dst_node] = residual[k] * ALPHA / src_degree;
+            }
+        }
+        // only bother with the atomic if it would set a new bit
+        if((opInfo.still_active_seeds[0].load() & my_active_seeds) != my_active_seeds) {
+            opInfo.still_active_seeds[0].fetch_or(my_active_seeds);
+        }
+    }
+};
+
+
+// the transpose of the loaded graph, so that each node can read its
+// in-edges (built once by prepare_graph)
+Host_CSR_Graph HOST_TRANSPOSE;
+
+/**
+ * Build HOST_TRANSPOSE before the driver times anything
+ */
+int prepare_graph(const Host_CSR_Graph &graph) {
+    if(HOST_TRANSPOSE.buildTranspose(graph.nnodes, graph.nedges, graph.row_start, graph.edge_dst)) {
+        std::cerr << "Cannot build the transpose of the graph\n";
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Describe the device buffers allocated by sycl_pagerank
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    const size_t nnodes = graph.nnodes,
+                 batch_size = BATCH_SIZE == 0 ? PPR_MAX_BATCH : BATCH_SIZE;
+    plan.add("transpose row_start", (nnodes + 1) * sizeof(index_type));
+    plan.add("transpose edge_dst", graph.nedges * sizeof(index_type));
+    plan.add("probs (per seed)", batch_size * nnodes * sizeof(float));
+    plan.add("outgoing_update (per seed, double-buffered)", 2 * batch_size * nnodes * sizeof(float));
+    plan.add("batch seeds", batch_size * sizeof(index_type));
+    plan.add("active seed mask", sizeof(seed_mask_t));
+}
+
+// declaration of pagerank function, which wil be called by main
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue);
+
+int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    std::cerr << "NUM WORK GROUPS: " << num_work_groups << "\n";
+    if(SEEDS.empty()) {
+        SEEDS.push_back(0);
+    }
+    for(index_type seed : SEEDS) {
+        if(seed >= sycl_graph.nnodes) {
+            std::cerr << "Seed " << seed << " is not a node\n";
+            std::exit(1);
+        }
+    }
+    if(BATCH_SIZE == 0) {
+        BATCH_SIZE = PPR_MAX_BATCH;
+    }
+    PRINT_TOP = std::min((size_t) PRINT_TOP, sycl_graph.nnodes);
+    try {
+        sycl_pagerank(sycl_graph, queue);
+    }
+    catch (sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+
+   return 0;
+}
+
+
+/**
+ * Compute personalized pagerank for each seed in SEEDS,
+ * BATCH_SIZE seeds at a time, and record the top PRINT_TOP
+ * nodes of each seed
+ */
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    iterations = 0;
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE,
+                 NNODES = sycl_graph.nnodes;
+    SYCL_CSR_Graph sycl_transpose(&HOST_TRANSPOSE);
+
+    // per-seed probabilities and (double-buffered) outgoing updates
+    sycl::buffer<float, 1> probs_buf(sycl::range<1>{BATCH_SIZE * NNODES}),
+                           outgoing_update_buf(sycl::range<1>{BATCH_SIZE * NNODES}),
+                           next_outgoing_update_buf(sycl::range<1>{BATCH_SIZE * NNODES});
+    sycl::buffer<index_type, 1> batch_seeds_buf(sycl::range<1>{BATCH_SIZE});
+    sycl::buffer<seed_mask_t, 1> still_active_seeds_buf(sycl::range<1>{1});
+
+    TOP_NODES.resize(SEEDS.size() * PRINT_TOP);
+    TOP_RANKS.resize(SEEDS.size() * PRINT_TOP);
+    std::vector<index_type> nodes_by_rank(NNODES);
+    for(size_t first_seed = 0; first_seed < SEEDS.size(); first_seed += BATCH_SIZE) {
+        const gpu_size_t batch_size = std::min(BATCH_SIZE, SEEDS.size() - first_seed);
+        {
+            auto batch_seeds = batch_seeds_buf.get_access<sycl::access::mode::discard_write>();
+            for(gpu_size_t k = 0; k < batch_size; ++k) {
+                batch_seeds[k] = SEEDS[first_seed + k];
+            }
+        }
+        // Each seed starts with probability 1-ALPHA at the seed,
+        // and an outgoing update of alpha*(1-alpha)/seed_degree
+        queue.submit([&] (sycl::handler &cgh) {
+            auto probs = probs_buf.get_access<sycl::access::mode::discard_write>(cgh);
+            auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::discard_write>(cgh);
+            auto batch_seeds = batch_seeds_buf.get_access<sycl::access::mode::read>(cgh);
+            auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+
+            cgh.parallel_for<class ppr_init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                               sycl::range<1>{WORK_GROUP_SIZE}},
+            [=](sycl::nd_item<1> my_item) {
+                for(gpu_size_t k = 0; k < batch_size; ++k) {
+                    const index_type seed = batch_seeds[k];
+                    for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                        probs[k * NNODES + node] = node == seed ? 1.0-ALPHA : 0.0;
+                        outgoing_update[k * NNODES + node] =
+                            node == seed ? ALPHA * (1-ALPHA) / (row_start[node+1] - row_start[node]) : 0.0;
+                    }
+                }
+        }); });
+
+        seed_mask_t active_seeds = batch_size == PPR_MAX_BATCH ? ~(seed_mask_t) 0
+                                                               : ((seed_mask_t) 1 << batch_size) - 1;
+        int batch_iterations = 0;
+        while(active_seeds != 0 && ++batch_iterations <= MAX_ITERATIONS) {
+            {
+                auto still_active_seeds = still_active_seeds_buf.get_access<sycl::access::mode::discard_write>();
+                still_active_seeds[0] = 0;
+            }
+            queue.submit([&](sycl::handler &cgh) {
+                PPROperatorInfo pprInfo( sycl_graph, batch_size, active_seeds,
+                                         outgoing_update_buf, next_outgoing_update_buf,
+                                         probs_buf, still_active_seeds_buf, cgh );
+                PPRPullIter currentIter( NUM_WORK_GROUPS, sycl_transpose, cgh, pprInfo );
+                cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                   sycl::range<1>{WORK_GROUP_SIZE}},
+                                 currentIter);
+            });
+            // next iteration reads the updates we just wrote
+            std::swap(outgoing_update_buf, next_outgoing_update_buf);
+            // seeds which have converged stop contributing work
+            {
+                auto still_active_seeds = still_active_seeds_buf.get_access<sycl::access::mode::read>();
+                active_seeds &= still_active_seeds[0];
+            }
+        }
+        iterations += std::min(batch_iterations, MAX_ITERATIONS);
+        std::cerr << "BATCH OF SEEDS " << first_seed << "-" << first_seed + batch_size - 1
+                  << " TOOK " << std::min(batch_iterations, MAX_ITERATIONS) << " ITERATIONS\n";
+
+        // record each seed's top ranks
+        auto probs = probs_buf.get_access<sycl::access::mode::read>();
+        for(gpu_size_t k = 0; k < batch_size; ++k) {
+            std::iota(nodes_by_rank.begin(), nodes_by_rank.end(), 0);
+            std::partial_sort(nodes_by_rank.begin(), nodes_by_rank.begin() + PRINT_TOP, nodes_by_rank.end(),
+                              [&](index_type a, index_type b) {
+                                  return probs[k * NNODES + a] > probs[k * NNODES + b];
+                              });
+            for(int i = 0; i < PRINT_TOP; ++i) {
+                TOP_NODES[(first_seed + k) * PRINT_TOP + i] = nodes_by_rank[i];
+                TOP_RANKS[(first_seed + k) * PRINT_TOP + i] = probs[k * NNODES + nodes_by_rank[i]];
+            }
+        }
+    }
+    queue.wait_and_throw();
+}
@@ -0,0 +1,252 @@
+#include <climits>
+#include <iostream>
+#include <vector>
+#include <CL/sycl.hpp>
+
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// THREAD_BLOCK_SIZE
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph node_data_type index_type
+#include "sycl_csr_graph.h"
+// float_bits_t bits_to_float float_to_bits atomic_add_float gpu_size_t
+#include "float_atomics.h"
+// P_CURR alloc_ranks device_top_ranks
+#include "top_ranks.h"
+
+extern const float ALPHA = 0.85;
+extern const float EPSILON = 0.000001;
+extern const bool SUPPORTS_WARM_START = false;
+extern int MAX_ITERATIONS ;
+int iterations = 0 ;
+
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class init;
+class pb_scatter;
+class pb_gather;
+
+extern size_t num_work_groups;
+
+// Only use this fraction of the device's local memory
+// for a bin's accumulators
+#define BIN_LOCAL_MEM_FRACTION 2
+
+// probability of each node as computed by pagerank
+HostArray<float> P_CURR;
+
+/**
+ * Describe the device buffers allocated by sycl_pagerank
+ *
+ * The bin boundaries and cursors depend on the device's local memory size,
+ * and are small, so they aren't counted.
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t /* work_groups */) {
+    const size_t nnodes = graph.nnodes,
+                 nedges = graph.nedges;
+    plan.add("P_CURR", nnodes * sizeof(float));
+    plan.add("outgoing_update", nnodes * sizeof(float));
+    plan.add("bin_dst", nedges * sizeof(gpu_size_t));
+    plan.add("bin_update", nedges * sizeof(float));
+    plan.add("converged flag", sizeof(bool));
+}
+
+// declaration of pagerank function, which wil be called by main
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue);
+
+int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    std::cerr << "NUM WORK GROUPS: " << num_work_groups << "\n";
+    try {
+        sycl_pagerank(sycl_graph, queue);
+    }
+    catch (sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+
+   return 0;
+}
+
+
+/**
+ * Topology-driven pagerank using propagation blocking
+ * (Beamer, Asanovic, and Patterson, "Reducing PageRank Communication
+ *  via Propagation Blocking", IPDPS 2017).
+ *
+ * Destinations are split into bins of BIN_NODES consecutive nodes,
+ * where BIN_NODES floats fit in a fraction of the device's local memory.
+ * Each bin has room for its in-edges, counted once on the host, and a
+ * cursor to its first free entry. Each iteration
+ *      - scatters: each source appends (destination, update) pairs to
+ *                  the bins of its out-edges. A run of out-edges into
+ *                  the same bin takes its entries with one atomic bump
+ *                  of the bin's cursor, and writes them in order.
+ *      - gathers: each work-group accumulates one bin at a time in
+ *                 local memory, then updates the bin's nodes and
+ *                 rewinds the bin's cursor for the next scatter.
+ * so no iteration makes random accesses to global memory
+ * across the whole node array.
+ */
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    const size_t NNODES = sycl_graph.nnodes,
+                 NEDGES = sycl_graph.nedges;
+    // size the bins to the device's local memory
+    const size_t local_mem_size = queue.get_device().get_info<sycl::info::device::local_mem_size>();
+    const gpu_size_t BIN_NODES = sycl::max((size_t) 1, sycl::min(NNODES,
+        local_mem_size / BIN_LOCAL_MEM_FRACTION / sizeof(float_bits_t)));
+    const gpu_size_t NUM_BINS = (NNODES + BIN_NODES - 1) / BIN_NODES;
+    std::cerr << "NUM BINS: " << NUM_BINS << " (" << BIN_NODES << " nodes each)\n";
+
+    // Every edge is appended to its destination's bin once per
+    // iteration, so each bin's entries start where the previous
+    // bin's in-edges end.
+    std::vector<gpu_size_t> bin_start(NUM_BINS + 1, 0);
+    {
+        auto edge_dst = sycl_graph.edge_dst.get_access<sycl::access::mode::read>();
+        for(size_t edge = 0; edge < NEDGES; ++edge) {
+            bin_start[edge_dst[edge] / BIN_NODES + 1]++;
+        }
+        for(gpu_size_t bin = 0; bin < NUM_BINS; ++bin) {
+            bin_start[bin + 1] += bin_start[bin];
+        }
+    }
+    // next free entry of each bin
+    std::vector<gpu_size_t> bin_cursor(bin_start.begin(), bin_start.end() - 1);
+    sycl::buffer<gpu_size_t, 1> bin_start_buf(bin_start.data(), sycl::range<1>{bin_start.size()}),
+                                bin_cursor_buf(bin_cursor.data(), sycl::range<1>{bin_cursor.size()}),
+                                bin_dst_buf(sycl::range<1>{sycl::max(NEDGES, (size_t) 1)});
+    sycl::buffer<float, 1> bin_update_buf(sycl::range<1>{sycl::max(NEDGES, (size_t) 1)});
+
+    // build buffers for probability and outgoing updates
+    iterations = 0;
+    alloc_ranks(sycl_graph.nnodes);
+    sycl::buffer<float, 1> P_CURR_buf(P_CURR.get(), sycl::range<1>{sycl_graph.nnodes});
+    sycl::buffer<float, 1> outgoing_update_buf(sycl::range<1>{sycl_graph.nnodes});
+
+    // Initialize probabilities to 1-ALPHA,
+    // and outgoing updates to alpha*(1-alpha)/src_degree
+    // for each node.
+    queue.submit([&] (sycl::handler &cgh) {
+        // pr probabilities
+        auto prob = P_CURR_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+
+        cgh.parallel_for<class init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                       sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                prob[node] = 1.0-ALPHA;
+                outgoing_update[node] = ALPHA * (1-ALPHA) / (row_start[node+1] - row_start[node]);
+            }
+    }); });
+
+    // have we converged yet?
+    bool converged = false, converged_host_copy = false;
+    sycl::buffer<bool, 1> converged_buf(&converged, sycl::range<1>{1});
+    // begin pagerank
+    while(!converged_host_copy && ++iterations <= MAX_ITERATIONS) {
+        // We've converged unless some node says otherwise
+        {
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::write>();
+            converged_acc[0] = true;
+        }
+        // Append each node's update to the bins of its out-edges
+        queue.submit([&](sycl::handler &cgh) {
+            auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+            auto edge_dst = sycl_graph.edge_dst.get_access<sycl::access::mode::read>(cgh);
+            auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::read>(cgh);
+            auto bin_cursor = bin_cursor_buf.get_access<sycl::access::mode::atomic>(cgh);
+            auto bin_dst = bin_dst_buf.get_access<sycl::access::mode::discard_write>(cgh);
+            auto bin_update = bin_update_buf.get_access<sycl::access::mode::discard_write>(cgh);
+
+            cgh.parallel_for<class pb_scatter>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                 sycl::range<1>{WORK_GROUP_SIZE}},
+            [=](sycl::nd_item<1> my_item) {
+                for(index_type src = my_item.get_global_id()[0]; src < NNODES; src += NUM_WORK_ITEMS) {
+                    float update = outgoing_update[src];
+                    index_type edge = row_start[src], last_edge = row_start[src+1];
+                    while(edge < last_edge) {
+                        // reserve the whole run of edges into this bin at once
+                        gpu_size_t bin = edge_dst[edge] / BIN_NODES;
+                        index_type run_end = edge + 1;
+                        while(run_end < last_edge && edge_dst[run_end] / BIN_NODES == bin) {
+                            ++run_end;
+                        }
+                        gpu_size_t entry = bin_cursor[bin].fetch_add((gpu_size_t) (run_end - edge));
+                        for(; edge < run_end; ++edge, ++entry) {
+                            bin_dst[entry] = edge_dst[edge];
+                            bin_update[entry] = update;
+                        }
+                    }
+                }
+        }); });
+        // Gather each bin in local memory, then update its nodes
+        queue.submit([&](sycl::handler &cgh) {
+            auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+            auto bin_start = bin_start_buf.get_access<sycl::access::mode::read>(cgh);
+            auto bin_cursor = bin_cursor_buf.get_access<sycl::access::mode::write>(cgh);
+            auto bin_dst = bin_dst_buf.get_access<sycl::access::mode::read>(cgh);
+            auto bin_update = bin_update_buf.get_access<sycl::access::mode::read>(cgh);
+            auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::discard_write>(cgh);
+            auto probs = P_CURR_buf.get_access<sycl::access::mode::read_write>(cgh);
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::write>(cgh);
+            // local memory
+            sycl::accessor<float_bits_t, 1,
+                           sycl::access::mode::atomic,
+                           sycl::access::target::local>
+                               // residual of each node in the bin
+                               bin_residual{sycl::range<1>{BIN_NODES}, cgh};
+
+            cgh.parallel_for<class pb_gather>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                sycl::range<1>{WORK_GROUP_SIZE}},
+            [=](sycl::nd_item<1> my_item) {
+                const size_t local_id = my_item.get_local_id()[0];
+                for(gpu_size_t bin = my_item.get_group(0); bin < NUM_BINS; bin += NUM_WORK_GROUPS) {
+                    const gpu_size_t first_node = bin * BIN_NODES,
+                                     bin_nodes = sycl::min(BIN_NODES, (gpu_size_t) (NNODES - first_node));
+                    for(gpu_size_t i = local_id; i < bin_nodes; i += WORK_GROUP_SIZE) {
+                        bin_residual[i].store(float_to_bits(0.0f));
+                    }
+                    my_item.barrier(sycl::access::fence_space::local_space);
+                    for(gpu_size_t entry = bin_start[bin] + local_id; entry < bin_start[bin+1]; entry += WORK_GROUP_SIZE) {
+                        atomic_add_float(bin_residual[bin_dst[entry] - first_node], bin_update[entry]);
+                    }
+                    my_item.barrier(sycl::access::fence_space::local_space);
+                    // the bin is empty again for the next scatter
+                    if(local_id == 0) {
+                        bin_cursor[bin] = bin_start[bin];
+                    }
+                    for(gpu_size_t i = local_id; i < bin_nodes; i += WORK_GROUP_SIZE) {
+                        index_type node = first_node + i;
+                        float residual = bits_to_float(bin_residual[i].load());
+                        probs[node] += residual;
+                        // if change was big enough, record that we still have work to do
+                        if(residual > EPSILON) {
+                            converged_acc[0] = false;
+                        }
+                        // store the residual, scaled appropriately, for the next iteration
+                        index_type src_degree = row_start[node+1] - row_start[node];
+                        outgoing_update[node] = residual * ALPHA / src_degree;
+                    }
+                    // don't clear the accumulators until everyone has read them
+                    my_item.barrier(sycl::access::fence_space::local_space);
+                }
+        }); });
+        // Did we converge? ( put in local scope to make sure we hit destructor )
+        {
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::read>();
+            converged_host_copy = converged_acc[0];
+        }
+    }
+    // With -t, only the top ranks and their sum leave the device
+    device_top_ranks(queue, P_CURR_buf, sycl_graph.nnodes, NUM_WORK_GROUPS);
+    queue.wait_and_throw();
+}
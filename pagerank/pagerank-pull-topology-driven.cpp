@@ -0,0 +1,254 @@
+#include <climits>
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <CL/sycl.hpp>
+
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// THREAD_BLOCK_SIZE
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph node_data_type index_type
+#include "sycl_csr_graph.h"
+// PullScheduler
+#include "pull_scheduler.h"
+// P_CURR alloc_ranks host_top_ranks device_top_ranks
+#include "top_ranks.h"
+// reference_pagerank host_reference_isa HostThreadPool
+#include "host_reference.h"
+
+extern const float ALPHA = 0.85;
+extern const float EPSILON = 0.000001;
+extern const bool SUPPORTS_WARM_START = false;
+extern int MAX_ITERATIONS ;
+int iterations = 0 ;
+
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class init;
+
+extern size_t num_work_groups;
+extern unsigned num_host_threads;
+
+struct PRPullOperatorInfo {
+    // global accessors
+    sycl::accessor<index_type, 1,
+                   sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+                       // out-edges of the (untransposed) graph, used
+                       // to compute out-degrees
+                       out_row_start;
+    sycl::accessor<float, 1,
+                   sycl::access::mode::read,
+                   sycl::access::target::global_buffer>
+                       // update coming out of each node this iteration
+                       outgoing_update;
+    sycl::accessor<float, 1,
+                   sycl::access::mode::write,
+                   sycl::access::target::global_buffer>
+                       // update coming out of each node next iteration
+                       next_outgoing_update;
+    sycl::accessor<float, 1,
+                   sycl::access::mode::read_write,
+                   sycl::access::target::global_buffer>
+                       probs;
+    sycl::accessor<bool, 1,
+                   sycl::access::mode::write,
+                   sycl::access::target::global_buffer>
+                       // set to false if any node changes by more than EPSILON
+                       converged;
+    /** Called at start of pull scheduling */
+    void initialize(const sycl::nd_item<1> &my_item) { }
+
+    /** Constructor **/
+    PRPullOperatorInfo( SYCL_CSR_Graph &sycl_graph,
+                        sycl::buffer<float, 1> &outgoing_update_buf,
+                        sycl::buffer<float, 1> &next_outgoing_update_buf,
+                        sycl::buffer<float, 1> &probs_buf,
+                        sycl::buffer<bool, 1> &converged_buf,
+                        sycl::handler &cgh )
+        : out_row_start{ sycl_graph.row_start, cgh }
+        , outgoing_update{ outgoing_update_buf, cgh }
+        , next_outgoing_update{ next_outgoing_update_buf, cgh }
+        , probs{ probs_buf, cgh }
+        , converged{ converged_buf, cgh }
+    { }
+    /** We must provide a copy constructor */
+    PRPullOperatorInfo( const PRPullOperatorInfo &that )
+        : out_row_start{ that.out_row_start }
+        , outgoing_update{ that.outgoing_update }
+        , next_outgoing_update{ that.next_outgoing_update }
+        , probs{ that.probs }
+        , converged{ that.converged }
+    { }
+};
+
+
+// Define our PR pull operator
+class PRPullIter : public PullScheduler<PRPullIter, PRPullOperatorInfo> {
+    public:
+    PRPullIter(gpu_size_t num_work_groups,
+               SYCL_CSR_Graph &sycl_transpose, sycl::handler &cgh,
+               PRPullOperatorInfo &opInfo)
+        : PullScheduler{num_work_groups, sycl_transpose, cgh, opInfo}
+        { }
+
+    // Gather the updates coming into dst_node, add them to its
+    // probability, and compute its update for the next iteration.
+    //
+    // Every node is written only by the work-item pulling into it,
+    // and next iteration's updates go in a separate buffer, so
+    // no atomics are needed.
+    void applyPullOperator(const sycl::nd_item<1>&,
+                           index_type dst_node,
+                           index_type first_in_edge,
+                           index_type last_in_edge)
+    {
+        float residual = 0;
+        for(index_type in_edge = first_in_edge; in_edge < last_in_edge; ++in_edge) {
+            residual += opInfo.outgoing_update[in_edge_src[in_edge]];
+        }
+        opInfo.probs[dst_node] += residual;
+        // if change was big enough, record that we still have work to do
+        if(residual > EPSILON) {
+            opInfo.converged[0] = false;
+        }
+        // store the residual, scaled appropriately, for the next iteration
+        index_type src_degree = opInfo.out_row_start[dst_node+1] - opInfo.out_row_start[dst_node];
+        opInfo.next_outgoing_update[dst_node] = residual * ALPHA / src_degree;
+    }
+};
+
+
+// probability of each node as computed by pagerank
+HostArray<float> P_CURR;
+
+// the transpose of the loaded graph, so that each node can read its
+// in-edges (built once by prepare_graph)
+Host_CSR_Graph HOST_TRANSPOSE;
+
+/**
+ * Build HOST_TRANSPOSE before the driver times anything
+ */
+int prepare_graph(const Host_CSR_Graph &graph) {
+    if(HOST_TRANSPOSE.buildTranspose(graph.nnodes, graph.nedges, graph.row_start, graph.edge_dst)) {
+        std::cerr << "Cannot build the transpose of the graph\n";
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Describe the device buffers allocated by sycl_pagerank
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    const size_t nnodes = graph.nnodes;
+    plan.add("transpose row_start", (nnodes + 1) * sizeof(index_type));
+    plan.add("transpose edge_dst", graph.nedges * sizeof(index_type));
+    plan.add("P_CURR", nnodes * sizeof(float));
+    plan.add("outgoing_update (double-buffered)", 2 * nnodes * sizeof(float));
+    plan.add("converged flag", sizeof(bool));
+}
+
+// declaration of pagerank function, which wil be called by main
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue);
+
+int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    std::cerr << "NUM WORK GROUPS: " << num_work_groups << "\n";
+    try {
+        sycl_pagerank(sycl_graph, queue);
+    }
+    catch (sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+
+   return 0;
+}
+
+
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    SYCL_CSR_Graph sycl_transpose(&HOST_TRANSPOSE);
+
+    // build buffers for probability and outgoing updates.
+    // The outgoing updates are double-buffered: each iteration reads
+    // the current updates and writes the next ones
+    iterations = 0;
+    alloc_ranks(sycl_graph.nnodes);
+    sycl::buffer<float, 1> P_CURR_buf(P_CURR.get(), sycl::range<1>{sycl_graph.nnodes});
+    sycl::buffer<float, 1> outgoing_update_buf(sycl::range<1>{sycl_graph.nnodes}),
+                           next_outgoing_update_buf(sycl::range<1>{sycl_graph.nnodes});
+
+    // Initialize probabilities to 1-ALPHA,
+    // and outgoing updates to alpha*(1-alpha)/src_degree
+    // for each node.
+    queue.submit([&] (sycl::handler &cgh) {
+        // some constants
+        const gpu_size_t NNODES = (gpu_size_t) sycl_graph.nnodes;
+        // pr probabilities
+        auto prob = P_CURR_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+
+        cgh.parallel_for<class init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                       sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                prob[node] = 1.0-ALPHA;
+                outgoing_update[node] = ALPHA * (1-ALPHA) / (row_start[node+1] - row_start[node]);
+            }
+    }); });
+
+    // have we converged yet?
+    bool converged = false, converged_host_copy = false;
+    sycl::buffer<bool, 1> converged_buf(&converged, sycl::range<1>{1});
+    // begin pagerank
+    while(!converged_host_copy && ++iterations <= MAX_ITERATIONS) {
+        // We've converged unless some node says otherwise
+        {
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::write>();
+            converged_acc[0] = true;
+        }
+        // Run an iteration of pagerank
+        queue.submit([&](sycl::handler &cgh) {
+            PRPullOperatorInfo prInfo( sycl_graph, outgoing_update_buf, next_outgoing_update_buf,
+                                       P_CURR_buf, converged_buf, cgh );
+            PRPullIter currentIter( NUM_WORK_GROUPS, sycl_transpose, cgh, prInfo );
+            cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                               sycl::range<1>{WORK_GROUP_SIZE}},
+                             currentIter);
+        });
+        // next iteration reads the updates we just wrote
+        std::swap(outgoing_update_buf, next_outgoing_update_buf);
+        // Did we converge? ( put in local scope to make sure we hit destructor )
+        {
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::read>();
+            converged_host_copy = converged_acc[0];
+        }
+    }
+    // With -t, only the top ranks and their sum leave the device
+    device_top_ranks(queue, P_CURR_buf, sycl_graph.nnodes, NUM_WORK_GROUPS);
+    queue.wait_and_throw();
+}
+
+/**
+ * The host backend: the vectorized pull PageRank of host_reference.h,
+ * which iterates the same update as the pull operator
+ */
+int host_main(Host_CSR_Graph &graph) {
+    HostThreadPool pool(num_host_threads);
+    std::cerr << "NUM HOST THREADS: " << pool.size() << "\n";
+    std::cerr << "HOST ISA: " << host_reference_isa() << "\n";
+    alloc_ranks(graph.nnodes);
+    iterations = reference_pagerank(pool, graph, HOST_TRANSPOSE, ALPHA, EPSILON, MAX_ITERATIONS, P_CURR);
+
+    host_top_ranks(graph);
+    return 0;
+}
@@ -0,0 +1,208 @@
+#include <climits>
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <CL/sycl.hpp>
+
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
+// THREAD_BLOCK_SIZE SELL_SLICE_HEIGHT SELL_SORT_WINDOW
+#include "kernel_sizing.h"
+// SYCL_CSR_Graph node_data_type index_type
+#include "sycl_csr_graph.h"
+// SYCL_SELL_Graph Host_SELL_Graph
+#include "sycl_sell_graph.h"
+// P_CURR alloc_ranks device_top_ranks
+#include "top_ranks.h"
+
+extern const float ALPHA = 0.85;
+extern const float EPSILON = 0.000001;
+extern const bool SUPPORTS_WARM_START = false;
+extern int MAX_ITERATIONS ;
+int iterations = 0 ;
+
+namespace sycl = cl::sycl;
+
+// class names for SYCL kernels
+class init;
+class sell_sweep;
+
+extern size_t num_work_groups;
+
+// probability of each node as computed by pagerank
+HostArray<float> P_CURR;
+
+// the in-edges of each node of the loaded graph laid out as SELL-C-sigma,
+// so that each node pulls along one row (built once by prepare_graph)
+Host_SELL_Graph HOST_SELL;
+
+/**
+ * Build HOST_SELL, through the graph's transpose, before the driver
+ * times anything
+ */
+int prepare_graph(const Host_CSR_Graph &graph) {
+    Host_CSR_Graph host_transpose;
+    if(host_transpose.buildTranspose(graph.nnodes, graph.nedges, graph.row_start, graph.edge_dst)) {
+        std::cerr << "Cannot build the transpose of the graph\n";
+        return 1;
+    }
+    if(HOST_SELL.buildFromCSR(host_transpose.nnodes,
+                              host_transpose.row_start, host_transpose.edge_dst,
+                              SELL_SLICE_HEIGHT, SELL_SORT_WINDOW)) {
+        std::cerr << "Cannot build the SELL layout of the graph\n";
+        return 1;
+    }
+    std::cerr << "SELL PADDING OVERHEAD: " << HOST_SELL.padding_overhead() << "\n";
+    return 0;
+}
+
+/**
+ * Describe the device buffers allocated by sycl_pagerank
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    const size_t nnodes = graph.nnodes,
+                 nslices = (nnodes + SELL_SLICE_HEIGHT - 1) / SELL_SLICE_HEIGHT;
+    // The padding isn't known until the SELL graph is built,
+    // so this only counts the edges
+    plan.add("SELL slice_start", (nslices + 1) * sizeof(index_type));
+    plan.add("SELL row_node", nslices * SELL_SLICE_HEIGHT * sizeof(index_type));
+    plan.add("SELL neighbors (without padding)", graph.nedges * sizeof(index_type));
+    plan.add("P_CURR", nnodes * sizeof(float));
+    plan.add("outgoing_update (double-buffered)", 2 * (nnodes + 1) * sizeof(float));
+    plan.add("converged flag", sizeof(bool));
+}
+
+// declaration of pagerank function, which wil be called by main
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue);
+
+int sycl_main(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    std::cerr << "NUM WORK GROUPS: " << num_work_groups << "\n";
+    try {
+        sycl_pagerank(sycl_graph, queue);
+    }
+    catch (sycl::exception const& e) {
+        std::cerr << "Caught synchronous SYCL exception:\n" << e.what() << std::endl;
+        if(e.get_cl_code() != CL_SUCCESS) {
+            std::cerr << "OpenCL error code " << e.get_cl_code() << std::endl;
+        }
+        std::exit(1);
+    }
+
+   return 0;
+}
+
+
+void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
+    const size_t WORK_GROUP_SIZE = THREAD_BLOCK_SIZE,
+                 NUM_WORK_GROUPS = num_work_groups,
+                 NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE;
+    static_assert(THREAD_BLOCK_SIZE % SELL_SLICE_HEIGHT == 0,
+                  "work-groups must hold whole slices");
+    SYCL_SELL_Graph sycl_sell(&HOST_SELL);
+
+    // build buffers for probability and outgoing updates.
+    // The outgoing updates are double-buffered: each iteration reads
+    // the current updates and writes the next ones.
+    // Entry NNODES belongs to the dummy node used for padding, whose
+    // update is always 0.
+    iterations = 0;
+    alloc_ranks(sycl_graph.nnodes);
+    sycl::buffer<float, 1> P_CURR_buf(P_CURR.get(), sycl::range<1>{sycl_graph.nnodes});
+    sycl::buffer<float, 1> outgoing_update_buf(sycl::range<1>{sycl_graph.nnodes + 1}),
+                           next_outgoing_update_buf(sycl::range<1>{sycl_graph.nnodes + 1});
+
+    // Initialize probabilities to 1-ALPHA,
+    // and outgoing updates to alpha*(1-alpha)/src_degree
+    // for each node.
+    queue.submit([&] (sycl::handler &cgh) {
+        // some constants
+        const index_type NNODES = sycl_graph.nnodes;
+        // pr probabilities
+        auto prob = P_CURR_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        auto next_outgoing_update = next_outgoing_update_buf.get_access<sycl::access::mode::discard_write>(cgh);
+        auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+
+        cgh.parallel_for<class init>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                       sycl::range<1>{WORK_GROUP_SIZE}},
+        [=](sycl::nd_item<1> my_item) {
+            for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
+                prob[node] = 1.0-ALPHA;
+                outgoing_update[node] = ALPHA * (1-ALPHA) / (row_start[node+1] - row_start[node]);
+            }
+            if(my_item.get_global_id()[0] == 0) {
+                outgoing_update[NNODES] = 0;
+                next_outgoing_update[NNODES] = 0;
+            }
+    }); });
+
+    // have we converged yet?
+    bool converged = false, converged_host_copy = false;
+    sycl::buffer<bool, 1> converged_buf(&converged, sycl::range<1>{1});
+    // begin pagerank
+    while(!converged_host_copy && ++iterations <= MAX_ITERATIONS) {
+        // We've converged unless some node says otherwise
+        {
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::write>();
+            converged_acc[0] = true;
+        }
+        // Sweep over the SELL graph: each work-item pulls the updates
+        // along one row. The *slice_height* rows of a slice are handled by
+        // consecutive work-items, which read consecutive entries.
+        queue.submit([&](sycl::handler &cgh) {
+            // some constants
+            const index_type NNODES = sycl_sell.nnodes,
+                             NROWS = sycl_sell.nslices * SELL_SLICE_HEIGHT;
+            // graph
+            auto slice_start = sycl_sell.slice_start.get_access<sycl::access::mode::read>(cgh);
+            auto row_node = sycl_sell.row_node.get_access<sycl::access::mode::read>(cgh);
+            auto neighbors = sycl_sell.neighbors.get_access<sycl::access::mode::read>(cgh);
+            auto row_start = sycl_graph.row_start.get_access<sycl::access::mode::read>(cgh);
+            // updates, probs, and convergence
+            auto outgoing_update = outgoing_update_buf.get_access<sycl::access::mode::read>(cgh);
+            auto next_outgoing_update = next_outgoing_update_buf.get_access<sycl::access::mode::write>(cgh);
+            auto probs = P_CURR_buf.get_access<sycl::access::mode::read_write>(cgh);
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::write>(cgh);
+
+            cgh.parallel_for<class sell_sweep>(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
+                                                                 sycl::range<1>{WORK_GROUP_SIZE}},
+            [=](sycl::nd_item<1> my_item) {
+                // NUM_WORK_ITEMS is a multiple of the slice height, so
+                // my lane in the slice never changes
+                const index_type lane = my_item.get_global_id()[0] % SELL_SLICE_HEIGHT;
+                for(index_type row = my_item.get_global_id()[0]; row < NROWS; row += NUM_WORK_ITEMS) {
+                    index_type node = row_node[row],
+                               slice = row / SELL_SLICE_HEIGHT;
+                    if(node == NNODES) {
+                        continue;
+                    }
+                    // padding entries pull the dummy node's 0 update
+                    float residual = 0;
+                    for(index_type entry = slice_start[slice] + lane;
+                        entry < slice_start[slice+1];
+                        entry += SELL_SLICE_HEIGHT)
+                    {
+                        residual += outgoing_update[neighbors[entry]];
+                    }
+                    probs[node] += residual;
+                    // if change was big enough, record that we still have work to do
+                    if(residual > EPSILON) {
+                        converged_acc[0] = false;
+                    }
+                    // store the residual, scaled appropriately, for the next iteration
+                    index_type src_degree = row_start[node+1] - row_start[node];
+                    next_outgoing_update[node] = residual * ALPHA / src_degree;
+                }
+        }); });
+        // next iteration reads the updates we just wrote
+        std::swap(outgoing_update_buf, next_outgoing_update_buf);
+        // Did we converge? ( put in local scope to make sure we hit destructor )
+        {
+            auto converged_acc = converged_buf.get_access<sycl::access::mode::read>();
+            converged_host_copy = converged_acc[0];
+        }
+    }
+    // With -t, only the top ranks and their sum leave the device
+    device_top_ranks(queue, P_CURR_buf, sycl_graph.nnodes, NUM_WORK_GROUPS);
+    queue.wait_and_throw();
+}
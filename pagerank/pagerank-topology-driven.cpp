@@ -1,7 +1,10 @@
 #include <climits>
 #include <iostream>
+#include <vector>
 #include <CL/sycl.hpp>
 
+// DeviceMemoryPlan
+#include "device_memory_plan.h"
 // SYCL_CSR_Graph node_data_type index_type
 #include "sycl_csr_graph.h"
 // Pipe
@@ -12,9 +15,14 @@
 #include "in_worklist.h"
 // PushScheduler
 #include "push_scheduler.h"
+// float_bits_t atomic_add_float GroupUpdateCombiner
+#include "float_atomics.h"
+// P_CURR alloc_ranks device_top_ranks
+#include "top_ranks.h"
 
 extern const float ALPHA = 0.85;
 extern const float EPSILON = 0.000001;
+extern const bool SUPPORTS_WARM_START = false;
 extern int MAX_ITERATIONS ;
 int iterations = 0 ;
 
@@ -28,45 +36,37 @@ extern size_t num_work_groups;
 
 struct PROperatorInfo {
     // global accessors
-    sycl::accessor<float, 2,
-                   sycl::access::mode::read_write,
+    sycl::accessor<float_bits_t, 1,
+                   sycl::access::mode::atomic,
                    sycl::access::target::global_buffer>
-                       // residuals (separated by group) (NNODES, NUM_WORK_GROUP)
-                       //   my group's portion of next residual goes in [node][group_nr]
-                       residuals_by_group;
+                       // next residual of each node
+                       //   (stored as bits so that it can be updated atomically)
+                       residuals;
     sycl::accessor<float, 1,
                    sycl::access::mode::read,
                    sycl::access::target::global_buffer>
                        // update coming out of this node
                        outgoing_update;
-    sycl::accessor<size_t, 1,
-                   sycl::access::mode::read_write,
-                   sycl::access::target::global_buffer>
-                       mutex;
-    // local memory
-    sycl::accessor<bool, 1,
-                   sycl::access::mode::read_write,
-                   sycl::access::target::local>
-                       bids_made;
+    // local memory: combines my group's updates to the same node
+    GroupUpdateCombiner combiner;
     /** Called at start of push scheduling */
-    void initialize(const sycl::nd_item<1> &my_item) { }
+    void initialize(const sycl::nd_item<1> &my_item) {
+        combiner.initialize(my_item);
+    }
 
     /** Constructor **/
-    PROperatorInfo( sycl::buffer<float, 2> &residuals_by_group_buf,
+    PROperatorInfo( sycl::buffer<float_bits_t, 1> &residuals_buf,
                     sycl::buffer<float, 1> &outgoing_update_buf,
-                    sycl::buffer<size_t, 1> &mutex_buf,
                     sycl::handler &cgh ) 
-        : residuals_by_group{ residuals_by_group_buf, cgh }
+        : residuals{ residuals_buf, cgh }
         , outgoing_update{ outgoing_update_buf, cgh }
-        , mutex{ mutex_buf, cgh }
-        , bids_made{ sycl::range<1>{1}, cgh }
+        , combiner{ THREAD_BLOCK_SIZE, cgh }
     { }
     /** We must provide a copy constructor */
     PROperatorInfo( const PROperatorInfo &that )
-        : residuals_by_group{ that.residuals_by_group }
+        : residuals{ that.residuals }
         , outgoing_update{ that.outgoing_update }
-        , mutex{ that.mutex }
-        , bids_made{ that.bids_made }
+        , combiner{ that.combiner }
     { }
 };
 
@@ -82,53 +82,63 @@ class PRIter : public PushScheduler<PRIter, PROperatorInfo> {
         { }
 
     // Do a page-rank update, but don't use the out-waitlist!
+    //
+    // Updates to the same node from within my group are first combined
+    // in local memory, and then added into the node's residual
+    // with one atomic add.
     void applyPushOperator(const sycl::nd_item<1> &my_item,
                            index_type src_node,
                            index_type edge_index) 
     {
-        // Get my dest node if my edge is valid
+        // Get my dest node and update if my edge is valid, and try
+        // to combine it with the rest of my group's updates
+        bool have_update = edge_index < NEDGES && src_node < NNODES,
+             combined = false;
         index_type dst_node = NNODES;
-        if(edge_index < NEDGES && src_node < NNODES) {
+        float update = 0;
+        if(have_update) {
             dst_node = edge_dst[edge_index];
+            update = opInfo.outgoing_update[src_node];
+            combined = opInfo.combiner.combine(dst_node, update);
         }
-        // make sure bids_made starts out as false
-        opInfo.bids_made[0] = false;
+        // wait for my group to finish combining
         my_item.barrier(sycl::access::fence_space::local_space);
-        // Sit around til everyone in my group gets a chance to perform
-        // their update!
-        while(true) {
-            // If I have stuff to do, compete for my mutex
-            if(edge_index < NEDGES && dst_node < NNODES && src_node < NNODES) {
-                opInfo.mutex[dst_node] = my_item.get_global_id()[0];
-                opInfo.bids_made[0] = true;
-            }
-            // wait for bids to finalize...
-            my_item.barrier();
-            // If nobody has work to do, great! we're done.
-            if(!opInfo.bids_made[0]) {
-                break;
-            }
-            my_item.barrier();
-            opInfo.bids_made[0] = false;
-            // If I have stuff to do and got my mutex, do my work!
-            if(edge_index < NEDGES && dst_node < NNODES && src_node < NNODES
-               && opInfo.mutex[dst_node] == my_item.get_global_id()[0]) 
-            {
-                opInfo.residuals_by_group[dst_node][my_item.get_group(0)] += opInfo.outgoing_update[src_node];
-                // I got to do my work! so I'm done
-                edge_index = NEDGES;
-                dst_node = NNODES;
-                src_node = NNODES;
-            }
-            // Now wait for everyone's updates to finalize
-            my_item.barrier();
+        // Add my slot's combined update (if any) into the residuals
+        index_type combined_dst_node;
+        float combined_update;
+        if(opInfo.combiner.take(my_item, combined_dst_node, combined_update)) {
+            atomic_add_float(opInfo.residuals[combined_dst_node],
+                             combined_update);
         }
+        // If my update collided with another node's slot, add it directly
+        if(have_update && !combined) {
+            atomic_add_float(opInfo.residuals[dst_node],
+                             update);
+        }
+        // make sure every slot is cleared before the next round combines
+        my_item.barrier(sycl::access::fence_space::local_space);
     }
 };
 
 
 // probability of each node as computed by pagerank
-float *P_CURR;
+HostArray<float> P_CURR;
+
+/**
+ * Describe the device buffers allocated by sycl_pagerank
+ */
+void plan_device_memory(DeviceMemoryPlan &plan, const Host_CSR_Graph &graph, size_t work_groups) {
+    const size_t nnodes = graph.nnodes,
+                 num_work_items = work_groups * THREAD_BLOCK_SIZE;
+    plan.add("P_CURR", nnodes * sizeof(float));
+    plan.add("residuals", nnodes * sizeof(float));
+    plan.add("outgoing_update", nnodes * sizeof(float));
+    plan.add("rerun/converged flags", 2 * sizeof(bool));
+    gpu_size_t wl_capacity = sycl::max(sycl::max((gpu_size_t) graph.nedges, (gpu_size_t) num_work_items),
+                                       (gpu_size_t) nnodes);
+    plan.add("worklist pipe", Pipe::device_footprint(wl_capacity, (gpu_size_t) nnodes,
+                                                     (gpu_size_t) work_groups));
+}
 
 // declaration of pagerank function, which wil be called by main
 void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue);
@@ -156,12 +166,14 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
                  NUM_WORK_ITEMS  = NUM_WORK_GROUPS * WORK_GROUP_SIZE,
                  WARPS_PER_GROUP = WORK_GROUP_SIZE / WARP_SIZE;
     // build buffers for probability and probability residuals
-    P_CURR = (float*) calloc(sycl_graph.nnodes, sizeof(float));
-    assert(P_CURR != NULL);
-    sycl::buffer<float, 1> P_CURR_buf(P_CURR, sycl::range<1>{sycl_graph.nnodes});
-    sycl::buffer<float, 2> res_buf(sycl::range<2>{sycl_graph.nnodes, NUM_WORK_GROUPS});
+    iterations = 0;
+    alloc_ranks(sycl_graph.nnodes);
+    sycl::buffer<float, 1> P_CURR_buf(P_CURR.get(), sycl::range<1>{sycl_graph.nnodes});
+    sycl::buffer<float, 1> res_buf(sycl::range<1>{sycl_graph.nnodes});
     sycl::buffer<float, 1> outgoing_update_buf(sycl::range<1>{sycl_graph.nnodes});
-    sycl::buffer<size_t, 1> mutex_buf(sycl::range<1>{sycl_graph.nnodes});
+    // The push operator adds into the residuals atomically, so it
+    // views them as bits
+    sycl::buffer<float_bits_t, 1> res_bits_buf = res_buf.reinterpret<float_bits_t, 1>(res_buf.get_range());
 
     // Build and initialize the worklist pipe (the max
     // is needed for small graphs so that no group runs out of space
@@ -203,9 +215,7 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
             }
             // Initialize the residuals to 0
             for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
-                for(gpu_size_t wg = 0; wg < NUM_WORK_GROUPS; ++wg) {
-                    res[node][wg] = 0.0;
-                }
+                res[node] = 0.0;
             }
             // Initialize out-going updates to alpha*(1-alpha)/degree
             for(index_type node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
@@ -227,7 +237,7 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
         // (note this doesn't put anything on the out-worklist).
         // We just never swap the worklists
         queue.submit([&](sycl::handler &cgh) {
-            PROperatorInfo prInfo( res_buf, outgoing_update_buf, mutex_buf, cgh );
+            PROperatorInfo prInfo( res_bits_buf, outgoing_update_buf, cgh );
             PRIter currentIter( NUM_WORK_GROUPS, sycl_graph, wl_pipe, cgh, rerun_buf, prInfo );
             cgh.parallel_for(sycl::nd_range<1>{sycl::range<1>{NUM_WORK_ITEMS},
                                                sycl::range<1>{WORK_GROUP_SIZE}},
@@ -255,12 +265,9 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
                 my_item.barrier();
 
                 for(size_t node = my_item.get_global_id()[0]; node < NNODES; node += NUM_WORK_ITEMS) {
-                    // figure out total residual and add it to the prob
-                    float total_residual = 0;
-                    for(gpu_size_t wg = 0; wg < NUM_WORK_GROUPS; ++wg) {
-                        total_residual += res[node][wg];
-                        res[node][wg] = 0;
-                    }
+                    // add the residual to the prob
+                    float total_residual = res[node];
+                    res[node] = 0;
                     probs[node] += total_residual;
                     // if change was big enough, record that we still have work to do
                     if(total_residual > EPSILON) {
@@ -278,5 +285,7 @@ void sycl_pagerank(SYCL_CSR_Graph &sycl_graph, sycl::queue &queue) {
             converged_host_copy = converged_acc[0];
         }
     }
+    // With -t, only the top ranks and their sum leave the device
+    device_top_ranks(queue, P_CURR_buf, sycl_graph.nnodes, NUM_WORK_GROUPS);
     queue.wait_and_throw();
 }
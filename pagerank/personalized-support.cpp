@@ -0,0 +1,94 @@
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// from libsyclutils
+//
+// Host_CSR_Graph index_type
+#include "host_csr_graph.h"
+
+// from pagerank-personalized-batched.cpp
+extern const size_t PPR_MAX_BATCH;
+
+const char *prog_opts = "k:s:t:x:";
+const char *prog_usage = "[-k batch_size] [-s seed_file] [-t top_ranks] [-x max_iterations]";
+const char *prog_args_usage = "";
+
+extern int iterations;
+
+// nodes to personalize to (node 0 unless a seed file is given)
+std::vector<index_type> SEEDS;
+// number of seeds personalized together
+size_t BATCH_SIZE = 0;
+int PRINT_TOP = 10;
+int MAX_ITERATIONS = INT_MAX;
+
+// The PRINT_TOP highest ranked nodes of each seed (in order),
+// and their ranks: TOP_NODES[seed_index * PRINT_TOP + i]
+std::vector<index_type> TOP_NODES;
+std::vector<float> TOP_RANKS;
+
+int process_prog_arg(int argc, char *argv[], int arg_start) {
+   return 1;
+}
+
+void process_prog_opt(char c, char *optarg) {
+  if(c == 'k') {
+    BATCH_SIZE = atoi(optarg);
+    if(BATCH_SIZE == 0 || BATCH_SIZE > PPR_MAX_BATCH) {
+      fprintf(stderr, "batch size must be between 1 and %zu\n", PPR_MAX_BATCH);
+      exit(1);
+    }
+  }
+
+  if(c == 's') {
+    FILE *seed_file = fopen(optarg, "r");
+    if(seed_file == NULL) {
+      fprintf(stderr, "unable to open seed file %s\n", optarg);
+      exit(1);
+    }
+    index_type seed;
+    while(fscanf(seed_file, "%zu", &seed) == 1) {
+      SEEDS.push_back(seed);
+    }
+    fclose(seed_file);
+  }
+
+  if(c == 't') {
+    PRINT_TOP = atoi(optarg);
+  }
+
+  if(c == 'x') {
+    MAX_ITERATIONS = atoi(optarg);
+  }
+}
+
+/**
+ * Print the top ranks of each seed as lines of
+ *      seed place node rank
+ */
+void output(Host_CSR_Graph &g, const char *output_file) {
+  FILE *f;
+
+  fprintf(stderr, "PPR took %d iterations over %zu seeds\n", iterations, SEEDS.size());
+
+  if(!output_file)
+    return;
+
+  if(strcmp(output_file, "-") == 0)
+    f = stdout;
+  else
+    f = fopen(output_file, "w");
+
+  for(size_t s = 0; s < SEEDS.size(); ++s) {
+    for(int i = 0; i < PRINT_TOP; ++i) {
+      fprintf(f, "%zu %d %zu %e\n", SEEDS[s], i + 1,
+              TOP_NODES[s * PRINT_TOP + i], TOP_RANKS[s * PRINT_TOP + i]);
+    }
+  }
+
+  if(f != stdout)
+    fclose(f);
+}
@@ -1,11 +1,20 @@
+#include <algorithm>
 #include <climits>
+#include <cmath>
+#include <cstdio>
 #include <cstring>
 #include <float.h>
+#include <utility>
+#include <vector>
 
 // from libsyclutils
 //
 // Host_CSR_Graph index_type
 #include "host_csr_graph.h"
+// reference_pagerank host_reference_isa HostThreadPool
+#include "host_reference.h"
+// numa_alloc_node_array
+#include "numa_placement.h"
 
 // from bfs-sycl-naive.cpp
 extern const uint64_t INF;
@@ -21,20 +30,86 @@ struct pr_value {
 };
 
 /* TODO: accept ALPHA and EPSILON */
-const char *prog_opts = "nt:x:";
-const char *prog_usage = "[-n] [-t top_ranks] [-x max_iterations]";
+const char *prog_opts = "d:nt:w:x:";
+const char *prog_usage = "[-n] [-t top_ranks] [-x max_iterations] [-w previous_ranks [-d edge_delta]]";
 const char *prog_args_usage = "";
 
-extern float *P_CURR, *P_NEXT;
+extern HostArray<float> P_CURR;
 extern const float ALPHA, EPSILON;
+// true in the variants which can warm start (-w and -d)
+extern const bool SUPPORTS_WARM_START;
 extern int MAX_ITERATIONS;
 extern int iterations;
+// from sycl_driver.cpp
+extern unsigned num_host_threads;
 
 int NO_PRINT_PAGERANK = 0;
 int PRINT_TOP = 0;
 int MAX_ITERATIONS =  INT_MAX;
 
+// Warm start (only in variants with SUPPORTS_WARM_START):
+//
+// (node, rank) pairs read from a previous run's output (-w)
+std::vector<std::pair<index_type, float> > PREV_RANKS;
+// true iff -w was given
+bool WARM_START = false;
+// (src, dst) of each edge added or removed since the previous run (-d).
+// Read from lines of the form "+ src dst" or "- src dst".
+std::vector<std::pair<index_type, index_type> > EDGE_DELTA;
+// true iff -d was given
+bool HAVE_EDGE_DELTA = false;
+
+// With -t, the variants copy back only the PRINT_TOP highest ranked
+// nodes (in order) and their ranks, along with the sum of all ranks
+std::vector<index_type> TOP_NODES;
+std::vector<float> TOP_RANKS;
+float RANK_SUM = 0;
+
+/**
+ * Replace P_CURR with *nnodes* zeroed ranks, in huge pages and placed by
+ * -N like the graph's node data
+ */
+void alloc_ranks(index_type nnodes) {
+  if(!numa_alloc_node_array(P_CURR, nnodes, HOST_ACCESS_RANDOM)) {
+    fprintf(stderr, "unable to allocate ranks of %zu nodes\n", (size_t) nnodes);
+    exit(1);
+  }
+}
+
+/**
+ * With -t, fill RANK_SUM, TOP_NODES and TOP_RANKS from P_CURR on the host
+ * (as device_top_ranks in top_ranks.h does on the device). Used by the host
+ * backends.
+ */
+void host_top_ranks(const Host_CSR_Graph &g) {
+  if(PRINT_TOP <= 0)
+    return;
+  RANK_SUM = 0;
+  for(index_type node = 0; node < g.nnodes; ++node) {
+    RANK_SUM += P_CURR[node];
+  }
+  std::vector<index_type> order(g.nnodes);
+  for(index_type node = 0; node < g.nnodes; ++node) {
+    order[node] = node;
+  }
+  size_t k = std::min((size_t) PRINT_TOP, (size_t) g.nnodes);
+  std::partial_sort(order.begin(), order.begin() + k, order.end(),
+                    [](index_type a, index_type b) {
+    return P_CURR[a] > P_CURR[b] || (P_CURR[a] == P_CURR[b] && a < b);
+  });
+  TOP_NODES.assign(order.begin(), order.begin() + k);
+  TOP_RANKS.clear();
+  for(index_type node : TOP_NODES) {
+    TOP_RANKS.push_back(P_CURR[node]);
+  }
+}
+
 int process_prog_arg(int argc, char *argv[], int arg_start) {
+  // runs after all options, so -d can be checked whichever order -w came in
+  if(HAVE_EDGE_DELTA && !WARM_START) {
+    fprintf(stderr, "-d: an edge delta requires -w previous_ranks\n");
+    exit(1);
+  }
    return 1;
 }
 
@@ -49,6 +124,45 @@ void process_prog_opt(char c, char *optarg) {
   if(c == 'x') {
     MAX_ITERATIONS = atoi(optarg);
   }
+
+  if((c == 'w' || c == 'd') && !SUPPORTS_WARM_START) {
+    fprintf(stderr, "-%c: this variant cannot warm start (use pagerank-data-driven)\n", c);
+    exit(1);
+  }
+
+  if(c == 'w') {
+    FILE *f = fopen(optarg, "r");
+    if(f == NULL) {
+      fprintf(stderr, "unable to open previous ranks %s\n", optarg);
+      exit(1);
+    }
+    index_type node;
+    float rank;
+    while(fscanf(f, "%zu %f", &node, &rank) == 2) {
+      PREV_RANKS.push_back(std::make_pair(node, rank));
+    }
+    fclose(f);
+    WARM_START = true;
+  }
+
+  if(c == 'd') {
+    FILE *f = fopen(optarg, "r");
+    if(f == NULL) {
+      fprintf(stderr, "unable to open edge delta %s\n", optarg);
+      exit(1);
+    }
+    char sign;
+    index_type src, dst;
+    while(fscanf(f, " %c %zu %zu", &sign, &src, &dst) == 3) {
+      if(sign != '+' && sign != '-') {
+        fprintf(stderr, "edge delta lines must start with + or -\n");
+        exit(1);
+      }
+      EDGE_DELTA.push_back(std::make_pair(src, dst));
+    }
+    fclose(f);
+    HAVE_EDGE_DELTA = true;
+  }
 }
 
 // Copied and modified from 
@@ -61,6 +175,30 @@ void output(Host_CSR_Graph &g, const char *output_file) {
 
   struct pr_value * pr;
 
+  if(PRINT_TOP > 0) {
+    fprintf(stderr, "PR took %d iterations\n", iterations);
+    fprintf(stdout, "sum: %f (%zu)\n", RANK_SUM, g.nnodes);
+
+    if(!output_file)
+      return;
+
+    if(strcmp(output_file, "-") == 0)
+      f = stdout;
+    else
+      f = fopen(output_file, "w");
+
+    for(size_t i = 0; i < TOP_NODES.size(); i++) {
+      if(NO_PRINT_PAGERANK)
+        fprintf(f, "%zu %zu\n", i + 1, TOP_NODES[i]);
+      else
+        fprintf(f, "%zu %zu %.*e\n", i + 1, TOP_NODES[i], FLT_DIG + 2, TOP_RANKS[i]);
+    }
+
+    if(f != stdout)
+      fclose(f);
+    return;
+  }
+
   pr = (struct pr_value *) calloc(g.nnodes, sizeof(struct pr_value));
 
   if(pr == NULL) {
@@ -77,7 +215,7 @@ void output(Host_CSR_Graph &g, const char *output_file) {
     sum += P_CURR[i];
   }
 
-  fprintf(stdout, "sum: %f (%d)\n", sum, g.nnodes);
+  fprintf(stdout, "sum: %f (%zu)\n", sum, g.nnodes);
 
   if(!output_file)
     return;
@@ -93,9 +231,6 @@ void output(Host_CSR_Graph &g, const char *output_file) {
 
 //  fprintf(f, "ALPHA %*e EPSILON %*e\n", FLT_DIG, ALPHA, FLT_DIG, EPSILON);
 
-  if(PRINT_TOP == 0)
-    PRINT_TOP = g.nnodes;
-
 //  fprintf(f, "RANKS 1--%d of %d\n", PRINT_TOP, g.nnodes);
 
   /* for(int i = 1; i <= PRINT_TOP; i++) {
@@ -106,10 +241,74 @@ void output(Host_CSR_Graph &g, const char *output_file) {
   } */
   for(int i = 0; i < g.nnodes; i++) {
     if(NO_PRINT_PAGERANK) 
-      fprintf(f, "%d\n", pr[i].node);
+      fprintf(f, "%zu\n", pr[i].node);
     else 
-      fprintf(f, "%d %f\n", pr[i].node, FLT_DIG, pr[i].rank);  
+      // enough digits to read the rank back exactly (e.g. with -w)
+      fprintf(f, "%zu %.*e\n", pr[i].node, FLT_DIG + 2, pr[i].rank);  
   }
 
   free(pr);
 }
+
+// Ranks within this fraction of max(1, reference rank) pass verification
+const float RANK_TOLERANCE = 1e-3;
+
+/**
+ * @return true iff *rank* matches *expected* within RANK_TOLERANCE
+ */
+static bool rank_matches(float rank, float expected) {
+  return std::fabs(rank - expected) <= RANK_TOLERANCE * std::max(1.0f, expected);
+}
+
+/**
+ * Compare the ranks (or, with -t, the top ranks and their sum) with
+ * those of the host reference PageRank
+ *
+ * @return nonzero iff any rank differs by more than RANK_TOLERANCE
+ */
+int verify_output(Host_CSR_Graph &g) {
+  if(MAX_ITERATIONS != INT_MAX) {
+    fprintf(stderr, "Not verifying ranks cut off at %d iterations\n", MAX_ITERATIONS);
+    return 0;
+  }
+  Host_CSR_Graph transpose;
+  if(transpose.buildTranspose(g.nnodes, g.nedges, g.row_start, g.edge_dst)) {
+    return 1;
+  }
+  HostThreadPool pool(num_host_threads);
+  std::vector<float> ranks(g.nnodes);
+  reference_pagerank(pool, g, transpose, ALPHA, EPSILON, INT_MAX, ranks.data());
+
+  size_t mismatches = 0, checked = 0;
+  auto check = [&](index_type node, float rank) {
+    checked++;
+    if(!rank_matches(rank, ranks[node])) {
+      // report the first few
+      if(mismatches < 10) {
+        fprintf(stderr, "node %zu: rank %e, expected %e\n", node, rank, ranks[node]);
+      }
+      mismatches++;
+    }
+  };
+  if(PRINT_TOP > 0) {
+    for(size_t i = 0; i < TOP_NODES.size(); i++) {
+      check(TOP_NODES[i], TOP_RANKS[i]);
+    }
+    double sum = 0;
+    for(index_type node = 0; node < g.nnodes; node++) {
+      sum += ranks[node];
+    }
+    if(std::fabs(RANK_SUM - sum) > RANK_TOLERANCE * sum) {
+      fprintf(stderr, "sum of ranks %f, expected %f\n", RANK_SUM, sum);
+      mismatches++;
+    }
+  }
+  else {
+    for(index_type node = 0; node < g.nnodes; node++) {
+      check(node, P_CURR[node]);
+    }
+  }
+  fprintf(stderr, "%zu of %zu ranks differ from the host reference (%s)\n",
+          mismatches, checked, host_reference_isa());
+  return mismatches > 0;
+}
@@ -0,0 +1,54 @@
+/*  -*- mode: c++ -*- */
+/**
+ * top_ranks.h
+ *
+ * The ranks and -t results shared by the pagerank variants and
+ * support.cpp, which defines them.
+ *
+ * device_top_ranks has to be compiled with the variant's kernels, so it
+ * lives here rather than in support.cpp, which is not built for SYCL.
+ */
+#include <vector>
+#include <CL/sycl.hpp>
+
+// HostArray
+#include "host_array.h"
+// Host_CSR_Graph index_type
+#include "host_csr_graph.h"
+// device_sum top_k
+#include "top_k.h"
+
+#ifndef BREADTHNPAGEINSYCL_PAGERANK_TOP_RANKS_
+#define BREADTHNPAGEINSYCL_PAGERANK_TOP_RANKS_
+
+namespace sycl = cl::sycl;
+
+// probability of each node as computed by pagerank (defined by each variant)
+extern HostArray<float> P_CURR;
+
+// from support.cpp
+extern int PRINT_TOP;
+extern std::vector<index_type> TOP_NODES;
+extern std::vector<float> TOP_RANKS;
+extern float RANK_SUM;
+void alloc_ranks(index_type nnodes);
+void host_top_ranks(const Host_CSR_Graph &graph);
+
+/**
+ * With -t, fill RANK_SUM, TOP_NODES and TOP_RANKS on the device, and
+ * keep the ranks from being copied back into P_CURR, so only the top
+ * ranks and their sum leave the device. host_top_ranks does the same
+ * for the host backends.
+ */
+inline void device_top_ranks(sycl::queue &queue, sycl::buffer<float, 1> &P_CURR_buf,
+                             size_t nnodes, size_t num_work_groups)
+{
+    if(PRINT_TOP <= 0) {
+        return;
+    }
+    RANK_SUM = device_sum(queue, P_CURR_buf, nnodes, num_work_groups);
+    top_k(queue, P_CURR_buf, nnodes, PRINT_TOP, num_work_groups, TOP_NODES, TOP_RANKS);
+    P_CURR_buf.set_final_data(nullptr);
+}
+
+#endif